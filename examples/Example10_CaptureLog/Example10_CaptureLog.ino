@@ -0,0 +1,109 @@
+/*
+  Record what crosses the serial link to the MY1690X MP3 IC
+  By: SparkFun Electronics
+  Date: October 17th, 2026
+  License: MIT. See license file for more information but you can
+  basically do whatever you want with this code.
+
+  MY1690Capture sits between the library and the serial port and keeps the last
+  few hundred bytes sent and received, each stamped with micros(). Print it as
+  text to see what the MY1690 actually said, or as a C array to paste into a
+  sketch that plays it back through MY1690Replay, which feeds the replies to the
+  library with the same timing, no MY1690 needed.
+
+  Send 'n' for the next track, 'v' to read the volume, 't' to print the capture
+  as text and 'b' to print it as a C array.
+
+  Feel like supporting our work? Buy a board from SparkFun!
+  MY1690X Serial MP3 Player Shield: https://www.sparkfun.com/sparkfun-serial-mp3-player-shield-my1690x.html
+  MY1690X Audio Player Breakout: https://www.sparkfun.com/sparkfun-audio-player-breakout-my1690x-16s.html
+
+  Hardware Connections:
+  MY1690 Pin -> Arduino Pin
+  -------------------------------------
+  TXO -> 8
+  RXI -> 9
+  VIN -> 5V
+  GND -> GND
+
+  Load a few tracks on the sdCard as 0001.mp3, 0002.mp3, etc.
+*/
+
+#include "SparkFun_MY1690_MP3_Library.h" // Click here to get the library: http://librarymanager/All#SparkFun_MY1690
+#include "SparkFun_MY1690_Capture.h"
+
+//For boards that support software serial
+#include "SoftwareSerial.h"
+SoftwareSerial serialMP3(8, 9); //RX on Arduino connected to TX on MY1690's, TX on Arduino connected to the MY1690's RX pin
+
+//For boards that have multiple hardware serial ports
+//HardwareSerial serialMP3(2); //Create serial port on ESP32: TX on 17, RX on 16
+
+MY1690Capture capture(serialMP3);
+SparkFunMY1690 myMP3;
+
+//Prints the binary capture as the body of a C array
+class ArrayPrinter : public Print
+{
+public:
+  size_t write(uint8_t value) override
+  {
+    if (count % 16 == 0)
+      Serial.print(F("\r\n  "));
+    Serial.print(F("0x"));
+    if (value < 0x10)
+      Serial.print('0');
+    Serial.print(value, HEX);
+    Serial.print(F(", "));
+    count++;
+    return (1);
+  }
+  using Print::write;
+  uint16_t count = 0;
+};
+
+void setup()
+{
+  Serial.begin(115200);
+  Serial.println(F("MY1690 MP3 Example 10 - Capture Log"));
+
+  serialMP3.begin(9600); //The MY1690 expects serial communication at 9600bps
+
+  if (myMP3.begin(capture) == false) //Talk through the capture instead of the port
+  {
+    Serial.println(F("Device not detected. Check wiring. Freezing."));
+    while (1);
+  }
+
+  myMP3.playTrackNumber(1);
+}
+
+void loop()
+{
+  myMP3.update();
+
+  if (Serial.available())
+  {
+    byte incoming = Serial.read();
+    if (incoming == 'n')
+      myMP3.submit(MP3_COMMAND_NEXT);
+    else if (incoming == 'v')
+    {
+      Serial.print(F("Volume: "));
+      Serial.println(myMP3.getVolume());
+    }
+    else if (incoming == 't')
+    {
+      capture.dumpText(Serial);
+      Serial.print(capture.getDropped());
+      Serial.println(F(" older bytes dropped"));
+    }
+    else if (incoming == 'b')
+    {
+      ArrayPrinter printer;
+      Serial.print(F("const uint8_t capture[] = {"));
+      capture.dumpBinary(printer);
+      Serial.println(F("\r\n};"));
+    }
+  }
+}
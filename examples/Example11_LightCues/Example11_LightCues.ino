@@ -0,0 +1,111 @@
+/*
+  Switch lights in time with a track on the MY1690X MP3 IC
+  By: SparkFun Electronics
+  Date: October 17th, 2026
+  License: MIT. See license file for more information but you can
+  basically do whatever you want with this code.
+
+  Polling the MY1690 for the elapsed time ties up the serial port and only gives
+  whole seconds. MY1690CueScheduler fires functions at set points in a track from
+  the position MY1690PositionTracker works out locally, counted from the busy pin
+  edge that started the track. Here the built in LED and a second LED follow the
+  beat of track 1.
+
+  Send 'p' to play track 1 from the start, 's' to stop.
+
+  Feel like supporting our work? Buy a board from SparkFun!
+  MY1690X Serial MP3 Player Shield: https://www.sparkfun.com/sparkfun-serial-mp3-player-shield-my1690x.html
+  MY1690X Audio Player Breakout: https://www.sparkfun.com/sparkfun-audio-player-breakout-my1690x-16s.html
+
+  Hardware Connections:
+  MY1690 Pin -> Arduino Pin
+  -------------------------------------
+  TXO -> 8
+  RXI -> 9
+  BUSY -> 2 (lets the cues count from the moment the track really starts)
+  VIN -> 5V
+  GND -> GND
+  LED -> 5 (through a resistor)
+
+  Load a track on the sdCard as 0001.mp3.
+*/
+
+#include "SparkFun_MY1690_MP3_Library.h" // Click here to get the library: http://librarymanager/All#SparkFun_MY1690
+#include "SparkFun_MY1690_Position.h"
+#include "SparkFun_MY1690_Cue.h"
+
+//For boards that support software serial
+#include "SoftwareSerial.h"
+SoftwareSerial serialMP3(8, 9); //RX on Arduino connected to TX on MY1690's, TX on Arduino connected to the MY1690's RX pin
+
+//For boards that have multiple hardware serial ports
+//HardwareSerial serialMP3(2); //Create serial port on ESP32: TX on 17, RX on 16
+
+const uint8_t busyPin = 2;
+const uint8_t spotPin = 5;
+
+SparkFunMY1690 myMP3;
+MY1690PositionTracker position(myMP3);
+MY1690CueScheduler cues(position);
+
+//The pin to switch is passed as the context, the state is picked from the offset
+void lightOn(uint16_t trackNumber, uint32_t offsetMs, void *context)
+{
+  digitalWrite((uintptr_t)context, HIGH);
+  Serial.print(F("On at "));
+  Serial.println(offsetMs);
+}
+
+void lightOff(uint16_t trackNumber, uint32_t offsetMs, void *context)
+{
+  digitalWrite((uintptr_t)context, LOW);
+}
+
+void setup()
+{
+  Serial.begin(115200);
+  Serial.println(F("MY1690 MP3 Example 11 - Light Cues"));
+
+  pinMode(LED_BUILTIN, OUTPUT);
+  pinMode(spotPin, OUTPUT);
+
+  serialMP3.begin(9600); //The MY1690 expects serial communication at 9600bps
+
+  if (myMP3.begin(serialMP3, busyPin) == false)
+  {
+    Serial.println(F("Device not detected. Check wiring. Freezing."));
+    while (1);
+  }
+
+  myMP3.enableBusyInterrupt();
+  position.begin(); //Takes over myMP3.onCommandCompleted(), so don't set one of your own
+
+  //Flash the built in LED on the first seven beats at 120bpm. MY1690_CUE_SLOTS is 16 by default.
+  for (uint32_t beat = 0; beat < 7; beat++)
+  {
+    cues.add(1, beat * 500, lightOn, (void *)LED_BUILTIN);
+    cues.add(1, beat * 500 + 100, lightOff, (void *)LED_BUILTIN);
+  }
+
+  //Spotlight for the chorus
+  cues.add(1, 4000, lightOn, (void *)spotPin);
+  cues.add(1, 6000, lightOff, (void *)spotPin);
+}
+
+void loop()
+{
+  cues.update(); //Also updates the tracker and myMP3
+
+  if (Serial.available())
+  {
+    byte incoming = Serial.read();
+    if (incoming == 'p')
+      myMP3.submit(MP3_COMMAND_SELECT_TRACK_PLAY, 1, 2);
+    else if (incoming == 's')
+    {
+      myMP3.submit(MP3_COMMAND_STOP);
+      digitalWrite(LED_BUILTIN, LOW);
+      digitalWrite(spotPin, LOW);
+    }
+  }
+}
@@ -0,0 +1,93 @@
+/*
+  Play clips by folder and number on the MY1690X MP3 IC
+  By: SparkFun Electronics
+  Date: October 17th, 2026
+  License: MIT. See license file for more information but you can
+  basically do whatever you want with this code.
+
+  The MY1690 only plays tracks by their number across the whole card. MY1690Catalog
+  reads how many clips each folder holds once, at startup, and keeps running totals,
+  so "clip 5 in folder 3" turns into a track number with no serial traffic at all.
+
+  Send a folder and a clip, ie '3 5', to play it.
+
+  Feel like supporting our work? Buy a board from SparkFun!
+  MY1690X Serial MP3 Player Shield: https://www.sparkfun.com/sparkfun-serial-mp3-player-shield-my1690x.html
+  MY1690X Audio Player Breakout: https://www.sparkfun.com/sparkfun-audio-player-breakout-my1690x-16s.html
+
+  Hardware Connections:
+  MY1690 Pin -> Arduino Pin
+  -------------------------------------
+  TXO -> 8
+  RXI -> 9
+  VIN -> 5V
+  GND -> GND
+
+  Copy the clips to the card one folder at a time, in folder order, so the MY1690
+  numbers them folder by folder.
+*/
+
+#include "SparkFun_MY1690_MP3_Library.h" // Click here to get the library: http://librarymanager/All#SparkFun_MY1690
+#include "SparkFun_MY1690_Catalog.h"
+
+//For boards that support software serial
+#include "SoftwareSerial.h"
+SoftwareSerial serialMP3(8, 9); //RX on Arduino connected to TX on MY1690's, TX on Arduino connected to the MY1690's RX pin
+
+//For boards that have multiple hardware serial ports
+//HardwareSerial serialMP3(2); //Create serial port on ESP32: TX on 17, RX on 16
+
+SparkFunMY1690 myMP3;
+MY1690Catalog catalog(myMP3);
+
+void setup()
+{
+  Serial.begin(115200);
+  Serial.println(F("MY1690 MP3 Example 12 - Folder Tracks"));
+
+  serialMP3.begin(9600); //The MY1690 expects serial communication at 9600bps
+
+  if (myMP3.begin(serialMP3) == false)
+  {
+    Serial.println(F("Device not detected. Check wiring. Freezing."));
+    while (1);
+  }
+
+  //Count every folder now rather than while the player idles
+  if (catalog.buildIndex() == false)
+    Serial.println(F("Not every folder could be counted"));
+
+  for (uint8_t folder = 0; folder < MY1690_CATALOG_FOLDERS; folder++)
+  {
+    uint16_t count = catalog.getSongsInFolderCount(folder);
+    if (count == 0 || count == MY1690_CATALOG_UNKNOWN)
+      continue;
+    Serial.print(F("Folder "));
+    Serial.print(folder);
+    Serial.print(F(": "));
+    Serial.print(count);
+    Serial.print(F(" clips, tracks "));
+    Serial.print(catalog.getTrackNumber(folder, 1));
+    Serial.print(F(" to "));
+    Serial.println(catalog.getTrackNumber(folder, count));
+  }
+}
+
+void loop()
+{
+  catalog.update(); //Also updates myMP3
+
+  if (Serial.available())
+  {
+    uint8_t folder = Serial.parseInt();
+    uint16_t clip = Serial.parseInt();
+
+    if (catalog.playFolderTrack(folder, clip) == MY1690_INVALID_HANDLE)
+      Serial.println(F("No such clip"));
+    else
+    {
+      Serial.print(F("Playing track "));
+      Serial.println(catalog.getTrackNumber(folder, clip));
+    }
+  }
+}
@@ -0,0 +1,107 @@
+/*
+  Query the MY1690X MP3 IC without blocking the main loop
+  By: SparkFun Electronics
+  Date: October 17th, 2026
+  License: MIT. See license file for more information but you can
+  basically do whatever you want with this code.
+
+  The blocking calls like getVolume() wait for the MY1690 to respond. This
+  example queues commands with submit() and lets update() move them along,
+  so the loop is free to blink an LED (or run a network stack) in the meantime.
+
+  Feel like supporting our work? Buy a board from SparkFun!
+  MY1690X Serial MP3 Player Shield: https://www.sparkfun.com/sparkfun-serial-mp3-player-shield-my1690x.html
+  MY1690X Audio Player Breakout: https://www.sparkfun.com/sparkfun-audio-player-breakout-my1690x-16s.html
+
+  Hardware Connections:
+  MY1690 Pin -> Arduino Pin
+  -------------------------------------
+  TXO -> 8
+  RXI -> 9
+  VIN -> 5V
+  GND -> GND
+
+  Don't forget to load some MP3s on your sdCard and plug it in too!
+*/
+
+#include "SparkFun_MY1690_MP3_Library.h" // Click here to get the library: http://librarymanager/All#SparkFun_MY1690
+
+//For boards that support software serial
+#include "SoftwareSerial.h"
+SoftwareSerial serialMP3(8, 9); //RX on Arduino connected to TX on MY1690's, TX on Arduino connected to the MY1690's RX pin
+
+//For boards that have multiple hardware serial ports
+//HardwareSerial serialMP3(2); //Create serial port on ESP32: TX on 17, RX on 16
+
+SparkFunMY1690 myMP3;
+
+MY1690Handle volumeQuery = MY1690_INVALID_HANDLE;
+unsigned long lastQuery = 0;
+unsigned long lastBlink = 0;
+
+//Called from update() when the elapsed time query completes
+void elapsedTimeReady(MY1690Handle handle, MY1690Status status, uint16_t value, void *context)
+{
+  if (status == MY1690_STATUS_OK)
+  {
+    Serial.print(F("Elapsed time (s): "));
+    Serial.println(value);
+  }
+}
+
+void setup()
+{
+  Serial.begin(115200);
+  Serial.println(F("MY1690 MP3 Example 5 - Non-blocking"));
+
+  pinMode(LED_BUILTIN, OUTPUT);
+
+  serialMP3.begin(9600); //The MY1690 expects serial communication at 9600bps
+
+  if (myMP3.begin(serialMP3) == false) // Beginning the MP3 player requires a serial port (either hardware or software)
+  {
+    Serial.println(F("Device not detected. Check wiring. Freezing."));
+    while (1);
+  }
+
+  myMP3.setSleepHook(SparkFunMY1690::platformSleep); //Optional. Sleep in idle() instead of spinning.
+
+  myMP3.submit(MP3_COMMAND_PLAY); //Returns right away. The command goes out from update().
+}
+
+void loop()
+{
+  myMP3.update(); //Call this often. It sends queued commands and parses replies.
+
+  //Queue a couple of queries every second
+  if (millis() - lastQuery > 1000)
+  {
+    lastQuery = millis();
+    volumeQuery = myMP3.submit(MP3_COMMAND_GET_VOLUME); //Poll the handle for this one
+    myMP3.submit(MP3_COMMAND_GET_CURRENT_TRACK_TIME, 0, 0, elapsedTimeReady); //Get a callback for this one
+  }
+
+  //Check on the volume query without waiting for it
+  uint16_t volume;
+  MY1690Status status = myMP3.getResult(volumeQuery, &volume);
+  if (status == MY1690_STATUS_OK)
+  {
+    Serial.print(F("Volume: "));
+    Serial.println(volume);
+    volumeQuery = MY1690_INVALID_HANDLE;
+  }
+  else if (status == MY1690_STATUS_TIMEOUT)
+  {
+    Serial.println(F("Volume query timed out"));
+    volumeQuery = MY1690_INVALID_HANDLE;
+  }
+
+  //The LED keeps blinking steadily while the MY1690 is being talked to
+  if (millis() - lastBlink > 100)
+  {
+    lastBlink = millis();
+    digitalWrite(LED_BUILTIN, !digitalRead(LED_BUILTIN));
+  }
+
+  myMP3.idle(); //Sleeps until a reply byte, a busy pin edge or the next timer tick
+}
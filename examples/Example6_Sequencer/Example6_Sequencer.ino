@@ -0,0 +1,78 @@
+/*
+  Play a list of clips back to back with the MY1690X MP3 IC
+  By: SparkFun Electronics
+  Date: October 17th, 2026
+  License: MIT. See license file for more information but you can
+  basically do whatever you want with this code.
+
+  Announcements are often built from short clips ("train", "now", "arriving",
+  "platform", "3"). Waiting on isPlaying() between them leaves audible gaps.
+  MY1690Sequencer watches the busy pin through an interrupt and sends the next
+  clip the moment the current one ends, then reports the gap it achieved.
+
+  Feel like supporting our work? Buy a board from SparkFun!
+  MY1690X Serial MP3 Player Shield: https://www.sparkfun.com/sparkfun-serial-mp3-player-shield-my1690x.html
+  MY1690X Audio Player Breakout: https://www.sparkfun.com/sparkfun-audio-player-breakout-my1690x-16s.html
+
+  Hardware Connections:
+  MY1690 Pin -> Arduino Pin
+  -------------------------------------
+  TXO -> 8
+  RXI -> 9
+  BUSY -> 2 (must be able to interrupt)
+  VIN -> 5V
+  GND -> GND
+
+  Load the clips on the sdCard as 0001.mp3 to 0005.mp3.
+*/
+
+#include "SparkFun_MY1690_MP3_Library.h" // Click here to get the library: http://librarymanager/All#SparkFun_MY1690
+#include "SparkFun_MY1690_Sequencer.h"
+
+//For boards that support software serial
+#include "SoftwareSerial.h"
+SoftwareSerial serialMP3(8, 9); //RX on Arduino connected to TX on MY1690's, TX on Arduino connected to the MY1690's RX pin
+
+//For boards that have multiple hardware serial ports
+//HardwareSerial serialMP3(2); //Create serial port on ESP32: TX on 17, RX on 16
+
+const uint8_t busyPin = 2;
+
+SparkFunMY1690 myMP3;
+MY1690Sequencer announcement(myMP3);
+
+void setup()
+{
+  Serial.begin(115200);
+  Serial.println(F("MY1690 MP3 Example 6 - Sequencer"));
+
+  serialMP3.begin(9600); //The MY1690 expects serial communication at 9600bps
+
+  if (myMP3.begin(serialMP3, busyPin) == false)
+  {
+    Serial.println(F("Device not detected. Check wiring. Freezing."));
+    while (1);
+  }
+
+  //Without the interrupt the sequencer falls back to the 'STOP' message, which arrives later
+  if (myMP3.enableBusyInterrupt() == false)
+    Serial.println(F("Busy pin can't interrupt. Using STOP messages instead."));
+
+  for (uint16_t track = 1; track <= 5; track++)
+    announcement.add(track);
+
+  announcement.start();
+}
+
+void loop()
+{
+  announcement.update(); //Also updates myMP3
+
+  static bool reported = false;
+  if (announcement.isRunning() == false && reported == false)
+  {
+    reported = true;
+    Serial.print(F("Done. Longest gap between clips (us): "));
+    Serial.println(announcement.getMaxGapUs());
+  }
+}
@@ -0,0 +1,93 @@
+/*
+  Service the MY1690X MP3 IC from its own FreeRTOS task on an ESP32
+  By: SparkFun Electronics
+  Date: October 17th, 2026
+  License: MIT. See license file for more information but you can
+  basically do whatever you want with this code.
+
+  MY1690Task runs the command engine in a task pinned to one core. Any other
+  task opens a mailbox and posts commands to it, so no task ever waits on the
+  UART itself and no mutex is needed. Here a second task nudges the volume
+  while loop() polls the elapsed time.
+
+  Feel like supporting our work? Buy a board from SparkFun!
+  MY1690X Serial MP3 Player Shield: https://www.sparkfun.com/sparkfun-serial-mp3-player-shield-my1690x.html
+  MY1690X Audio Player Breakout: https://www.sparkfun.com/sparkfun-audio-player-breakout-my1690x-16s.html
+
+  Hardware Connections:
+  MY1690 Pin -> Arduino Pin
+  -------------------------------------
+  TXO -> 26
+  RXI -> 27
+  VIN -> 5V
+  GND -> GND
+
+  Don't forget to load some MP3s on your sdCard and plug it in too!
+*/
+
+#include "SparkFun_MY1690_MP3_Library.h" // Click here to get the library: http://librarymanager/All#SparkFun_MY1690
+#include "SparkFun_MY1690_Task.h"
+
+HardwareSerial serialMP3(2); //Create serial port on ESP32 using UART2
+
+SparkFunMY1690 myMP3;
+MY1690Task mp3Driver(myMP3);
+
+//A second task with its own mailbox
+void volumeTask(void *parameter)
+{
+  MY1690Mailbox *mailbox = mp3Driver.openMailbox();
+
+  uint8_t volume = 10;
+  while (1)
+  {
+    volume = (volume >= 25) ? 10 : volume + 5;
+    mailbox->post(MP3_COMMAND_SET_VOLUME, volume, 1); //Fire and forget
+    vTaskDelay(pdMS_TO_TICKS(5000));
+  }
+}
+
+MY1690Mailbox *loopMailbox;
+
+void setup()
+{
+  Serial.begin(115200);
+  Serial.println(F("MY1690 MP3 Example 7 - FreeRTOS task on ESP32"));
+
+  serialMP3.begin(9600, SERIAL_8N1, 26, 27); // ESP32 HW serial arguments: (GPS_BAUD, SERIAL_8N1, RX_GPIO, TX_GPIO);
+
+  if (myMP3.begin(serialMP3) == false) // Beginning the MP3 player requires a serial port (either hardware or software)
+  {
+    Serial.println(F("Device not detected. Check wiring. Freezing."));
+    while (1);
+  }
+
+  //From here on only the driver task touches myMP3
+  mp3Driver.begin();
+
+  loopMailbox = mp3Driver.openMailbox();
+  loopMailbox->post(MP3_COMMAND_PLAY);
+
+  xTaskCreate(volumeTask, "volume", 2048, nullptr, 1, nullptr);
+}
+
+void loop()
+{
+  //Blocks this task, not the CPU, until the reply is in
+  uint16_t seconds;
+  if (loopMailbox->call(MP3_COMMAND_GET_CURRENT_TRACK_TIME, 0, 0, &seconds) == MY1690_STATUS_OK)
+  {
+    Serial.print(F("Elapsed time (s): "));
+    Serial.println(seconds);
+  }
+
+  //Or post now and pick the result up later
+  MY1690Future trackQuery;
+  loopMailbox->post(MP3_COMMAND_GET_CURRENT_TRACK, 0, 0, &trackQuery);
+  delay(500); //Do other work here
+  if (trackQuery.wait() == MY1690_STATUS_OK)
+  {
+    Serial.print(F("Track: "));
+    Serial.println(trackQuery.value());
+  }
+}
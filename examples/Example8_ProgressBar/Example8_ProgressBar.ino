@@ -0,0 +1,107 @@
+/*
+  Draw a progress bar for the current track without polling the MY1690X MP3 IC
+  By: SparkFun Electronics
+  Date: October 17th, 2026
+  License: MIT. See license file for more information but you can
+  basically do whatever you want with this code.
+
+  Asking the MY1690 for the elapsed time costs a serial round trip every time.
+  MY1690PositionTracker reads the elapsed and total time once when a track starts,
+  then works the position out from millis(). Pause, fast forward and rewind sent
+  through the library are followed as they happen, and the tracker checks itself
+  against the device every few seconds. The bar below redraws 60 times a second
+  without touching the serial port.
+
+  Send 'p' to pause/play, 'f' to fast forward, 'r' to rewind, 'n' for the next track.
+
+  Feel like supporting our work? Buy a board from SparkFun!
+  MY1690X Serial MP3 Player Shield: https://www.sparkfun.com/sparkfun-serial-mp3-player-shield-my1690x.html
+  MY1690X Audio Player Breakout: https://www.sparkfun.com/sparkfun-audio-player-breakout-my1690x-16s.html
+
+  Hardware Connections:
+  MY1690 Pin -> Arduino Pin
+  -------------------------------------
+  TXO -> 8
+  RXI -> 9
+  BUSY -> 2 (optional, lets the tracker see tracks start and end)
+  VIN -> 5V
+  GND -> GND
+
+  Load a few tracks on the sdCard as 0001.mp3, 0002.mp3, etc.
+*/
+
+#include "SparkFun_MY1690_MP3_Library.h" // Click here to get the library: http://librarymanager/All#SparkFun_MY1690
+#include "SparkFun_MY1690_Position.h"
+
+//For boards that support software serial
+#include "SoftwareSerial.h"
+SoftwareSerial serialMP3(8, 9); //RX on Arduino connected to TX on MY1690's, TX on Arduino connected to the MY1690's RX pin
+
+//For boards that have multiple hardware serial ports
+//HardwareSerial serialMP3(2); //Create serial port on ESP32: TX on 17, RX on 16
+
+const uint8_t busyPin = 2;
+const uint8_t barWidth = 40;
+
+SparkFunMY1690 myMP3;
+MY1690PositionTracker position(myMP3);
+
+void setup()
+{
+  Serial.begin(115200);
+  Serial.println(F("MY1690 MP3 Example 8 - Progress Bar"));
+
+  serialMP3.begin(9600); //The MY1690 expects serial communication at 9600bps
+
+  if (myMP3.begin(serialMP3, busyPin) == false)
+  {
+    Serial.println(F("Device not detected. Check wiring. Freezing."));
+    while (1);
+  }
+
+  myMP3.enableBusyInterrupt(); //Optional. Without it the tracker relies on its resyncs.
+
+  position.begin(); //Takes over myMP3.onCommandCompleted(), so don't set one of your own
+  myMP3.playTrackNumber(1);
+}
+
+void loop()
+{
+  position.update(); //Also updates myMP3
+
+  if (Serial.available())
+  {
+    byte incoming = Serial.read();
+    if (incoming == 'p')
+      myMP3.submit(MP3_COMMAND_PLAY_PAUSE);
+    else if (incoming == 'f')
+      myMP3.submit(MP3_COMMAND_FASTFOWARD);
+    else if (incoming == 'r')
+      myMP3.submit(MP3_COMMAND_REWIND);
+    else if (incoming == 'n')
+      myMP3.submit(MP3_COMMAND_NEXT);
+  }
+
+  static unsigned long lastDraw = 0;
+  if (millis() - lastDraw < 16)
+    return;
+  lastDraw = millis();
+
+  uint32_t positionMs = position.getPositionMs();
+  uint16_t duration = position.getDuration();
+
+  uint8_t filled = 0;
+  if (duration > 0)
+    filled = (uint32_t)positionMs * barWidth / (duration * 1000UL);
+
+  Serial.print(F("\rTrack "));
+  Serial.print(position.getTrackNumber());
+  Serial.print(F(" ["));
+  for (uint8_t x = 0; x < barWidth; x++)
+    Serial.print(x < filled ? '#' : '-');
+  Serial.print(F("] "));
+  Serial.print(positionMs / 1000);
+  Serial.print(F("/"));
+  Serial.print(duration);
+  Serial.print(position.getPlayStatus() == 2 ? F("s paused ") : F("s        "));
+}
@@ -0,0 +1,94 @@
+/*
+  Fade background music down for an announcement and back up afterwards
+  By: SparkFun Electronics
+  Date: October 17th, 2026
+  License: MIT. See license file for more information but you can
+  basically do whatever you want with this code.
+
+  Fading with volumeDown() and delay() stalls the sketch for every step.
+  MY1690VolumeRamp works the fade out from millis() and sends a volume step
+  only when the level actually changes, all from update().
+
+  The MY1690 plays one track at a time, so the music and the announcement come
+  from two modules. announce() ducks the music module, plays the clip on the
+  announcement module, and brings the music back when the clip ends.
+
+  Send 'a' for an announcement, 'u' to fade the music up, 'd' to fade it down.
+
+  Feel like supporting our work? Buy a board from SparkFun!
+  MY1690X Serial MP3 Player Shield: https://www.sparkfun.com/sparkfun-serial-mp3-player-shield-my1690x.html
+  MY1690X Audio Player Breakout: https://www.sparkfun.com/sparkfun-audio-player-breakout-my1690x-16s.html
+
+  Hardware Connections (ESP32):
+  MY1690 Pin -> ESP32 Pin
+  -------------------------------------
+  Music TXO -> 16, RXI -> 17
+  Announcement TXO -> 26, RXI -> 25
+  VIN -> 5V
+  GND -> GND
+
+  Load some music on the music module as 0001.mp3 and a short announcement on
+  the announcement module as 0001.mp3.
+*/
+
+#include "SparkFun_MY1690_MP3_Library.h" // Click here to get the library: http://librarymanager/All#SparkFun_MY1690
+#include "SparkFun_MY1690_Ramp.h"
+
+HardwareSerial serialMusic(2); //Create serial port on ESP32: TX on 17, RX on 16
+HardwareSerial serialAnnounce(1);
+
+SparkFunMY1690 music;
+SparkFunMY1690 announcer;
+MY1690VolumeRamp fader(music);
+
+void setup()
+{
+  Serial.begin(115200);
+  Serial.println(F("MY1690 MP3 Example 9 - Duck for Announcements"));
+
+  serialMusic.begin(9600); //The MY1690 expects serial communication at 9600bps
+  serialAnnounce.begin(9600, SERIAL_8N1, 26, 25);
+
+  if (music.begin(serialMusic) == false || announcer.begin(serialAnnounce) == false)
+  {
+    Serial.println(F("Device not detected. Check wiring. Freezing."));
+    while (1);
+  }
+
+  announcer.setPlayModeNoLoop(); //Play the announcement once
+  announcer.setVolume(30);
+
+  music.setVolume(0);
+  music.setPlayModeFull();
+  music.playTrackNumber(1);
+
+  fader.begin();
+  fader.rampTo(20, 2000); //Fade the music in over two seconds
+}
+
+void loop()
+{
+  fader.update(); //Also updates both players
+
+  if (Serial.available())
+  {
+    byte incoming = Serial.read();
+    if (incoming == 'a')
+    {
+      if (fader.announce(announcer, 1, 5) == false)
+        Serial.println(F("Announcement already playing"));
+    }
+    else if (incoming == 'u')
+      fader.rampTo(25, 1000);
+    else if (incoming == 'd')
+      fader.rampTo(5, 1000, MY1690_RAMP_LOG);
+  }
+
+  static uint8_t lastLevel = 255;
+  if (fader.getLevel() != lastLevel)
+  {
+    lastLevel = fader.getLevel();
+    Serial.print(F("Music volume: "));
+    Serial.println(lastLevel);
+  }
+}
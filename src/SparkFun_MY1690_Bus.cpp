@@ -0,0 +1,197 @@
+/*!
+ * @file SparkFun_MY1690_Bus.cpp
+ * @brief  Drives several MY1690 Serial MP3 players at once
+ *
+ * SparkFun sells these at its website: www.sparkfun.com
+ *
+ * Do you like this library? Help support SparkFun. Buy a board!
+ * https://www.sparkfun.com/products/15050
+ *
+ * https://github.com/sparkfun/SparkFun_MY1690_MP3_Decoder_Arduino_Library
+ *
+ * @author SparkFun Electronics
+ * @date 2024
+ * @copyright Copyright (c) 2025, SparkFun Electronics Inc. This project is released under the MIT License.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+#include "SparkFun_MY1690_Bus.h"
+
+MY1690Bus::MY1690Bus()
+{
+}
+
+int8_t MY1690Bus::add(SparkFunMY1690 &player)
+{
+    if (_count >= MY1690_BUS_ZONES)
+        return (-1);
+
+    MY1690BusZone *zone = &_zones[_count];
+    zone->player = &player;
+    zone->bus = this;
+    zone->handle = MY1690_INVALID_HANDLE;
+    zone->status = MY1690_STATUS_INVALID;
+    zone->latencyUs = 0;
+    return (_count++);
+}
+
+uint8_t MY1690Bus::count(void)
+{
+    return (_count);
+}
+
+SparkFunMY1690 *MY1690Bus::zone(uint8_t index)
+{
+    if (index >= _count)
+        return (nullptr);
+    return (_zones[index].player);
+}
+
+void MY1690Bus::update(void)
+{
+    // Each update() only does what its serial port allows right now, so the zones overlap
+    for (uint8_t x = 0; x < _count; x++)
+        _zones[x].player->update();
+}
+
+bool MY1690Bus::submitAll(uint8_t opcode, uint16_t param, uint8_t paramLength)
+{
+    if (_pending > 0)
+        return (false);
+
+    bool accepted = true;
+    _submittedAt = micros();
+    _lastLatencyUs = 0;
+
+    for (uint8_t x = 0; x < _count; x++)
+    {
+        MY1690BusZone *zone = &_zones[x];
+        zone->latencyUs = 0;
+        zone->status = MY1690_STATUS_PENDING;
+        _pending++;
+
+        zone->handle = zone->player->submit(opcode, param, paramLength, zoneComplete, zone);
+        if (zone->handle == MY1690_INVALID_HANDLE)
+        {
+            zone->status = MY1690_STATUS_INVALID; // Queue full
+            _pending--;
+            accepted = false;
+        }
+    }
+
+    // Get the frames onto every wire before waiting on any of them
+    update();
+
+    return (accepted);
+}
+
+void MY1690Bus::zoneComplete(MY1690Handle handle, MY1690Status status, uint16_t value, void *context)
+{
+    (void)handle;
+    (void)value;
+    MY1690BusZone *zone = (MY1690BusZone *)context;
+    MY1690Bus *bus = zone->bus;
+
+    zone->status = status;
+    zone->latencyUs = micros() - bus->_submittedAt;
+
+    if (zone->latencyUs > bus->_lastLatencyUs)
+        bus->_lastLatencyUs = zone->latencyUs;
+    if (zone->latencyUs > bus->_maxLatencyUs)
+        bus->_maxLatencyUs = zone->latencyUs;
+
+    if (bus->_pending > 0)
+        bus->_pending--;
+}
+
+bool MY1690Bus::isComplete(void)
+{
+    return (_pending == 0);
+}
+
+MY1690Status MY1690Bus::waitAll(void)
+{
+    while (_pending > 0)
+    {
+        update();
+
+        // Sleep on a zone still waiting. The others' replies wake it through the UART.
+        for (uint8_t x = 0; x < _count; x++)
+        {
+            if (_zones[x].status == MY1690_STATUS_PENDING)
+            {
+                _zones[x].player->idle();
+                break;
+            }
+        }
+    }
+
+    for (uint8_t x = 0; x < _count; x++)
+    {
+        if (_zones[x].status != MY1690_STATUS_OK)
+            return ((MY1690Status)_zones[x].status);
+    }
+    return (MY1690_STATUS_OK);
+}
+
+// Blocking fan-out used by the helpers below
+bool MY1690Bus::runAll(uint8_t opcode, uint16_t param, uint8_t paramLength)
+{
+    waitAll(); // Let an earlier submitAll() finish first
+
+    bool accepted = submitAll(opcode, param, paramLength);
+    MY1690Status status = waitAll();
+    return (accepted == true && status == MY1690_STATUS_OK);
+}
+
+bool MY1690Bus::setVolumeAll(uint8_t volumeLevel)
+{
+    if (volumeLevel > 30)
+        volumeLevel = 30; // Limit to 30
+
+    return (runAll(MP3_COMMAND_SET_VOLUME, volumeLevel, 1));
+}
+
+bool MY1690Bus::stopAll(void)
+{
+    return (runAll(MP3_COMMAND_STOP, 0, 0));
+}
+
+bool MY1690Bus::pauseAll(void)
+{
+    return (runAll(MP3_COMMAND_PAUSE, 0, 0));
+}
+
+bool MY1690Bus::playTrackNumberAll(uint16_t trackNumber)
+{
+    return (runAll(MP3_COMMAND_SELECT_TRACK_PLAY, trackNumber, 2));
+}
+
+MY1690Status MY1690Bus::getZoneStatus(uint8_t index)
+{
+    if (index >= _count)
+        return (MY1690_STATUS_INVALID);
+    return ((MY1690Status)_zones[index].status);
+}
+
+unsigned long MY1690Bus::getZoneLatencyUs(uint8_t index)
+{
+    if (index >= _count)
+        return (0);
+    return (_zones[index].latencyUs);
+}
+
+unsigned long MY1690Bus::getLastLatencyUs(void)
+{
+    return (_lastLatencyUs);
+}
+
+unsigned long MY1690Bus::getMaxLatencyUs(void)
+{
+    return (_maxLatencyUs);
+}
+
+void MY1690Bus::resetLatency(void)
+{
+    _maxLatencyUs = 0;
+}
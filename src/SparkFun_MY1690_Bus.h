@@ -0,0 +1,159 @@
+/*!
+ * @file SparkFun_MY1690_Bus.h
+ * @brief  Drives several MY1690 Serial MP3 players at once
+ *
+ * SparkFun sells these at its website: www.sparkfun.com
+ *
+ * Do you like this library? Help support SparkFun. Buy a board!
+ * https://www.sparkfun.com/products/15050
+ *
+ * https://github.com/sparkfun/SparkFun_MY1690_MP3_Decoder_Arduino_Library
+ *
+ * @author SparkFun Electronics
+ * @date 2024
+ * @copyright Copyright (c) 2025, SparkFun Electronics Inc. This project is released under the MIT License.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef SPARKFUN_MY1690_BUS_H
+#define SPARKFUN_MY1690_BUS_H
+
+#include "SparkFun_MY1690_MP3_Library.h"
+
+// Number of players a bus can drive
+#ifndef MY1690_BUS_ZONES
+#define MY1690_BUS_ZONES 8
+#endif
+
+class MY1690Bus;
+
+typedef struct
+{
+    SparkFunMY1690 *player;
+    MY1690Bus *bus; // Lets the completion callback find its way back
+    MY1690Handle handle;
+    uint8_t status; // MY1690Status of the last command sent to all zones
+    unsigned long latencyUs;
+} MY1690BusZone;
+
+/*!
+ * @class MY1690Bus
+ * @brief Fans commands out to several players, each on its own serial port, and services them together.
+ *
+ * Each player keeps its own queue. The bus submits the same command to every one of
+ * them and then calls update() on all of them in turn, so the round trips overlap and
+ * a command to every zone takes about as long as one round trip to the slowest zone.
+ */
+class MY1690Bus
+{
+  public:
+    MY1690Bus();
+
+    /**
+     * @brief Adds a player to the bus.
+     *
+     * @param player A player that begin() has been called on.
+     *
+     * @return The zone number of the player, or -1 if the bus is full.
+     */
+    int8_t add(SparkFunMY1690 &player);
+    /**
+     * @brief Returns the number of zones.
+     */
+    uint8_t count(void);
+    /**
+     * @brief Returns the player of a zone, or nullptr if the zone does not exist.
+     */
+    SparkFunMY1690 *zone(uint8_t index);
+
+    /**
+     * @brief Calls update() on every player. Call this often from loop().
+     */
+    void update(void);
+
+    /**
+     * @brief Queues the same command on every player and returns immediately.
+     *
+     * @param opcode One of the MP3_COMMAND_ values.
+     * @param param Parameter for the command. Two byte parameters are sent MSB first.
+     * @param paramLength Number of parameter bytes to send, 0 to 2.
+     *
+     * @return false if the previous command to all zones is still pending, or a player's queue is full.
+     *         The zones that did accept the command still run it.
+     */
+    bool submitAll(uint8_t opcode, uint16_t param = 0, uint8_t paramLength = 0);
+    /**
+     * @brief Returns true once every zone has completed the last command from submitAll().
+     */
+    bool isComplete(void);
+    /**
+     * @brief Calls update() until every zone has completed the last command from submitAll().
+     *
+     * Between updates it sleeps in the idle() of a zone that is still waiting.
+     *
+     * @return MY1690_STATUS_OK if every zone succeeded, otherwise the first failure found.
+     */
+    MY1690Status waitAll(void);
+
+    /**
+     * @brief Sets every zone to the same volume and waits for all of them.
+     *
+     * @param volumeLevel The desired volume level (0-30).
+     * @return true if every zone accepted it.
+     */
+    bool setVolumeAll(uint8_t volumeLevel);
+    /**
+     * @brief Stops every zone and waits for all of them.
+     *
+     * @return true if every zone accepted it.
+     */
+    bool stopAll(void);
+    /**
+     * @brief Pauses every zone and waits for all of them.
+     *
+     * @return true if every zone accepted it.
+     */
+    bool pauseAll(void);
+    /**
+     * @brief Starts the same track on every zone and waits for all of them.
+     *
+     * @param trackNumber The track number to play (1-based index).
+     * @return true if every zone accepted it.
+     */
+    bool playTrackNumberAll(uint16_t trackNumber);
+
+    /**
+     * @brief Returns the status of one zone for the last command from submitAll().
+     */
+    MY1690Status getZoneStatus(uint8_t index);
+    /**
+     * @brief Returns how long one zone took to complete the last command from submitAll(), in microseconds.
+     */
+    unsigned long getZoneLatencyUs(uint8_t index);
+    /**
+     * @brief Returns the time the slowest zone took to complete the last command from submitAll().
+     */
+    unsigned long getLastLatencyUs(void);
+    /**
+     * @brief Returns the worst latency of any zone since the bus was created or resetLatency() was called.
+     */
+    unsigned long getMaxLatencyUs(void);
+    /**
+     * @brief Clears the worst latency.
+     */
+    void resetLatency(void);
+
+  protected:
+    MY1690BusZone _zones[MY1690_BUS_ZONES];
+    uint8_t _count = 0;
+    uint8_t _pending = 0; // Zones still working on the last command
+    unsigned long _submittedAt = 0;
+    unsigned long _lastLatencyUs = 0;
+    unsigned long _maxLatencyUs = 0;
+
+    bool runAll(uint8_t opcode, uint16_t param, uint8_t paramLength);
+    static void zoneComplete(MY1690Handle handle, MY1690Status status, uint16_t value, void *context);
+};
+
+#endif
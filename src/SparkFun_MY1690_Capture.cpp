@@ -0,0 +1,339 @@
+/*!
+ * @file SparkFun_MY1690_Capture.cpp
+ * @brief  Records the serial traffic to and from the MY1690 Serial MP3 player and plays it back
+ *
+ * SparkFun sells these at its website: www.sparkfun.com
+ *
+ * Do you like this library? Help support SparkFun. Buy a board!
+ * https://www.sparkfun.com/products/15050
+ *
+ * https://github.com/sparkfun/SparkFun_MY1690_MP3_Decoder_Arduino_Library
+ *
+ * @author SparkFun Electronics
+ * @date 2024
+ * @copyright Copyright (c) 2025, SparkFun Electronics Inc. This project is released under the MIT License.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+#include "SparkFun_MY1690_Capture.h"
+
+MY1690Capture::MY1690Capture(Stream &port)
+{
+    _port = &port;
+}
+
+void MY1690Capture::start(void)
+{
+    _capturing = true;
+}
+
+void MY1690Capture::stop(void)
+{
+    _capturing = false;
+}
+
+bool MY1690Capture::isCapturing(void)
+{
+    return (_capturing);
+}
+
+void MY1690Capture::clear(void)
+{
+    _head = 0;
+    _count = 0;
+    _dropped = 0;
+}
+
+uint16_t MY1690Capture::count(void)
+{
+    return (_count);
+}
+
+uint32_t MY1690Capture::getDropped(void)
+{
+    return (_dropped);
+}
+
+bool MY1690Capture::getEntry(uint16_t index, MY1690CaptureEntry &entry)
+{
+    if (index >= _count)
+        return (false);
+
+    uint16_t x = (_head + index) % MY1690_CAPTURE_ENTRIES;
+    entry.timeUs = _times[x];
+    entry.value = _values[x];
+    entry.transmitted = (_transmitted[x / 8] & (1 << (x % 8))) != 0;
+    return (true);
+}
+
+void MY1690Capture::record(uint8_t value, bool transmitted, uint32_t now)
+{
+    if (_capturing == false)
+        return;
+
+    uint16_t x;
+    if (_count < MY1690_CAPTURE_ENTRIES)
+        x = (_head + _count++) % MY1690_CAPTURE_ENTRIES;
+    else
+    {
+        // Full, so the oldest byte goes
+        x = _head;
+        _head = (_head + 1) % MY1690_CAPTURE_ENTRIES;
+        _dropped++;
+    }
+
+    _times[x] = now;
+    _values[x] = value;
+    if (transmitted == true)
+        _transmitted[x / 8] |= (1 << (x % 8));
+    else
+        _transmitted[x / 8] &= ~(1 << (x % 8));
+}
+
+void MY1690Capture::dumpText(Print &out)
+{
+    MY1690CaptureEntry entry;
+    bool lineOpen = false;
+    bool lastTransmitted = false;
+    uint8_t lastValue = 0;
+
+    for (uint16_t x = 0; getEntry(x, entry) == true; x++)
+    {
+        // A line per frame sent and per line received
+        bool newLine = lineOpen == false || entry.transmitted != lastTransmitted;
+        if (entry.transmitted == true && entry.value == MP3_START_CODE)
+            newLine = true;
+        if (entry.transmitted == false && lastValue == '\n')
+            newLine = true;
+
+        if (newLine == true)
+        {
+            if (lineOpen == true)
+                out.println();
+            out.print(entry.timeUs);
+            out.print(entry.transmitted ? F(" >") : F(" <"));
+            lineOpen = true;
+        }
+
+        out.print(entry.value < 0x10 ? F(" 0") : F(" "));
+        out.print(entry.value, HEX);
+
+        lastTransmitted = entry.transmitted;
+        lastValue = entry.value;
+    }
+    if (lineOpen == true)
+        out.println();
+}
+
+size_t MY1690Capture::dumpBinary(Print &out)
+{
+    size_t written = out.write((const uint8_t *)MY1690_CAPTURE_MAGIC, MY1690_CAPTURE_MAGIC_LENGTH);
+
+    MY1690CaptureEntry entry;
+    uint32_t previous = 0;
+    for (uint16_t x = 0; getEntry(x, entry) == true; x++)
+    {
+        if (x == 0)
+            previous = entry.timeUs; // Times start from the first byte
+
+        uint32_t delta = entry.timeUs - previous;
+        if (delta > 0x7FFFFFFF)
+            delta = 0x7FFFFFFF; // Leave room for the direction bit
+        previous = entry.timeUs;
+
+        uint32_t field = (delta << 1) | (entry.transmitted ? 1 : 0);
+        do
+        {
+            uint8_t digit = field & 0x7F;
+            field >>= 7;
+            if (field != 0)
+                digit |= 0x80; // More to come
+            written += out.write(digit);
+        } while (field != 0);
+
+        written += out.write(entry.value);
+    }
+    return (written);
+}
+
+int MY1690Capture::available()
+{
+    return (_port->available());
+}
+
+int MY1690Capture::read()
+{
+    int value = _port->read();
+    if (value >= 0)
+        record(value, false, micros());
+    return (value);
+}
+
+int MY1690Capture::peek()
+{
+    return (_port->peek());
+}
+
+void MY1690Capture::flush()
+{
+    _port->flush();
+}
+
+size_t MY1690Capture::write(uint8_t value)
+{
+    record(value, true, micros());
+    return (_port->write(value));
+}
+
+size_t MY1690Capture::write(const uint8_t *buffer, size_t size)
+{
+    // The whole frame is stamped with the time it was handed over
+    uint32_t now = micros();
+    for (size_t x = 0; x < size; x++)
+        record(buffer[x], true, now);
+    return (_port->write(buffer, size));
+}
+
+MY1690Replay::MY1690Replay(const uint8_t *capture, size_t length)
+{
+    _capture = capture;
+    _length = length;
+}
+
+bool MY1690Replay::begin(void)
+{
+    _receive.valid = false;
+    _transmit.valid = false;
+    if (_length < MY1690_CAPTURE_MAGIC_LENGTH ||
+        memcmp(_capture, MY1690_CAPTURE_MAGIC, MY1690_CAPTURE_MAGIC_LENGTH) != 0)
+        return (false);
+
+    Cursor start;
+    start.offset = MY1690_CAPTURE_MAGIC_LENGTH;
+    start.timeUs = 0;
+    start.transmitted = false;
+    start.valid = false;
+    start.sentBefore = 0;
+    decode(start);
+
+    _receive = start;
+    seek(_receive, false);
+    _transmit = start;
+    seek(_transmit, true);
+
+    _written = 0;
+    _matched = 0;
+    _mismatched = 0;
+    _anchorCaptured = start.timeUs;
+    _anchorActual = micros();
+    return (true);
+}
+
+// Move a cursor on to the next entry in the capture
+void MY1690Replay::decode(Cursor &cursor)
+{
+    if (cursor.valid == true && cursor.transmitted == true)
+        cursor.sentBefore++;
+    cursor.valid = false;
+
+    uint32_t field = 0;
+    uint8_t shift = 0;
+    while (cursor.offset < _length)
+    {
+        uint8_t digit = _capture[cursor.offset++];
+        field |= (uint32_t)(digit & 0x7F) << shift;
+        shift += 7;
+        if ((digit & 0x80) == 0)
+        {
+            if (cursor.offset >= _length)
+                return; // Cut off before the byte itself
+
+            cursor.timeUs += field >> 1;
+            cursor.transmitted = (field & 1) != 0;
+            cursor.value = _capture[cursor.offset++];
+            cursor.valid = true;
+            return;
+        }
+        if (shift > 28)
+            return; // Corrupt
+    }
+}
+
+// Move a cursor on until it reaches an entry going the given way
+void MY1690Replay::seek(Cursor &cursor, bool transmitted)
+{
+    while (cursor.valid == true && cursor.transmitted != transmitted)
+        decode(cursor);
+}
+
+// The next received byte is due once the frame before it has been written, and as long
+// after that frame as it came in the capture
+bool MY1690Replay::receiveDue(void)
+{
+    if (_receive.valid == false || _written < _receive.sentBefore)
+        return (false);
+
+    uint32_t elapsed = micros() - _anchorActual;
+    uint32_t wait = _receive.timeUs - _anchorCaptured;
+    return ((int32_t)(elapsed - wait) >= 0);
+}
+
+bool MY1690Replay::isComplete(void)
+{
+    return (_receive.valid == false && _transmit.valid == false);
+}
+
+uint32_t MY1690Replay::getMatchCount(void)
+{
+    return (_matched);
+}
+
+uint32_t MY1690Replay::getMismatchCount(void)
+{
+    return (_mismatched);
+}
+
+int MY1690Replay::available()
+{
+    return (receiveDue() ? 1 : 0);
+}
+
+int MY1690Replay::read()
+{
+    if (receiveDue() == false)
+        return (-1);
+
+    uint8_t value = _receive.value;
+    decode(_receive);
+    seek(_receive, false);
+    return (value);
+}
+
+int MY1690Replay::peek()
+{
+    if (receiveDue() == false)
+        return (-1);
+    return (_receive.value);
+}
+
+size_t MY1690Replay::write(uint8_t value)
+{
+    _written++;
+    _anchorActual = micros();
+
+    if (_transmit.valid == false)
+    {
+        _mismatched++; // Past the end of the capture
+        return (1);
+    }
+
+    if (value == _transmit.value)
+        _matched++;
+    else
+        _mismatched++;
+
+    _anchorCaptured = _transmit.timeUs;
+    decode(_transmit);
+    seek(_transmit, true);
+    return (1);
+}
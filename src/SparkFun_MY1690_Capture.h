@@ -0,0 +1,208 @@
+/*!
+ * @file SparkFun_MY1690_Capture.h
+ * @brief  Records the serial traffic to and from the MY1690 Serial MP3 player and plays it back
+ *
+ * SparkFun sells these at its website: www.sparkfun.com
+ *
+ * Do you like this library? Help support SparkFun. Buy a board!
+ * https://www.sparkfun.com/products/15050
+ *
+ * https://github.com/sparkfun/SparkFun_MY1690_MP3_Decoder_Arduino_Library
+ *
+ * @author SparkFun Electronics
+ * @date 2024
+ * @copyright Copyright (c) 2025, SparkFun Electronics Inc. This project is released under the MIT License.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef SPARKFUN_MY1690_CAPTURE_H
+#define SPARKFUN_MY1690_CAPTURE_H
+
+#include "SparkFun_MY1690_MP3_Library.h"
+
+// Bytes a capture holds before the oldest are overwritten. Each takes a little over 5 bytes of RAM.
+#ifndef MY1690_CAPTURE_ENTRIES
+#define MY1690_CAPTURE_ENTRIES 128
+#endif
+
+#define MY1690_CAPTURE_MAGIC "MYC1" // Start of a binary capture
+#define MY1690_CAPTURE_MAGIC_LENGTH 4
+
+/*!
+ * @brief One byte that crossed the serial link.
+ */
+typedef struct
+{
+    uint32_t timeUs;  // micros() when it was written or read
+    uint8_t value;    // The byte
+    bool transmitted; // true if it was sent to the MY1690, false if read from it
+} MY1690CaptureEntry;
+
+/*!
+ * @class MY1690Capture
+ * @brief A Stream that sits between the player and its serial port and records every byte.
+ *
+ * Pass it to the player's begin() in place of the port. Each frame is stamped with
+ * micros() as it is handed to the port, and each reply byte as the library reads it, so
+ * the record shows both what crossed the link and when the library saw it. The last
+ * MY1690_CAPTURE_ENTRIES bytes are kept.
+ */
+class MY1690Capture : public Stream
+{
+  public:
+    /**
+     * @brief Creates a capture that passes everything through to a port.
+     *
+     * @param port The serial port the MY1690 is connected to.
+     */
+    MY1690Capture(Stream &port);
+
+    /**
+     * @brief Starts recording. Recording is on from construction.
+     */
+    void start(void);
+    /**
+     * @brief Stops recording. Bytes still pass through.
+     */
+    void stop(void);
+    /**
+     * @brief Returns true while recording.
+     */
+    bool isCapturing(void);
+    /**
+     * @brief Empties the record.
+     */
+    void clear(void);
+    /**
+     * @brief Returns the number of bytes in the record.
+     */
+    uint16_t count(void);
+    /**
+     * @brief Returns the number of bytes overwritten because the record was full.
+     */
+    uint32_t getDropped(void);
+    /**
+     * @brief Reads one byte of the record.
+     *
+     * @param index 0 for the oldest byte kept.
+     * @param entry Filled in.
+     *
+     * @return false if index is past the end.
+     */
+    bool getEntry(uint16_t index, MY1690CaptureEntry &entry);
+
+    /**
+     * @brief Prints the record one line per burst: time in microseconds, '>' for sent or '<' for received, then the bytes in hex.
+     */
+    void dumpText(Print &out);
+    /**
+     * @brief Writes the record in the compact binary form MY1690Replay reads.
+     *
+     * MY1690_CAPTURE_MAGIC, then for each byte the time since the one before, in microseconds,
+     * shifted left one with the direction in bit 0 (1 for sent), as a little-endian base 128
+     * varint, followed by the byte itself. About three bytes per byte captured at 9600bps.
+     *
+     * @return The number of bytes written.
+     */
+    size_t dumpBinary(Print &out);
+
+    int available() override;
+    int read() override;
+    int peek() override;
+    void flush() override;
+    size_t write(uint8_t value) override;
+    size_t write(const uint8_t *buffer, size_t size) override;
+    using Print::write;
+
+  protected:
+    Stream *_port;
+    bool _capturing = true;
+
+    uint32_t _times[MY1690_CAPTURE_ENTRIES];
+    uint8_t _values[MY1690_CAPTURE_ENTRIES];
+    uint8_t _transmitted[(MY1690_CAPTURE_ENTRIES + 7) / 8]; // Bit per entry
+    uint16_t _head = 0;                                     // Oldest entry
+    uint16_t _count = 0;
+    uint32_t _dropped = 0;
+
+    void record(uint8_t value, bool transmitted, uint32_t now);
+};
+
+/*!
+ * @class MY1690Replay
+ * @brief A Stream that plays a binary capture back to the player in place of a MY1690.
+ *
+ * Received bytes are released with the timing they were captured with, measured from the
+ * frame that came before them, so the device's response times are reproduced however fast
+ * or slow the library runs. Bytes that followed a frame are held until the library has
+ * written that frame. What the library writes is compared with the frames in the capture.
+ * testing/host/my1690_replay.cpp does this on a PC with a capture saved to a file.
+ */
+class MY1690Replay : public Stream
+{
+  public:
+    /**
+     * @brief Creates a replay of a capture written by MY1690Capture::dumpBinary().
+     *
+     * @param capture The capture. Must stay valid while the replay runs.
+     * @param length Size of the capture in bytes.
+     */
+    MY1690Replay(const uint8_t *capture, size_t length);
+
+    /**
+     * @brief Starts the replay from the beginning, with the time of the first byte as now.
+     *
+     * @return false if the capture does not start with MY1690_CAPTURE_MAGIC.
+     */
+    bool begin(void);
+    /**
+     * @brief Returns true once every byte in the capture has been sent or read.
+     */
+    bool isComplete(void);
+    /**
+     * @brief Returns the number of bytes written that matched the capture.
+     */
+    uint32_t getMatchCount(void);
+    /**
+     * @brief Returns the number of bytes written that differed from the capture, or came after its end.
+     */
+    uint32_t getMismatchCount(void);
+
+    int available() override;
+    int read() override;
+    int peek() override;
+    size_t write(uint8_t value) override;
+    using Print::write;
+
+  protected:
+    // A position in the capture
+    typedef struct
+    {
+        size_t offset;       // Next byte of the capture to decode
+        uint32_t timeUs;     // Capture time of this entry
+        uint8_t value;
+        bool transmitted;
+        bool valid;          // false past the end
+        uint32_t sentBefore; // Sent entries before this one
+    } Cursor;
+
+    const uint8_t *_capture;
+    size_t _length;
+
+    Cursor _receive;  // Next byte to hand to the library
+    Cursor _transmit; // Next byte the library is expected to write
+    uint32_t _written = 0;
+
+    uint32_t _anchorCaptured = 0; // Capture time of the last frame byte written...
+    uint32_t _anchorActual = 0;   // ...and when the library actually wrote it
+
+    uint32_t _matched = 0;
+    uint32_t _mismatched = 0;
+
+    void decode(Cursor &cursor);
+    void seek(Cursor &cursor, bool transmitted);
+    bool receiveDue(void);
+};
+
+#endif
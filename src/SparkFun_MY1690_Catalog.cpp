@@ -0,0 +1,287 @@
+/*!
+ * @file SparkFun_MY1690_Catalog.cpp
+ * @brief  Background catalog of track names and folder counts for the MY1690 Serial MP3 player
+ *
+ * SparkFun sells these at its website: www.sparkfun.com
+ *
+ * Do you like this library? Help support SparkFun. Buy a board!
+ * https://www.sparkfun.com/products/15050
+ *
+ * https://github.com/sparkfun/SparkFun_MY1690_MP3_Decoder_Arduino_Library
+ *
+ * @author SparkFun Electronics
+ * @date 2024
+ * @copyright Copyright (c) 2025, SparkFun Electronics Inc. This project is released under the MIT License.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+#include "SparkFun_MY1690_Catalog.h"
+
+MY1690Catalog::MY1690Catalog(SparkFunMY1690 &player)
+{
+    _player = &player;
+    invalidate();
+}
+
+void MY1690Catalog::invalidate(void)
+{
+    for (uint8_t x = 0; x < MY1690_CATALOG_TRACKS; x++)
+        _entries[x].track = 0;
+    _nextEntry = 0;
+
+    for (uint8_t x = 0; x < MY1690_CATALOG_FOLDERS; x++)
+        _folderCount[x] = MY1690_CATALOG_UNKNOWN;
+    _folderStart[0] = 0;
+    _nextFolder = 0;
+    _folderAttempts = 0;
+    _indexIncomplete = false;
+
+    _currentTrack = 0;
+    _checkTrack = true;
+
+    // Forget any query still in the player's queue, so its reply can't land in the new catalog
+    _query = MY1690_INVALID_HANDLE;
+}
+
+void MY1690Catalog::update(void)
+{
+    _player->update();
+
+    // A new track has started. Its number, and maybe its name, is worth reading.
+    if (_player->isBusyInterruptEnabled() == true)
+    {
+        uint16_t started = _player->getTracksStarted();
+        if (started != _startedSeen)
+        {
+            _startedSeen = started;
+            _checkTrack = true;
+        }
+    }
+    else if (millis() - _lastPoll >= MY1690_CATALOG_POLL_INTERVAL_MS)
+    {
+        _checkTrack = true; // No busy pin to tell us, so look now and then
+    }
+
+    // Only fill in the catalog while the sketch isn't using the player
+    if (_query != MY1690_INVALID_HANDLE || _player->commandsPending() > 0)
+        return;
+
+    if (_checkTrack == true)
+    {
+        _checkTrack = false;
+        _lastPoll = millis();
+        if (_player->isBusyInterruptEnabled() == true)
+            _query = _player->submit(MP3_COMMAND_GET_CURRENT_TRACK, 0, 0, trackNumberReady, this);
+        else
+            _query = _player->submit(MP3_COMMAND_GET_STATUS, 0, 0, playStatusReady, this); // Stopped or paused is no news
+    }
+    else if (_indexIncomplete == false && _nextFolder < MY1690_CATALOG_FOLDERS)
+    {
+        _queryFolder = _nextFolder;
+        _query = _player->submit(MP3_COMMAND_GET_SONGS_IN_FOLDER_COUNT, _queryFolder, 1, folderCountReady, this);
+    }
+}
+
+// True if a reply is to our outstanding query, which is then done with
+bool MY1690Catalog::takeReply(MY1690Handle handle)
+{
+    if (handle == MY1690_INVALID_HANDLE || handle != _query)
+        return (false); // Sent before invalidate()
+    _query = MY1690_INVALID_HANDLE;
+    return (true);
+}
+
+void MY1690Catalog::folderCountReady(MY1690Handle handle, MY1690Status status, uint16_t value, void *context)
+{
+    MY1690Catalog *catalog = (MY1690Catalog *)context;
+    if (catalog->takeReply(handle) == false)
+        return;
+
+    // Counts are only kept in folder order
+    uint8_t folder = catalog->_queryFolder;
+    if (folder != catalog->_nextFolder || folder >= MY1690_CATALOG_FOLDERS)
+        return;
+
+    // A failure leaves the folder to be asked again, a few times. A module that keeps failing
+    // would otherwise be reset by the player over and over, in the background.
+    if (status != MY1690_STATUS_OK)
+    {
+        if (status != MY1690_STATUS_CANCELLED && ++catalog->_folderAttempts >= MY1690_CATALOG_FOLDER_ATTEMPTS)
+            catalog->_indexIncomplete = true;
+        return;
+    }
+
+    catalog->_folderCount[folder] = value;
+    catalog->_folderStart[folder + 1] = catalog->_folderStart[folder] + value;
+    catalog->_nextFolder++;
+    catalog->_folderAttempts = 0;
+}
+
+void MY1690Catalog::playStatusReady(MY1690Handle handle, MY1690Status status, uint16_t value, void *context)
+{
+    MY1690Catalog *catalog = (MY1690Catalog *)context;
+    if (catalog->takeReply(handle) == false)
+        return;
+
+    // Fast forward and rewind are playing too
+    if (status != MY1690_STATUS_OK || value == 0 || value == 2)
+        return;
+
+    catalog->_query = catalog->_player->submit(MP3_COMMAND_GET_CURRENT_TRACK, 0, 0, trackNumberReady, catalog);
+}
+
+void MY1690Catalog::trackNumberReady(MY1690Handle handle, MY1690Status status, uint16_t value, void *context)
+{
+    MY1690Catalog *catalog = (MY1690Catalog *)context;
+    if (catalog->takeReply(handle) == false)
+        return;
+
+    if (status != MY1690_STATUS_OK || value == 0)
+        return;
+
+    catalog->_currentTrack = value;
+    if (catalog->find(value) != nullptr)
+        return; // Already named
+
+    // Ask for the name straight away, before the track can change
+    catalog->_query = catalog->_player->submit(MP3_COMMAND_GET_CURRENT_TRACK_NAME, 0, 0, trackNameReady, catalog);
+}
+
+void MY1690Catalog::trackNameReady(MY1690Handle handle, MY1690Status status, uint16_t value, void *context)
+{
+    MY1690Catalog *catalog = (MY1690Catalog *)context;
+    if (catalog->takeReply(handle) == false)
+        return;
+
+    // The reply text is only valid until the next command goes out
+    if (status == MY1690_STATUS_OK && value > 0)
+        catalog->storeName(catalog->_player->getResponseString());
+}
+
+void MY1690Catalog::storeName(const char *name)
+{
+    MY1690CatalogEntry *entry = nullptr;
+    for (uint8_t x = 0; x < MY1690_CATALOG_TRACKS; x++)
+    {
+        if (_entries[x].track == 0)
+        {
+            entry = &_entries[x];
+            break;
+        }
+    }
+
+    // Table is full. Replace the oldest name.
+    if (entry == nullptr)
+    {
+        entry = &_entries[_nextEntry];
+        _nextEntry = (_nextEntry + 1) % MY1690_CATALOG_TRACKS;
+    }
+
+    entry->track = _currentTrack;
+    strncpy(entry->name, name, MY1690_CATALOG_NAME_SIZE - 1);
+    entry->name[MY1690_CATALOG_NAME_SIZE - 1] = '\0';
+}
+
+MY1690CatalogEntry *MY1690Catalog::find(uint16_t trackNumber)
+{
+    for (uint8_t x = 0; x < MY1690_CATALOG_TRACKS; x++)
+    {
+        if (_entries[x].track == trackNumber)
+            return (&_entries[x]);
+    }
+    return (nullptr);
+}
+
+const char *MY1690Catalog::getTrackName(uint16_t trackNumber)
+{
+    if (trackNumber == 0)
+        return (nullptr);
+
+    MY1690CatalogEntry *entry = find(trackNumber);
+    if (entry == nullptr)
+        return (nullptr);
+    return (entry->name);
+}
+
+uint16_t MY1690Catalog::getSongsInFolderCount(uint8_t folder)
+{
+    if (folder >= MY1690_CATALOG_FOLDERS)
+        return (MY1690_CATALOG_UNKNOWN);
+    return (_folderCount[folder]);
+}
+
+bool MY1690Catalog::buildIndex(uint16_t timeoutMs)
+{
+    unsigned long startTime = millis();
+    while (foldersComplete() == false)
+    {
+        if (_indexIncomplete == true || millis() - startTime > timeoutMs)
+            return (false);
+        update();
+        _player->idle();
+    }
+    return (true);
+}
+
+uint16_t MY1690Catalog::getTrackNumber(uint8_t folder, uint16_t index)
+{
+    if (folder >= _nextFolder || index == 0 || index > _folderCount[folder])
+        return (0);
+    return (_folderStart[folder] + index);
+}
+
+bool MY1690Catalog::getFolderIndex(uint16_t trackNumber, uint8_t &folder, uint16_t &index)
+{
+    if (trackNumber == 0 || trackNumber > _folderStart[_nextFolder])
+        return (false);
+
+    // Last folder that starts before the track. Empty folders share a start with the next.
+    uint8_t low = 0;
+    uint8_t high = _nextFolder - 1;
+    while (low < high)
+    {
+        uint8_t middle = (low + high + 1) / 2;
+        if (_folderStart[middle] < trackNumber)
+            low = middle;
+        else
+            high = middle - 1;
+    }
+
+    folder = low;
+    index = trackNumber - _folderStart[low];
+    return (true);
+}
+
+uint16_t MY1690Catalog::getIndexedTrackCount(void)
+{
+    return (_folderStart[_nextFolder]);
+}
+
+MY1690Handle MY1690Catalog::playFolderTrack(uint8_t folder, uint16_t index)
+{
+    uint16_t trackNumber = getTrackNumber(folder, index);
+    if (trackNumber == 0)
+        return (MY1690_INVALID_HANDLE);
+    return (_player->submit(MP3_COMMAND_SELECT_TRACK_PLAY, trackNumber, 2));
+}
+
+uint8_t MY1690Catalog::getTrackNameCount(void)
+{
+    uint8_t count = 0;
+    for (uint8_t x = 0; x < MY1690_CATALOG_TRACKS; x++)
+    {
+        if (_entries[x].track != 0)
+            count++;
+    }
+    return (count);
+}
+
+bool MY1690Catalog::foldersComplete(void)
+{
+    return (_nextFolder >= MY1690_CATALOG_FOLDERS);
+}
+
+bool MY1690Catalog::indexIncomplete(void)
+{
+    return (_indexIncomplete);
+}
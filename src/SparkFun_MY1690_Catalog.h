@@ -0,0 +1,183 @@
+/*!
+ * @file SparkFun_MY1690_Catalog.h
+ * @brief  Background catalog of track names and folder counts for the MY1690 Serial MP3 player
+ *
+ * SparkFun sells these at its website: www.sparkfun.com
+ *
+ * Do you like this library? Help support SparkFun. Buy a board!
+ * https://www.sparkfun.com/products/15050
+ *
+ * https://github.com/sparkfun/SparkFun_MY1690_MP3_Decoder_Arduino_Library
+ *
+ * @author SparkFun Electronics
+ * @date 2024
+ * @copyright Copyright (c) 2025, SparkFun Electronics Inc. This project is released under the MIT License.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef SPARKFUN_MY1690_CATALOG_H
+#define SPARKFUN_MY1690_CATALOG_H
+
+#include "SparkFun_MY1690_MP3_Library.h"
+
+// Number of track names the catalog remembers. The oldest is replaced when it is full.
+#ifndef MY1690_CATALOG_TRACKS
+#define MY1690_CATALOG_TRACKS 16
+#endif
+
+// Number of folders, starting at 0, whose song counts are collected
+#ifndef MY1690_CATALOG_FOLDERS
+#define MY1690_CATALOG_FOLDERS 10
+#endif
+
+// Times a folder count is asked for before the index is left incomplete
+#ifndef MY1690_CATALOG_FOLDER_ATTEMPTS
+#define MY1690_CATALOG_FOLDER_ATTEMPTS 3
+#endif
+
+#define MY1690_CATALOG_NAME_SIZE 13          // An 8.3 name and null
+#define MY1690_CATALOG_UNKNOWN 0xFFFF        // Folder count not collected yet
+#define MY1690_CATALOG_POLL_INTERVAL_MS 1000 // How often to check what is playing without the busy interrupt
+#define MY1690_CATALOG_INDEX_TIMEOUT_MS 2000 // Default time buildIndex() waits for the folder counts
+
+typedef struct
+{
+    uint16_t track; // 0 while the slot is free
+    char name[MY1690_CATALOG_NAME_SIZE];
+} MY1690CatalogEntry;
+
+/*!
+ * @class MY1690Catalog
+ * @brief Collects track names and folder song counts while the player is idle.
+ *
+ * The MY1690 can only report the name of the track it is playing, so names are
+ * learned as tracks play: each time the current track changes its name is read once
+ * and kept. Without the busy interrupt the play status is polled instead, and the
+ * track is only read while one is playing. Folder counts are read one folder per idle
+ * moment. Queries are only submitted when the player's queue is empty, so they never
+ * hold up the sketch's own commands, and reading the catalog never touches the serial port.
+ *
+ * The folder counts are kept as running totals, so a clip in a folder is turned into
+ * the player's track number with one addition. This takes the MY1690 to number tracks
+ * folder by folder, as it does when each folder's files were copied to the card in turn.
+ */
+class MY1690Catalog
+{
+  public:
+    /**
+     * @brief Creates a catalog for a player.
+     *
+     * @param player A player that begin() has been called on.
+     */
+    MY1690Catalog(SparkFunMY1690 &player);
+
+    /**
+     * @brief Collects the next missing piece of the catalog. Calls the player's update(), so call this instead of it.
+     */
+    void update(void);
+
+    /**
+     * @brief Returns the name of a track, without a serial round trip.
+     *
+     * @param trackNumber The track number (1-based index).
+     *
+     * @return The name, or nullptr if the track has not been seen playing yet.
+     */
+    const char *getTrackName(uint16_t trackNumber);
+    /**
+     * @brief Returns the number of songs in a folder, without a serial round trip.
+     *
+     * @param folder Folder number, below MY1690_CATALOG_FOLDERS.
+     *
+     * @return The count, or MY1690_CATALOG_UNKNOWN if it has not been collected yet.
+     */
+    uint16_t getSongsInFolderCount(uint8_t folder);
+    /**
+     * @brief Collects the folder counts now, blocking, rather than as the player idles.
+     *
+     * @param timeoutMs How long to wait for them.
+     *
+     * @return true once every folder count has been collected, false at once if indexIncomplete().
+     */
+    bool buildIndex(uint16_t timeoutMs = MY1690_CATALOG_INDEX_TIMEOUT_MS);
+    /**
+     * @brief Returns the track number of a clip in a folder, without a serial round trip.
+     *
+     * @param folder Folder number, below MY1690_CATALOG_FOLDERS.
+     * @param index Clip in the folder (1-based index).
+     *
+     * @return The track number for playTrackNumber(), or 0 if the folder has not been counted or has fewer clips.
+     */
+    uint16_t getTrackNumber(uint8_t folder, uint16_t index);
+    /**
+     * @brief Finds the folder and clip of a track number.
+     *
+     * @param trackNumber The track number (1-based index).
+     * @param folder Set to the folder the track is in.
+     * @param index Set to the clip in the folder (1-based index).
+     *
+     * @return false if the track is past the folders counted so far.
+     */
+    bool getFolderIndex(uint16_t trackNumber, uint8_t &folder, uint16_t &index);
+    /**
+     * @brief Returns the number of tracks in the folders counted so far.
+     */
+    uint16_t getIndexedTrackCount(void);
+    /**
+     * @brief Queues a clip in a folder to play.
+     *
+     * @param folder Folder number, below MY1690_CATALOG_FOLDERS.
+     * @param index Clip in the folder (1-based index).
+     *
+     * @return A handle for the player's getResult(), or MY1690_INVALID_HANDLE if the clip is unknown or the queue is full.
+     */
+    MY1690Handle playFolderTrack(uint8_t folder, uint16_t index);
+    /**
+     * @brief Returns the number of track names held.
+     */
+    uint8_t getTrackNameCount(void);
+    /**
+     * @brief Returns true once every folder count has been collected.
+     */
+    bool foldersComplete(void);
+    /**
+     * @brief Returns true if a folder count failed MY1690_CATALOG_FOLDER_ATTEMPTS times and is no longer asked for.
+     *
+     * The folders counted before it can still be used. invalidate() starts over.
+     */
+    bool indexIncomplete(void);
+    /**
+     * @brief Forgets everything, ie after the SD card was swapped. Collection starts over.
+     */
+    void invalidate(void);
+
+  protected:
+    SparkFunMY1690 *_player;
+
+    MY1690CatalogEntry _entries[MY1690_CATALOG_TRACKS];
+    uint8_t _nextEntry = 0; // Slot replaced when the table is full
+    uint16_t _folderCount[MY1690_CATALOG_FOLDERS];
+    uint16_t _folderStart[MY1690_CATALOG_FOLDERS + 1]; // Tracks before each folder, valid up to _nextFolder
+    uint8_t _nextFolder = 0;                            // Next folder to collect
+    uint8_t _folderAttempts = 0;                        // Failed counts of _nextFolder
+    bool _indexIncomplete = false;                      // _nextFolder failed too often, so no more are asked for
+
+    MY1690Handle _query = MY1690_INVALID_HANDLE; // Our outstanding query. Replies to any other are stale.
+    uint8_t _queryFolder = 0;                    // Folder the outstanding count query asked about
+    uint16_t _currentTrack = 0;                  // Last track number the player reported
+    uint16_t _startedSeen = 0;                   // Player's track started count when last checked
+    bool _checkTrack = true;                     // The current track should be read
+    unsigned long _lastPoll = 0;
+
+    MY1690CatalogEntry *find(uint16_t trackNumber);
+    void storeName(const char *name);
+    bool takeReply(MY1690Handle handle);
+
+    static void folderCountReady(MY1690Handle handle, MY1690Status status, uint16_t value, void *context);
+    static void playStatusReady(MY1690Handle handle, MY1690Status status, uint16_t value, void *context);
+    static void trackNumberReady(MY1690Handle handle, MY1690Status status, uint16_t value, void *context);
+    static void trackNameReady(MY1690Handle handle, MY1690Status status, uint16_t value, void *context);
+};
+
+#endif
@@ -0,0 +1,166 @@
+/*!
+ * @file SparkFun_MY1690_Cue.cpp
+ * @brief  Fires timed events at points in tracks played by the MY1690 Serial MP3 player
+ *
+ * SparkFun sells these at its website: www.sparkfun.com
+ *
+ * Do you like this library? Help support SparkFun. Buy a board!
+ * https://www.sparkfun.com/products/15050
+ *
+ * https://github.com/sparkfun/SparkFun_MY1690_MP3_Decoder_Arduino_Library
+ *
+ * @author SparkFun Electronics
+ * @date 2024
+ * @copyright Copyright (c) 2025, SparkFun Electronics Inc. This project is released under the MIT License.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+#include "SparkFun_MY1690_Cue.h"
+
+MY1690CueScheduler::MY1690CueScheduler(MY1690PositionTracker &tracker)
+{
+    _tracker = &tracker;
+}
+
+bool MY1690CueScheduler::add(uint16_t trackNumber, uint32_t offsetMs, MY1690CueCallback callback, void *context)
+{
+    if (_count == MY1690_CUE_SLOTS || trackNumber == 0 || callback == nullptr)
+        return (false);
+
+    // After any cues at the same point, so they fire in the order added
+    uint8_t x = _count;
+    while (x > 0 && before(&_cues[x - 1], trackNumber, offsetMs + 1) == false)
+    {
+        _cues[x] = _cues[x - 1];
+        x--;
+    }
+
+    _cues[x].trackNumber = trackNumber;
+    _cues[x].offsetMs = offsetMs;
+    _cues[x].callback = callback;
+    _cues[x].context = context;
+    _count++;
+
+    // Ahead of the next cue is in the past. Moving by index, not offset, keeps any cues that
+    // share a point with the one firing now, so a callback can add and remove cues.
+    if (x < _next)
+        _next++;
+    return (true);
+}
+
+uint8_t MY1690CueScheduler::remove(uint16_t trackNumber, uint32_t offsetMs)
+{
+    uint8_t kept = 0;
+    uint8_t next = _next;
+    for (uint8_t x = 0; x < _count; x++)
+    {
+        if (_cues[x].trackNumber == trackNumber && _cues[x].offsetMs == offsetMs)
+        {
+            if (x < _next)
+                next--;
+            continue;
+        }
+        _cues[kept++] = _cues[x];
+    }
+
+    uint8_t removed = _count - kept;
+    _count = kept;
+    _next = next;
+    return (removed);
+}
+
+void MY1690CueScheduler::clear(void)
+{
+    _count = 0;
+    _next = 0;
+}
+
+uint8_t MY1690CueScheduler::count(void)
+{
+    return (_count);
+}
+
+void MY1690CueScheduler::update(void)
+{
+    _tracker->update();
+
+    uint16_t track = _tracker->getTrackNumber();
+    uint32_t position = _tracker->getPositionMs();
+
+    if (track != _track)
+    {
+        _track = track; // 0 while the tracker is still reading it, which holds no cues
+        arm(0);
+    }
+    else if (_tracker->getPlayStatus() == 0)
+    {
+        if (_firedTo != 0)
+            arm(0); // Stopped, so the track plays from the start next time
+    }
+    else if (position + MY1690_CUE_REWIND_MS < _lastPosition)
+        arm(position);
+    _lastPosition = position;
+
+    // Only the next cue is ever looked at
+    while (_tracker->isPlaying() == true && _next < _count)
+    {
+        MY1690Cue *cue = &_cues[_next];
+        if (cue->trackNumber != _track || cue->offsetMs > position)
+            break;
+
+        // Copied and passed first, so the callback is free to add and remove cues
+        MY1690Cue due = *cue;
+        _next++;
+        _firedTo = due.offsetMs + 1;
+        _firedCount++;
+        _lastLatenessMs = position - due.offsetMs;
+        due.callback(due.trackNumber, due.offsetMs, due.context);
+    }
+}
+
+long MY1690CueScheduler::getMsUntilNext(void)
+{
+    if (_next >= _count || _cues[_next].trackNumber != _track)
+        return (-1);
+
+    uint32_t position = _tracker->getPositionMs();
+    if (_cues[_next].offsetMs <= position)
+        return (0);
+    return (_cues[_next].offsetMs - position);
+}
+
+uint32_t MY1690CueScheduler::getFiredCount(void)
+{
+    return (_firedCount);
+}
+
+uint32_t MY1690CueScheduler::getLastLatenessMs(void)
+{
+    return (_lastLatenessMs);
+}
+
+// Point _next at the first cue in the current track at or after an offset
+void MY1690CueScheduler::arm(uint32_t fromMs)
+{
+    _firedTo = fromMs;
+
+    uint8_t low = 0;
+    uint8_t high = _count;
+    while (low < high)
+    {
+        uint8_t middle = (low + high) / 2;
+        if (before(&_cues[middle], _track, fromMs) == true)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    _next = low;
+}
+
+// True if a cue sorts ahead of a point in a track
+bool MY1690CueScheduler::before(const MY1690Cue *cue, uint16_t trackNumber, uint32_t offsetMs)
+{
+    if (cue->trackNumber != trackNumber)
+        return (cue->trackNumber < trackNumber);
+    return (cue->offsetMs < offsetMs);
+}
@@ -0,0 +1,134 @@
+/*!
+ * @file SparkFun_MY1690_Cue.h
+ * @brief  Fires timed events at points in tracks played by the MY1690 Serial MP3 player
+ *
+ * SparkFun sells these at its website: www.sparkfun.com
+ *
+ * Do you like this library? Help support SparkFun. Buy a board!
+ * https://www.sparkfun.com/products/15050
+ *
+ * https://github.com/sparkfun/SparkFun_MY1690_MP3_Decoder_Arduino_Library
+ *
+ * @author SparkFun Electronics
+ * @date 2024
+ * @copyright Copyright (c) 2025, SparkFun Electronics Inc. This project is released under the MIT License.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef SPARKFUN_MY1690_CUE_H
+#define SPARKFUN_MY1690_CUE_H
+
+#include "SparkFun_MY1690_Position.h"
+
+// Number of cues a scheduler can hold. Each is a track number and an offset, 6 bytes, plus two
+// pointers: 10 bytes of RAM on AVR, 16 on 32-bit boards, where the track number is padded to 4.
+#ifndef MY1690_CUE_SLOTS
+#define MY1690_CUE_SLOTS 16
+#endif
+
+#define MY1690_CUE_REWIND_MS 500 // A jump back further than this fires the cues after it again
+
+/**
+ * @brief Called when playback reaches a cue.
+ *
+ * @param trackNumber The track the cue belongs to.
+ * @param offsetMs Where in the track the cue is.
+ * @param context The pointer given to add().
+ */
+typedef void (*MY1690CueCallback)(uint16_t trackNumber, uint32_t offsetMs, void *context);
+
+typedef struct
+{
+    uint16_t trackNumber;
+    uint32_t offsetMs;
+    MY1690CueCallback callback;
+    void *context;
+} MY1690Cue;
+
+/*!
+ * @class MY1690CueScheduler
+ * @brief Calls functions at set points in set tracks, for lights and animatronics that follow the audio.
+ *
+ * The position comes from a MY1690PositionTracker, which counts from the busy pin edge
+ * that started the track and checks itself against the device every few seconds, so
+ * checking for due cues costs no serial traffic. Cues are kept sorted by track and offset,
+ * and update() only ever looks at the next one, so a tick with nothing due is a single
+ * comparison however many cues there are.
+ *
+ * Cues fire while the track plays, in order. Any passed over by a fast forward fire as
+ * soon as it is seen. Stopping the track, restarting it or moving back more than
+ * MY1690_CUE_REWIND_MS arms the cues after the new position again.
+ */
+class MY1690CueScheduler
+{
+  public:
+    /**
+     * @brief Creates a scheduler driven by a position tracker.
+     *
+     * @param tracker A tracker that begin() has been called on.
+     */
+    MY1690CueScheduler(MY1690PositionTracker &tracker);
+
+    /**
+     * @brief Adds a cue.
+     *
+     * @param trackNumber The track to fire in (1-based index).
+     * @param offsetMs Time from the start of the track.
+     * @param callback Function to call.
+     * @param context Passed untouched to the callback.
+     *
+     * @return false if the scheduler is full, trackNumber is 0 or callback is nullptr.
+     */
+    bool add(uint16_t trackNumber, uint32_t offsetMs, MY1690CueCallback callback, void *context = nullptr);
+    /**
+     * @brief Removes the cues at a point in a track.
+     *
+     * @return The number of cues removed.
+     */
+    uint8_t remove(uint16_t trackNumber, uint32_t offsetMs);
+    /**
+     * @brief Removes every cue.
+     */
+    void clear(void);
+    /**
+     * @brief Returns the number of cues held.
+     */
+    uint8_t count(void);
+
+    /**
+     * @brief Fires the cues that are due. Calls the tracker's update(), so call this instead of it.
+     */
+    void update(void);
+
+    /**
+     * @brief Returns the time, in milliseconds, until the next cue in the track playing, or -1 if there is none.
+     */
+    long getMsUntilNext(void);
+    /**
+     * @brief Returns the number of cues fired since the scheduler was created.
+     */
+    uint32_t getFiredCount(void);
+    /**
+     * @brief Returns how far past its offset the last cue fired, in milliseconds.
+     */
+    uint32_t getLastLatenessMs(void);
+
+  protected:
+    MY1690PositionTracker *_tracker;
+
+    MY1690Cue _cues[MY1690_CUE_SLOTS]; // Sorted by track, then offset
+    uint8_t _count = 0;
+    uint8_t _next = 0; // First cue not yet fired in the track playing
+
+    uint16_t _track = 0;       // Track the cues were last armed for
+    uint32_t _firedTo = 0;     // Cues before this offset have fired
+    uint32_t _lastPosition = 0;
+    uint32_t _firedCount = 0;
+    uint32_t _lastLatenessMs = 0;
+
+    void arm(uint32_t fromMs);
+    bool before(const MY1690Cue *cue, uint16_t trackNumber, uint32_t offsetMs);
+};
+
+#endif
@@ -17,11 +17,33 @@
  */
 #include "SparkFun_MY1690_MP3_Library.h"
 
+#if defined(__AVR__)
+#include <avr/sleep.h>
+#endif
+
 SparkFunMY1690::SparkFunMY1690()
 {
+    for (uint8_t x = 0; x < MY1690_RESULT_SLOTS; x++)
+        _results[x].handle = MY1690_INVALID_HANDLE;
+    _response[0] = '\0';
+
+    for (uint8_t x = 0; x < MY1690_STATE_FIELDS; x++)
+        _stateLifetime[x] = MY1690_CACHE_LIFETIME_SETTINGS;
+    _stateLifetime[MY1690_STATE_PLAY_STATUS] = MY1690_CACHE_LIFETIME_STATUS;
+
+    setBaudRate(MY1690_BAUD_RATE);
+
+    _retryPolicy[MY1690_CLASS_QUERY].retries = MY1690_RETRIES;
+    _retryPolicy[MY1690_CLASS_SETTER].retries = MY1690_RETRIES;
+    _retryPolicy[MY1690_CLASS_ACTION].retries = 0; // Sending next twice skips two tracks
+    for (uint8_t x = 0; x < MY1690_CLASSES; x++)
+        _retryPolicy[x].backoffMs = MY1690_RETRY_BACKOFF_MS;
+
+    resetStats();
+    resetAdaptiveTimeout();
 }
 
-bool SparkFunMY1690::begin(Stream &serialPort, uint8_t pin)
+bool SparkFunMY1690::begin(Stream &serialPort, uint8_t pin, uint16_t timeoutMs)
 {
     _serialPort = &serialPort;
     _busyPin = pin;
@@ -29,141 +51,158 @@ bool SparkFunMY1690::begin(Stream &serialPort, uint8_t pin)
         pinMode(_busyPin, INPUT);
 
     // Datasheet says MY1690 needs 1.5s after power-on before first communication
-    uint8_t x = 0;
+    // Each probe waits at most one response timeout, so keep probing until the budget runs out
+    unsigned long startTime = millis();
     while (isConnected() == false)
     {
-        delay(100);
-        if (x++ == 15)
+        if (millis() - startTime >= timeoutMs)
             return (false);
+
+        // Don't hammer the IC if it answered with garbage
+        unsigned long probeTime = millis();
+        while (millis() - probeTime < _interbyteTimeoutMs)
+            update();
     }
 
-    stopPlaying(); // Stop any playing tracks. Stop doesn't always return 'STOP' so don't return it
+    // Stop any playing tracks. Sending stop to an idle IC is harmless and saves a status query.
+    // Stop doesn't always return 'STOP' so don't check it
+    transact(MP3_COMMAND_STOP);
 
     return (true);
 }
 
-// Try to get the version number from the device
+// Get the version number from the device once, then remember it
 uint16_t SparkFunMY1690::getVersion(void)
 {
-    commandBytes[0] = MP3_COMMAND_GET_VERSION_NUMBER;
+    if (_firmwareVersion == 0)
+        _firmwareVersion = probeVersion(true);
+    return (_firmwareVersion);
+}
 
-    // Sometimes it responds with 'OK1.1\r\n'
-    sendCommand(1);
-    if (getStringResponse("OK1.1\r\n") == true)
-        return (101);
+// Send a single version request and match the reply against every known format
+// Sometimes it responds with 'OK1.1\r\n', sometimes with '1.1\r\n'
+// The parser splits off the 'OK' so both arrive as '1.1'
+// Returns 101 for v1.1, 100 for v1.0, 0 if there was no recognizable reply
+uint16_t SparkFunMY1690::probeVersion(bool retry)
+{
+    MY1690Handle handle;
+    while ((handle = submit(MP3_COMMAND_GET_VERSION_NUMBER)) == MY1690_INVALID_HANDLE)
+    {
+        update(); // Queue is full, let it drain
+        idle();
+    }
 
-    // Sometimes it responds with '1.1\r\n'
-    sendCommand(1);
-    if (getStringResponse("1.1\r\n") == true)
-        return (101);
+    MY1690Command *command = queuedCommand(handle);
+    if (command != nullptr)
+        command->retry = retry;
 
-    sendCommand(1);
-    if (getStringResponse("OK1.0\r\n") == true)
-        return (100);
+    _lastStatus = waitFor(handle);
+    if (_lastStatus != MY1690_STATUS_OK)
+        return (0);
 
-    sendCommand(1);
-    if (getStringResponse("1.0\r\n") == true)
-        return (100);
+    // Expect 'major.minor', one digit each
+    if (_response[0] < '0' || _response[0] > '9' || _response[1] != '.' || _response[2] < '0' ||
+        _response[2] > '9' || _response[3] != '\0')
+        return (0);
 
-    sendCommand(1);
-    int version = getNumberResponse();
-    return (version);
+    return ((_response[0] - '0') * 100 + (_response[2] - '0'));
 }
 
 // Verify the device responds correctly with a version number
 bool SparkFunMY1690::isConnected(void)
 {
-    int version = getVersion();
-    if (version == 100 || version == 101)
-        return (true);
+    // No retries, so a missing module is given up on in one response timeout
+    uint16_t version = probeVersion(false);
+    if (version == 0)
+        return (false);
 
-    return (false);
+    _firmwareVersion = version;
+    return (true);
 }
 
 // Play all songs on the SD card, then loop
 bool SparkFunMY1690::setPlayModeFull(void)
 {
-    commandBytes[0] = MP3_COMMAND_SET_LOOP_MODE;
-    commandBytes[1] = MP3_LOOP_MODE_FULL;
-    sendCommand(2);
-    return (getOKResponse());
+    return (transact(MP3_COMMAND_SET_LOOP_MODE, MP3_LOOP_MODE_FULL, 1) == MY1690_STATUS_OK);
 }
 
 // Play all songs in the folder, then loop
 bool SparkFunMY1690::setPlayModeFolder(void)
 {
-    commandBytes[0] = MP3_COMMAND_SET_LOOP_MODE;
-    commandBytes[1] = MP3_LOOP_MODE_FOLDER;
-    sendCommand(2);
-    return (getOKResponse());
+    return (transact(MP3_COMMAND_SET_LOOP_MODE, MP3_LOOP_MODE_FOLDER, 1) == MY1690_STATUS_OK);
 }
 
 // Play song, then loop
 bool SparkFunMY1690::setPlayModeSingle(void)
 {
-    commandBytes[0] = MP3_COMMAND_SET_LOOP_MODE;
-    commandBytes[1] = MP3_LOOP_MODE_SINGLE;
-    sendCommand(2);
-    return (getOKResponse());
+    return (transact(MP3_COMMAND_SET_LOOP_MODE, MP3_LOOP_MODE_SINGLE, 1) == MY1690_STATUS_OK);
 }
 
 // Play random song, then play another random song, with no end
 bool SparkFunMY1690::setPlayModeRandom(void)
 {
-    commandBytes[0] = MP3_COMMAND_SET_LOOP_MODE;
-    commandBytes[1] = MP3_LOOP_MODE_RANDOM;
-    sendCommand(2);
-    return (getOKResponse());
+    return (transact(MP3_COMMAND_SET_LOOP_MODE, MP3_LOOP_MODE_RANDOM, 1) == MY1690_STATUS_OK);
 }
 
 // Play a song, then stop
 bool SparkFunMY1690::setPlayModeNoLoop(void)
 {
-    commandBytes[0] = MP3_COMMAND_SET_LOOP_MODE;
-    commandBytes[1] = MP3_LOOP_MODE_NO_LOOP;
-    sendCommand(2);
-    return (getOKResponse());
+    return (transact(MP3_COMMAND_SET_LOOP_MODE, MP3_LOOP_MODE_NO_LOOP, 1) == MY1690_STATUS_OK);
 }
 
 uint16_t SparkFunMY1690::getSongCount(void)
 {
-    commandBytes[0] = MP3_COMMAND_GET_SONG_COUNT;
-    sendCommand(1);
-
-    return (getNumberResponse());
+    uint16_t value = 0;
+    transact(MP3_COMMAND_GET_SONG_COUNT, 0, 0, &value);
+    return (value);
 }
 
 uint16_t SparkFunMY1690::getTrackNumber(void)
 {
-    commandBytes[0] = MP3_COMMAND_GET_CURRENT_TRACK;
-    sendCommand(1);
-
-    return (getNumberResponse());
+    uint16_t value = 0;
+    transact(MP3_COMMAND_GET_CURRENT_TRACK, 0, 0, &value);
+    return (value);
 }
 
 uint16_t SparkFunMY1690::getTrackElapsedTime(void)
 {
-    commandBytes[0] = MP3_COMMAND_GET_CURRENT_TRACK_TIME;
-    sendCommand(1);
-
-    return (getNumberResponse());
+    uint16_t value = 0;
+    transact(MP3_COMMAND_GET_CURRENT_TRACK_TIME, 0, 0, &value);
+    return (value);
 }
 
 uint16_t SparkFunMY1690::getTrackTotalTime(void)
 {
-    commandBytes[0] = MP3_COMMAND_GET_CURRENT_TRACK_TIME_TOTAL;
-    sendCommand(1);
+    uint16_t value = 0;
+    transact(MP3_COMMAND_GET_CURRENT_TRACK_TIME_TOTAL, 0, 0, &value);
+    return (value);
+}
+
+// Responds with the 8.3 name, ie '0001.MP3\r\n'
+uint8_t SparkFunMY1690::getTrackName(char *buffer, uint8_t bufferSize)
+{
+    if (bufferSize == 0)
+        return (0);
 
-    return (getNumberResponse());
+    buffer[0] = '\0';
+    if (transact(MP3_COMMAND_GET_CURRENT_TRACK_NAME) != MY1690_STATUS_OK)
+        return (0);
+
+    strncpy(buffer, _response, bufferSize - 1);
+    buffer[bufferSize - 1] = '\0';
+    return (strlen(buffer));
+}
+
+uint16_t SparkFunMY1690::getSongsInFolderCount(uint8_t folder)
+{
+    uint16_t value = 0;
+    transact(MP3_COMMAND_GET_SONGS_IN_FOLDER_COUNT, folder, 1, &value);
+    return (value);
 }
 
 bool SparkFunMY1690::playTrackNumber(uint16_t trackNumber)
 {
-    commandBytes[0] = MP3_COMMAND_SELECT_TRACK_PLAY;
-    commandBytes[1] = trackNumber >> 8;   // MSB
-    commandBytes[2] = trackNumber & 0xFF; // LSB
-    sendCommand(3);
-    return (getOKResponse());
+    return (transact(MP3_COMMAND_SELECT_TRACK_PLAY, trackNumber, 2) == MY1690_STATUS_OK);
 }
 
 bool SparkFunMY1690::setVolume(uint8_t volumeLevel)
@@ -173,9 +212,11 @@ bool SparkFunMY1690::setVolume(uint8_t volumeLevel)
     if (volumeLevel > 30)
         volumeLevel = 30;
 
-    commandBytes[0] = MP3_COMMAND_SET_VOLUME;
-    commandBytes[1] = volumeLevel;
-    sendCommand(2);
+    transact(MP3_COMMAND_SET_VOLUME, volumeLevel, 1);
+
+    // The cache was written through when the command went out
+    if (_cacheEnabled == true)
+        return (true);
 
     // In v1.1, setVolume no longer responds with an OK. We must query it
     if (getVolume() == volumeLevel)
@@ -185,53 +226,55 @@ bool SparkFunMY1690::setVolume(uint8_t volumeLevel)
 
 uint8_t SparkFunMY1690::getVolume(void)
 {
-    commandBytes[0] = MP3_COMMAND_GET_VOLUME;
-    sendCommand(1);
-    uint8_t volLevel = getNumberResponse() & 0xFF;
+    uint8_t cached;
+    if (cachedState(MY1690_STATE_VOLUME, &cached) == true)
+        return (cached);
+
+    uint16_t value = 0;
+    transact(MP3_COMMAND_GET_VOLUME, 0, 0, &value);
+    uint8_t volLevel = value & 0xFF;
     return (volLevel);
 }
 
 bool SparkFunMY1690::volumeUp(void)
 {
-    commandBytes[0] = MP3_COMMAND_VOLUME_UP;
-    sendCommand(1);
-    return (getOKResponse());
+    return (transact(MP3_COMMAND_VOLUME_UP) == MY1690_STATUS_OK);
 }
 bool SparkFunMY1690::volumeDown(void)
 {
-    commandBytes[0] = MP3_COMMAND_VOLUME_DOWN;
-    sendCommand(1);
-    return (getOKResponse());
+    return (transact(MP3_COMMAND_VOLUME_DOWN) == MY1690_STATUS_OK);
 }
 
 uint8_t SparkFunMY1690::getEQ(void)
 {
-    commandBytes[0] = MP3_COMMAND_GET_EQ;
-    sendCommand(1);
-    return (getNumberResponse());
+    uint8_t cached;
+    if (cachedState(MY1690_STATE_EQ, &cached) == true)
+        return (cached);
+
+    uint16_t value = 0;
+    transact(MP3_COMMAND_GET_EQ, 0, 0, &value);
+    return (value);
 }
 
 bool SparkFunMY1690::setEQ(uint8_t eqType)
 {
-    commandBytes[0] = MP3_COMMAND_SET_EQ_MODE;
-    commandBytes[1] = eqType;
-    sendCommand(2);
-    return (getOKResponse());
+    return (transact(MP3_COMMAND_SET_EQ_MODE, eqType, 1) == MY1690_STATUS_OK);
 }
 
 bool SparkFunMY1690::setPlayMode(uint8_t playMode)
 {
-    commandBytes[0] = MP3_COMMAND_SET_LOOP_MODE;
-    commandBytes[1] = playMode;
-    sendCommand(2);
-    return (getOKResponse());
+    return (transact(MP3_COMMAND_SET_LOOP_MODE, playMode, 1) == MY1690_STATUS_OK);
 }
 
 uint8_t SparkFunMY1690::getPlayMode(void)
 {
-    commandBytes[0] = MP3_COMMAND_GET_LOOP_MODE;
-    sendCommand(1);
-    return (getNumberResponse());
+    uint8_t cached;
+    if (cachedState(MY1690_STATE_PLAY_MODE, &cached) == true)
+        return (cached);
+
+    uint16_t value = 0;
+    transact(MP3_COMMAND_GET_LOOP_MODE, 0, 0, &value);
+    return (value);
 }
 
 bool SparkFunMY1690::isPlaying(void)
@@ -243,6 +286,9 @@ bool SparkFunMY1690::isPlaying(void)
         return (false);
     }
 
+    if (_busySlot >= 0)
+        return (_busyLevel); // Debounced by the interrupt
+
     if (digitalRead(_busyPin) == HIGH)
         return (true); // Song is playing
     return (false);
@@ -251,15 +297,18 @@ bool SparkFunMY1690::isPlaying(void)
 // Responds with '0000 \r\n' (note the space), '0001 \r\n', etc
 uint8_t SparkFunMY1690::getPlayStatus(void)
 {
-    commandBytes[0] = MP3_COMMAND_GET_STATUS;
-    sendCommand(1);
-    return (getNumberResponse());
+    uint8_t cached;
+    if (cachedState(MY1690_STATE_PLAY_STATUS, &cached) == true)
+        return (cached);
+
+    uint16_t value = 0;
+    transact(MP3_COMMAND_GET_STATUS, 0, 0, &value);
+    return (value);
 }
 
 void SparkFunMY1690::play(void)
 {
-    commandBytes[0] = MP3_COMMAND_PLAY;
-    sendCommand(1);
+    transact(MP3_COMMAND_PLAY);
 
     // In v1.1 there are no OK responses. Busy goes high after ~30ms.
     // User can also use the isPlaying() after 30ms to see if song has started
@@ -267,40 +316,36 @@ void SparkFunMY1690::play(void)
 
 bool SparkFunMY1690::pause(void)
 {
-    commandBytes[0] = MP3_COMMAND_PAUSE;
-    sendCommand(1);
-    return (getOKResponse());
+    return (transact(MP3_COMMAND_PAUSE) == MY1690_STATUS_OK);
 }
 
 bool SparkFunMY1690::playNext(void)
 {
-    commandBytes[0] = MP3_COMMAND_NEXT;
-    sendCommand(1);
-    return (getOKResponse());
+    return (transact(MP3_COMMAND_NEXT) == MY1690_STATUS_OK);
 }
 
 bool SparkFunMY1690::playPrevious(void)
 {
-    commandBytes[0] = MP3_COMMAND_PREVIOUS;
-    sendCommand(1);
-    return (getOKResponse());
+    return (transact(MP3_COMMAND_PREVIOUS) == MY1690_STATUS_OK);
 }
 
 // Device responds with 'OK'
 // If a song is playing, then ~14ms later 'STOP' is reported
 bool SparkFunMY1690::stopPlaying(void)
 {
-    // Use hardware pins or software command
-    if (isPlaying() == false)
+    // Skip the stop only when the status is known without a query, which would wait behind the queue
+    uint8_t cached;
+    if ((_busyPin != 255 || cachedState(MY1690_STATE_PLAY_STATUS, &cached) == true) && isPlaying() == false)
         return (true);
 
-    commandBytes[0] = MP3_COMMAND_STOP;
-    sendCommand(1);
+    transact(MP3_COMMAND_STOP);
 
     // v1.1 doesn't respond with OK or STOP, instead the isPlaying can be used
-    // getOKResponse();
 
-    delay(10); // IC takes 5ms to stop a track
+    // IC takes 5ms to stop a track. Keep the engine running while we wait.
+    unsigned long startTime = millis();
+    while (millis() - startTime < 10)
+        update();
 
     if (isPlaying() == false)
         return (true);
@@ -313,180 +358,2365 @@ bool SparkFunMY1690::reset(void)
     // Device responds with 'OK'
     // Then 'STOPMP3' ~18ms later
     // Then 'OK' ~67ms later
-    commandBytes[0] = MP3_COMMAND_RESET;
-    sendCommand(1);
-    return (getOKResponse());
+    if (transact(MP3_COMMAND_RESET) != MY1690_STATUS_OK)
+        return (false);
+
+    // Wait for the second 'OK' so it isn't mistaken for the reply to the next command
+    MY1690Line *line = nextLine(true);
+    if (line != nullptr)
+        _parser.release(line);
+    return (true);
 }
 
 // Advance track ~1s
 bool SparkFunMY1690::fastForward(void)
 {
-    commandBytes[0] = MP3_COMMAND_FASTFOWARD;
-    sendCommand(1);
-    return (getOKResponse());
+    return (transact(MP3_COMMAND_FASTFOWARD) == MY1690_STATUS_OK);
 }
 
 // Rewind track ~1s
 bool SparkFunMY1690::rewind(void)
 {
-    commandBytes[0] = MP3_COMMAND_REWIND;
-    sendCommand(1);
-    return (getOKResponse());
+    return (transact(MP3_COMMAND_REWIND) == MY1690_STATUS_OK);
 }
 
 // Toggle play/pause on this track
 bool SparkFunMY1690::playPause(void)
 {
-    commandBytes[0] = MP3_COMMAND_PLAY_PAUSE;
-    sendCommand(1);
-    return (getOKResponse());
+    return (transact(MP3_COMMAND_PLAY_PAUSE) == MY1690_STATUS_OK);
 }
 
 // In version 1.1, sometimes SparkFunMY1690 responds with '0000 \r\n' to a get command. No OK, and a space.
 // Sometimes 'OK0001 \r\n'. Ok, and a space. Yay!
 // In version 1.0 it was lower case letters. In v1.1, it's upper case HEX.
-// Convert the four letters to a decimal value
+// The parser splits off the 'OK' and converts the four letters to a decimal value
 uint16_t SparkFunMY1690::getNumberResponse(void)
 {
-    const uint8_t maxLength = 9;
-    uint8_t okResponseOffset = 0;
-
-    if (responseAvailable() == false)
+    MY1690Line *line = nextLine(false);
+    if (line == nullptr)
         return (0); // Timeout
 
-    // Get four byte response
-    uint16_t responseValue = 0;
-    uint8_t i = 0;
+    uint16_t responseValue = _parser.number(line);
+    _parser.release(line);
+    return (responseValue);
+}
+
+// MY1690 responds with OK (no \n \r) in ASCII to a control command
+bool SparkFunMY1690::getOKResponse(void)
+{
+    return (getStringResponse("OK"));
+}
+
+// Returns true if the MY1690 sends 'STOP', which it does when a track ends
+// A 'STOP' that arrived earlier and hasn't been read counts
+bool SparkFunMY1690::getSTOPResponse(void)
+{
+    uint16_t stopsBefore = _stopCount;
+    unsigned long startTime = millis();
 
-    while (_serialPort->available() && i <= maxLength)
+    while (1)
     {
-        uint8_t incoming = _serialPort->read();
-        if ((i == 0 && incoming == 'O') || (i == 1 && incoming == 'K'))
-        {
-            // Throw away chars
+        update();
 
-            okResponseOffset = 2; // Increase scanning i by 2 more
-        }
-        else if (i <= (3 + okResponseOffset))
+        // Taken by onStop(), or still held for readUnsolicited()
+        if (_stopCount != stopsBefore)
+            return (true);
+        for (uint8_t x = 0; x < _parser.lineCount(); x++)
         {
-            // Added because getVersion response is three characters long
-            if (incoming != '\r' && incoming != '\n')
+            MY1690Line *line = _parser.line(x);
+            if (line->type == MY1690_LINE_STOP && line->unsolicited == true)
             {
-                // Convert ASCII HEX values to decimal
-                responseValue <<= 4;
-                if (incoming >= '0' && incoming <= '9')
-                    responseValue += (incoming - '0');
-                else if (incoming >= 'A' && incoming <= 'Z')
-                    responseValue += (incoming - 'A') + 10;
-                else if (incoming >= 'a' && incoming <= 'z')
-                    responseValue += (incoming - 'a') + 10;
+                _parser.release(line);
+                _parser.compact();
+                return (true);
             }
         }
-        else if (incoming == '\n')
-            break; // End of response
+
+        if (millis() - startTime > _responseTimeoutMs)
+            return (false); // Timeout
+        idle();
+    }
+}
+
+// Returns true if MY1690 responds with a given string
+// The parser frames 'OK' on its own, so 'OK1.1\r\n' arrives as 'OK' then '1.1'.
+// An 'OK' prefix is required when expectedResponse has one, and skipped when it doesn't.
+bool SparkFunMY1690::getStringResponse(const char *expectedResponse)
+{
+    MY1690Line *line;
+
+    if (expectedResponse[0] == 'O' && expectedResponse[1] == 'K')
+    {
+        line = nextLine(true);
+        if (line == nullptr)
+            return (false); // Timeout
+
+        bool responseOK = (line->type == MY1690_LINE_OK);
+        _parser.release(line);
+        if (responseOK == false)
+            return (false);
+
+        expectedResponse += 2;
+        if (expectedResponse[0] == '\0' || expectedResponse[0] == '\r' || expectedResponse[0] == '\n')
+            return (true);
+    }
+
+    line = nextLine(false);
+    if (line == nullptr)
+        return (false); // Timeout
+
+    bool responseOK = _parser.equals(line, expectedResponse);
+    _parser.release(line);
+    return (responseOK);
+}
+
+// Returns false if no serial data is seen after maxTimeout
+bool SparkFunMY1690::responseAvailable(uint8_t maxTimeout)
+{
+    unsigned long startTime = millis();
+
+    while (_serialPort->available() == 0 && _parser.receiving() == false && firstReplyLine() == nullptr)
+    {
+        if (millis() - startTime > maxTimeout)
+            return (false); // Timeout
+        idle();
+    }
+    return (true);
+}
+
+// Stale replies are dropped. Messages the MY1690 sent on its own are kept for readUnsolicited().
+void SparkFunMY1690::clearBuffer(void)
+{
+    readIncoming();
+    retainUnsolicited();
+    return;
+}
+
+void SparkFunMY1690::sendCommand(uint8_t commandLength)
+{
+    clearBuffer(); // Clear anything in the buffer
+
+    if (commandLength == 0 || commandLength > MP3_NUM_CMD_BYTES)
+        return;
+
+    // Copy out of commandBytes so the frame can't change under us, then send it in one write
+    uint8_t frame[MP3_NUM_CMD_BYTES + 4];
+    uint8_t length = buildFrame(frame, commandBytes[0], &commandBytes[1], commandLength - 1);
+    _serialPort->write(frame, length);
+    frameWritten();
+}
+
+// Lay out 7E LEN OP [params] CRC EF. Returns the number of bytes in the frame.
+uint8_t SparkFunMY1690::buildFrame(uint8_t *frame, uint8_t opcode, const uint8_t *param, uint8_t paramLength)
+{
+    uint8_t length = paramLength + 3; // Length, opcode, params and CRC
+
+    frame[0] = MP3_START_CODE;
+    frame[1] = length;
+    frame[2] = opcode;
+    uint8_t crc = my1690FrameCRC(length, opcode);
+    for (uint8_t x = 0; x < paramLength; x++)
+    {
+        frame[3 + x] = param[x];
+        crc ^= param[x]; // XOR this byte to the CRC
+    }
+    frame[3 + paramLength] = crc;
+    frame[4 + paramLength] = MP3_END_CODE;
+
+    return (paramLength + 5);
+}
+
+// The reply the MY1690 sends for each command
+// In v1.1, play, stop and set volume no longer respond with an OK
+MY1690ResponseType SparkFunMY1690::expectedResponse(uint8_t opcode)
+{
+    switch (opcode)
+    {
+    case MP3_COMMAND_PLAY:
+    case MP3_COMMAND_STOP:
+    case MP3_COMMAND_SET_VOLUME:
+        return (MY1690_RESPONSE_NONE);
+
+    case MP3_COMMAND_GET_STATUS:
+    case MP3_COMMAND_GET_VOLUME:
+    case MP3_COMMAND_GET_EQ:
+    case MP3_COMMAND_GET_LOOP_MODE:
+    case MP3_COMMAND_GET_SONG_COUNT:
+    case MP3_COMMAND_GET_CURRENT_TRACK:
+    case MP3_COMMAND_GET_CURRENT_TRACK_TIME:
+    case MP3_COMMAND_GET_CURRENT_TRACK_TIME_TOTAL:
+    case MP3_COMMAND_GET_SONGS_IN_FOLDER_COUNT:
+        return (MY1690_RESPONSE_NUMBER);
+
+    case MP3_COMMAND_GET_VERSION_NUMBER:
+    case MP3_COMMAND_GET_CURRENT_TRACK_NAME:
+        return (MY1690_RESPONSE_STRING);
+
+    default:
+        return (MY1690_RESPONSE_OK);
+    }
+}
+
+MY1690Handle SparkFunMY1690::submit(uint8_t opcode, uint16_t param, uint8_t paramLength, MY1690Callback callback,
+                                    void *context, MY1690Priority priority)
+{
+    if (priority == MY1690_PRIORITY_HIGH)
+        return (submitHigh(opcode, param, paramLength, callback, context));
+
+    MY1690Handle handle = coalesce(opcode, param, paramLength, callback, context);
+    if (handle != MY1690_INVALID_HANDLE)
+        return (handle);
+
+    if (_queueCount == MY1690_QUEUE_SIZE)
+        return (MY1690_INVALID_HANDLE); // Queue is full
+
+    MY1690Command *command = &_queue[(_queueHead + _queueCount) % MY1690_QUEUE_SIZE];
+    fillCommand(command, opcode, param, paramLength, callback, context);
+    _queueCount++;
+
+    trackVolume(opcode, param);
+    return (command->handle);
+}
+
+MY1690Handle SparkFunMY1690::submitHigh(uint8_t opcode, uint16_t param, uint8_t paramLength, MY1690Callback callback,
+                                        void *context)
+{
+    cancelQueries();
+
+    // Behind what has been sent and the high priority commands already waiting
+    uint8_t position = _inFlight;
+    while (position < _queueCount &&
+           _queue[(_queueHead + position) % MY1690_QUEUE_SIZE].priority == MY1690_PRIORITY_HIGH)
+        position++;
+
+    // Jumping ahead of queued volume changes leaves the final level to them
+    bool volumeQueued = volumeChangesQueued();
+
+    MY1690Handle handle = insertAt(position, opcode, param, paramLength, callback, context);
+    if (handle == MY1690_INVALID_HANDLE)
+        return (handle);
+    _queue[(_queueHead + position) % MY1690_QUEUE_SIZE].priority = MY1690_PRIORITY_HIGH;
+
+    if (volumeQueued == false)
+        trackVolume(opcode, param);
+
+    // A retry backoff gives way. A reset still gets to settle.
+    if (_holding == true && _recoveryStep == 0)
+        _holding = false;
+
+    // Straight onto the wire if nothing is waiting on the device
+    if (_inFlight == 0 && _holding == false && _serialPort != nullptr)
+        sendQueued();
+
+    return (handle);
+}
+
+// Track where the volume will end up once the queue drains
+void SparkFunMY1690::trackVolume(uint8_t opcode, uint16_t param)
+{
+    if (opcode == MP3_COMMAND_SET_VOLUME)
+        _volumeEstimate = param > 30 ? 30 : param; // The MY1690 caps anything above 30
+    else if (opcode == MP3_COMMAND_VOLUME_UP && _volumeEstimate < 30)
+        _volumeEstimate++;
+    else if (opcode == MP3_COMMAND_VOLUME_DOWN && _volumeEstimate > 0 && _volumeEstimate <= 30)
+        _volumeEstimate--;
+    else if (opcode == MP3_COMMAND_RESET)
+        _volumeEstimate = MY1690_VOLUME_UNKNOWN;
+}
+
+void SparkFunMY1690::fillCommand(MY1690Command *command, uint8_t opcode, uint16_t param, uint8_t paramLength,
+                                 MY1690Callback callback, void *context)
+{
+    command->opcode = opcode;
+    command->paramLength = paramLength;
+    if (paramLength == 2)
+    {
+        command->param[0] = param >> 8;   // MSB
+        command->param[1] = param & 0xFF; // LSB
+    }
+    else
+        command->param[0] = param & 0xFF;
+    command->responseType = expectedResponse(opcode);
+    command->callback = callback;
+    command->context = context;
+    command->attempts = 0;
+    command->retry = true;
+    command->priority = MY1690_PRIORITY_NORMAL;
+    command->submittedMicros = micros();
+
+    command->handle = _nextHandle++;
+    if (_nextHandle == MY1690_INVALID_HANDLE)
+        _nextHandle++;
+}
+
+// Queue a command ahead of everything not yet sent, high priority commands included
+MY1690Handle SparkFunMY1690::insertNext(uint8_t opcode, uint16_t param, uint8_t paramLength, MY1690Callback callback,
+                                        void *context)
+{
+    MY1690Handle handle = insertAt(_inFlight, opcode, param, paramLength, callback, context);
+    if (handle != MY1690_INVALID_HANDLE)
+        _queue[(_queueHead + _inFlight) % MY1690_QUEUE_SIZE].priority = MY1690_PRIORITY_HIGH;
+    return (handle);
+}
+
+// Queue a command at a position in the queue, 0 being the head
+MY1690Handle SparkFunMY1690::insertAt(uint8_t position, uint8_t opcode, uint16_t param, uint8_t paramLength,
+                                      MY1690Callback callback, void *context)
+{
+    if (_queueCount == MY1690_QUEUE_SIZE)
+        return (MY1690_INVALID_HANDLE); // Queue is full
+
+    // Move the commands behind it back one slot
+    for (uint8_t x = _queueCount; x > position; x--)
+        _queue[(_queueHead + x) % MY1690_QUEUE_SIZE] = _queue[(_queueHead + x - 1) % MY1690_QUEUE_SIZE];
+
+    MY1690Command *command = &_queue[(_queueHead + position) % MY1690_QUEUE_SIZE];
+    fillCommand(command, opcode, param, paramLength, callback, context);
+    _queueCount++;
+    return (command->handle);
+}
+
+// Drop normal priority queries, sent or not, so a high priority command can go straight out
+void SparkFunMY1690::cancelQueries(void)
+{
+    // Sent queries can only go if all of them can, or the replies left would be matched out of order
+    bool cancelSent = true;
+    for (uint8_t x = 0; x < _inFlight; x++)
+    {
+        MY1690Command *command = &_queue[(_queueHead + x) % MY1690_QUEUE_SIZE];
+        if (command->priority != MY1690_PRIORITY_NORMAL || command->responseType != MY1690_RESPONSE_NUMBER)
+            cancelSent = false;
+    }
+
+    MY1690Command cancelled[MY1690_QUEUE_SIZE];
+    uint8_t cancelledCount = 0;
+    uint8_t sentCancelled = 0;
+    uint8_t kept = 0;
+    for (uint8_t x = 0; x < _queueCount; x++)
+    {
+        MY1690Command *command = &_queue[(_queueHead + x) % MY1690_QUEUE_SIZE];
+        bool sent = x < _inFlight;
+        if (command->priority == MY1690_PRIORITY_NORMAL && commandClass(command->opcode) == MY1690_CLASS_QUERY &&
+            (sent == false || cancelSent == true))
+        {
+            cancelled[cancelledCount++] = *command;
+            if (sent == true)
+                sentCancelled++;
+        }
         else
         {
-            ; // Throw out \r and ' ' characters
+            if (kept != x)
+                _queue[(_queueHead + kept) % MY1690_QUEUE_SIZE] = *command;
+            kept++;
         }
+    }
+    if (cancelledCount == 0)
+        return;
 
-        i++;
+    _queueCount = kept;
+    _inFlight -= sentCancelled;
+    _cancelledCount += cancelledCount;
+    if (sentCancelled > 0)
+    {
+        _discardReplies += sentCancelled;
+        _discardUntil = millis() + (unsigned long)_responseTimeoutMs * _discardReplies;
+    }
 
-        // The device can take a few ms between response chars
-        uint8_t escapeCounter = 0;
-        while (_serialPort->available() == 0 && i <= maxLength)
-        {
-            if (escapeCounter++ > 10)
-                return (responseValue); // Give up
+    // Last, so the callbacks see a consistent queue
+    for (uint8_t x = 0; x < cancelledCount; x++)
+        finishCommand(&cancelled[x], MY1690_STATUS_CANCELLED, 0);
+}
 
-            delay(1); // At 9600bps 1 byte takes 0.8ms
-        }
+// Throw away replies to queries cancelled after they were sent
+void SparkFunMY1690::discardReplies(void)
+{
+    if ((long)(millis() - _discardUntil) >= 0)
+    {
+        _discardReplies = 0; // Lost on the way
+        return;
     }
 
-    return (responseValue);
+    MY1690Line *line;
+    while (_discardReplies > 0 && (line = firstReplyLine()) != nullptr && line->type == MY1690_LINE_NUMBER)
+    {
+        _parser.release(line);
+        _discardReplies--;
+
+        // The command behind it waits from here
+        _sentAt = millis();
+        _sentAtUs = micros();
+        _sentAlone = false;
+    }
+    _parser.compact();
 }
 
-// MY1690 responds with OK (no \n \r) in ASCII to a control command
-bool SparkFunMY1690::getOKResponse(void)
+// Merge a command into the last queued command when it supersedes it
+// Returns the handle of the merged command, or MY1690_INVALID_HANDLE if nothing was merged
+MY1690Handle SparkFunMY1690::coalesce(uint8_t opcode, uint16_t param, uint8_t paramLength, MY1690Callback callback,
+                                      void *context)
 {
-    return (getStringResponse("OK"));
+    if (_coalescing == false || _queueCount <= _inFlight)
+        return (MY1690_INVALID_HANDLE); // Nothing queued that hasn't already gone out
+
+    MY1690Command *tail = &_queue[(_queueHead + _queueCount - 1) % MY1690_QUEUE_SIZE];
+
+    // Only one callback can ride on a merged command
+    if (tail->callback != nullptr && callback != nullptr)
+        return (MY1690_INVALID_HANDLE);
+
+    bool volumeStep = (opcode == MP3_COMMAND_VOLUME_UP || opcode == MP3_COMMAND_VOLUME_DOWN);
+
+    if (tail->opcode == opcode && paramLength == 1 &&
+        (opcode == MP3_COMMAND_SET_VOLUME || opcode == MP3_COMMAND_SET_EQ_MODE || opcode == MP3_COMMAND_SET_LOOP_MODE))
+    {
+        // The last write wins
+        tail->param[0] = param & 0xFF;
+        if (opcode == MP3_COMMAND_SET_VOLUME)
+            _volumeEstimate = param > 30 ? 30 : param;
+    }
+    else if (volumeStep == true && tail->opcode == MP3_COMMAND_SET_VOLUME)
+    {
+        // Fold the step into the absolute level that is already queued
+        if (opcode == MP3_COMMAND_VOLUME_UP && tail->param[0] < 30)
+            tail->param[0]++;
+        else if (opcode == MP3_COMMAND_VOLUME_DOWN && tail->param[0] > 0)
+            tail->param[0]--;
+        _volumeEstimate = tail->param[0];
+    }
+    else if (volumeStep == true && _volumeEstimate <= 30 &&
+             (tail->opcode == MP3_COMMAND_VOLUME_UP || tail->opcode == MP3_COMMAND_VOLUME_DOWN))
+    {
+        // A run of steps from a known level becomes one absolute level
+        if (opcode == MP3_COMMAND_VOLUME_UP && _volumeEstimate < 30)
+            _volumeEstimate++;
+        else if (opcode == MP3_COMMAND_VOLUME_DOWN && _volumeEstimate > 0)
+            _volumeEstimate--;
+        tail->opcode = MP3_COMMAND_SET_VOLUME;
+        tail->param[0] = _volumeEstimate;
+        tail->paramLength = 1;
+        tail->responseType = expectedResponse(MP3_COMMAND_SET_VOLUME);
+    }
+    else
+        return (MY1690_INVALID_HANDLE);
+
+    if (callback != nullptr)
+    {
+        tail->callback = callback;
+        tail->context = context;
+    }
+
+    _coalescedCount++;
+    return (tail->handle);
 }
 
-// Returns true if MY1690 responds with a given string
-bool SparkFunMY1690::getStringResponse(const char *expectedResponse)
+void SparkFunMY1690::update(void)
 {
-    uint8_t expectedLength = strlen(expectedResponse);
+    // A frame counts toward the wake latency until the second update() after waking
+    if (_woken == true)
+    {
+        if (_wakeUpdated == true)
+            _woken = false;
+        _wakeUpdated = true;
+    }
 
-    if (responseAvailable() == false)
-        return (false); // Timeout
+    // Track events first so their callbacks can queue commands that go out below
+    if (_busySlot >= 0)
+        dispatchBusyEvents();
 
-    // Get response
-    uint8_t i = 0;
-    bool responseOK = true;
+    if (_serialPort == nullptr)
+        return;
+
+    readIncoming();
+
+    if (_discardReplies > 0)
+        discardReplies();
+
+    // Match framed lines to replies. They come back in the order the commands went out.
+    if (_inFlight == 0)
+        retainUnsolicited();
+
+    MY1690Line *line;
+    while (_inFlight > 0 && (line = firstReplyLine()) != nullptr)
+        matchReply(line);
+    _parser.compact();
 
-    while (_serialPort->available() && i < expectedLength)
+    dispatchUnsolicited();
+
+    if (_inFlight > 0 && _parser.receiving() == false && millis() - _sentAt > replyTimeout())
+        completeCommand(MY1690_STATUS_TIMEOUT, 0);
+
+    // Hold off while backing off before a retry, or while the MY1690 settles after a reset
+    if (_holding == true)
+    {
+        if ((long)(millis() - _holdUntil) < 0)
+            return;
+        _holding = false;
+    }
+
+    sendQueued();
+}
+
+// Send everything the pipeline allows
+void SparkFunMY1690::sendQueued(void)
+{
+    while (_queueCount > _inFlight)
     {
-        uint8_t incoming = _serialPort->read();
-        if (incoming != expectedResponse[i])
-            responseOK = false;
-        i++;
+        MY1690Command *command = &_queue[(_queueHead + _inFlight) % MY1690_QUEUE_SIZE];
 
-        // The device can take a few ms between response chars
-        uint8_t escapeCounter = 0;
-        while (_serialPort->available() == 0 && i < expectedLength)
+        if (_inFlight > 0)
         {
-            if (escapeCounter++ > 10)
-                return (false); // Give up
+            // Only queries, which always answer, can be stacked behind one another.
+            // Anything else may stay silent and would throw off the reply order.
+            if (_inFlight >= pipelineDepth() || command->responseType != MY1690_RESPONSE_NUMBER ||
+                _queue[_queueHead].responseType != MY1690_RESPONSE_NUMBER)
+                break;
+        }
+        else
+        {
+            _response[0] = '\0';
+            _sentAt = millis();
+            _sentAtUs = micros();
+            _sentAlone = true;
+        }
 
-            delay(1); // At 9600bps 1 byte takes 0.8ms
+        writeCommand(command);
+        recordSent(command);
+
+        if (command->attempts == 0)
+        {
+            unsigned long latency = micros() - command->submittedMicros;
+            _dispatchLatencyUs[command->priority] = latency;
+            if (latency > _maxDispatchLatencyUs[command->priority])
+                _maxDispatchLatencyUs[command->priority] = latency;
         }
+
+        if (command->responseType == MY1690_RESPONSE_NONE)
+            completeCommand(MY1690_STATUS_OK, 0);
+        else
+            _inFlight++;
     }
+}
 
-    if (i != expectedLength)
-        responseOK = false;
+// Pull everything the serial port has into the parser
+void SparkFunMY1690::readIncoming(void)
+{
+    unsigned long now = millis();
 
-    return (responseOK);
+#if defined(ESP32) || defined(ESP8266)
+    // These cores copy a whole block out of the UART driver in one call
+    char block[MY1690_RX_BUFFER_SIZE];
+    int count;
+    while ((count = _serialPort->available()) > 0)
+    {
+        if (count > (int)sizeof(block))
+            count = sizeof(block);
+        count = _serialPort->readBytes(block, count);
+        for (int x = 0; x < count; x++)
+            _parser.feed(block[x], now);
+    }
+#else
+    while (_serialPort->available())
+        _parser.feed(_serialPort->read(), now);
+#endif
+
+    _parser.poll(now); // Close a reply that ended without a line ending
 }
 
-// Returns false if no serial data is seen after maxTimeout
-bool SparkFunMY1690::responseAvailable(uint8_t maxTimeout)
+// The oldest framed line not already set aside as unsolicited
+MY1690Line *SparkFunMY1690::firstReplyLine(void)
 {
-    uint8_t counter = 0;
+    for (uint8_t x = 0; x < _parser.lineCount(); x++)
+    {
+        MY1690Line *line = _parser.line(x);
+        if (line->type != MY1690_LINE_NONE && line->unsolicited == false)
+            return (line);
+    }
+    return (nullptr);
+}
 
-    while (_serialPort->available() == false)
+// With nothing in flight, an 'OK' is a stale acknowledgement and is dropped.
+// Everything else was sent by the MY1690 on its own and is kept.
+void SparkFunMY1690::retainUnsolicited(void)
+{
+    MY1690Line *line;
+    while ((line = firstReplyLine()) != nullptr)
     {
-        delay(1);
+        if (line->type == MY1690_LINE_OK)
+            _parser.release(line);
+        else
+            line->unsolicited = true;
+    }
+    _parser.compact();
+}
 
-        if (counter++ > maxTimeout)
-            return (false); // Timeout
+// Apply a framed line to the command at the head of the queue
+void SparkFunMY1690::matchReply(MY1690Line *line)
+{
+    MY1690Command *command = &_queue[_queueHead];
+
+    if (line->type == MY1690_LINE_STOP || isCardMessage(line) == true)
+    {
+        line->unsolicited = true; // Sent on its own, not a reply
+        return;
+    }
+
+    switch (command->responseType)
+    {
+    case MY1690_RESPONSE_OK:
+    {
+        MY1690Status status = (line->type == MY1690_LINE_OK) ? MY1690_STATUS_OK : MY1690_STATUS_NACK;
+        _parser.release(line);
+        completeCommand(status, 0);
+        break;
+    }
+
+    case MY1690_RESPONSE_NUMBER:
+        if (line->type == MY1690_LINE_OK)
+            _parser.release(line); // 'OK' prefix of 'OK0001 \r\n'
+        else
+        {
+            MY1690Status status = (line->type == MY1690_LINE_NUMBER) ? MY1690_STATUS_OK : MY1690_STATUS_PARSE_ERROR;
+            uint16_t value = _parser.number(line);
+            _parser.release(line);
+            completeCommand(status, value);
+        }
+        break;
+
+    default:
+        if (line->type == MY1690_LINE_OK)
+            _parser.release(line); // 'OK' prefix of 'OK1.1\r\n'
+        else
+        {
+            uint8_t length = _parser.copy(line, _response, MY1690_RESPONSE_BUFFER_SIZE);
+            _parser.release(line);
+            completeCommand(MY1690_STATUS_OK, length);
+        }
+        break;
     }
-    return (true);
 }
 
-void SparkFunMY1690::clearBuffer(void)
+// Blocks until the next reply line is framed
+// When acceptOK is false, 'OK' prefixes are skipped
+MY1690Line *SparkFunMY1690::nextLine(bool acceptOK)
 {
-    while (_serialPort->available())
+    unsigned long startTime = millis();
+
+    // A command sent by the engine waits as long as its opcode needs. Anything else, such as
+    // the second 'OK' after a reset, waits the timeout for the link.
+    uint16_t timeout = _responseTimeoutMs;
+    if (_inFlight > 0)
+        timeout = replyTimeout();
+
+    while (1)
     {
-        _serialPort->read();
-        delay(1); // 1 byte at 9600bps should take 1ms
+        readIncoming();
+
+        MY1690Line *line;
+        while ((line = firstReplyLine()) != nullptr)
+        {
+            if (line->type == MY1690_LINE_STOP)
+                line->unsolicited = true;
+            else if (line->type == MY1690_LINE_OK && acceptOK == false)
+                _parser.release(line);
+            else
+                return (line);
+        }
+        _parser.compact();
+
+        if (_parser.receiving() == false && millis() - startTime > timeout)
+            return (nullptr); // Timeout
+        idle();
     }
-    return;
 }
 
-void SparkFunMY1690::sendCommand(uint8_t commandLength)
+// Record the result of the command at the head of the queue and remove it
+void SparkFunMY1690::completeCommand(MY1690Status status, uint16_t value)
 {
-    clearBuffer(); // Clear anything in the buffer
+    if (retryCommand(status) == true)
+        return;
+
+    // Only the last try is learned from, so one command backs the timeout off once
+    learnTimeout(&_queue[_queueHead], status);
 
-    _serialPort->write(MP3_START_CODE);
-    _serialPort->write(commandLength + 2); // Add one byte for 'length', one for CRC
+    _completedSinceIdle = true;
+    MY1690Command command = _queue[_queueHead];
 
-    // Begin sending command bytes while calc'ing CRC
-    byte crc = commandLength + 2;
-    for (byte x = 0; x < commandLength; x++) // Length + command code + parameter
+    _queueHead = (_queueHead + 1) % MY1690_QUEUE_SIZE;
+    _queueCount--;
+    if (_inFlight > 0)
+        _inFlight--;
+
+    // The next pipelined command starts its wait now
+    if (_inFlight > 0)
     {
-        _serialPort->write(commandBytes[x]); // Send this byte
-        crc ^= commandBytes[x];              // XOR this byte to the CRC
+        _response[0] = '\0';
+        _sentAt = millis();
+        _sentAtUs = micros();
+        _sentAlone = false; // Answered partly while waiting on the one before
     }
 
-    _serialPort->write(crc); // Send CRC
-    _serialPort->write(MP3_END_CODE);
-}
\ No newline at end of file
+    // A volume reply is the real level unless more volume changes are still queued
+    if (command.opcode == MP3_COMMAND_GET_VOLUME && status == MY1690_STATUS_OK && volumeChangesQueued() == false)
+        _volumeEstimate = value;
+
+    updateState(&command, status, value);
+    recordCompleted(&command, status);
+
+    // Any reply at all shows the MY1690 is still listening
+    if (status != MY1690_STATUS_TIMEOUT)
+        _consecutiveTimeouts = 0;
+    else if (_resetThreshold > 0 && ++_consecutiveTimeouts >= _resetThreshold && _recoveryStep == 0)
+        escalate();
+
+    finishCommand(&command, status, value);
+}
+
+// Post the result and tell whoever is listening. Called last so the callbacks are free to submit more commands.
+void SparkFunMY1690::finishCommand(const MY1690Command *command, MY1690Status status, uint16_t value)
+{
+    if (command->handle == MY1690_INVALID_HANDLE)
+        return; // Cancelled after it was sent, and already reported
+
+    MY1690Result *result = &_results[_resultNext];
+    result->handle = command->handle;
+    result->status = status;
+    result->value = value;
+    _resultNext = (_resultNext + 1) % MY1690_RESULT_SLOTS;
+
+    if (_onCommandCompleted != nullptr)
+        _onCommandCompleted(command, status, value, _onCommandCompletedContext);
+    if (command->callback != nullptr)
+        command->callback(command->handle, status, value, command->context);
+}
+
+MY1690CommandClass SparkFunMY1690::commandClass(uint8_t opcode)
+{
+    switch (opcode)
+    {
+    case MP3_COMMAND_SET_VOLUME:
+    case MP3_COMMAND_SET_EQ_MODE:
+    case MP3_COMMAND_SET_LOOP_MODE:
+    case MP3_COMMAND_SET_BUSY_LEVEL:
+    case MP3_COMMAND_SELECT_TRACK_PLAY:
+    case MP3_COMMAND_STOP:
+        return (MY1690_CLASS_SETTER);
+
+    default:
+        if (expectedResponse(opcode) == MY1690_RESPONSE_OK || expectedResponse(opcode) == MY1690_RESPONSE_NONE)
+            return (MY1690_CLASS_ACTION);
+        return (MY1690_CLASS_QUERY);
+    }
+}
+
+// Puts the head command back to be sent again once its backoff has passed
+// Returns false if the command has to complete with this status instead
+bool SparkFunMY1690::retryCommand(MY1690Status status)
+{
+    if (status != MY1690_STATUS_TIMEOUT && status != MY1690_STATUS_PARSE_ERROR)
+        return (false);
+
+    // Replies to queries pipelined behind it would be taken as the reply to the retry
+    if (_inFlight != 1)
+        return (false);
+
+    MY1690Command *command = &_queue[_queueHead];
+    MY1690RetryPolicy *policy = &_retryPolicy[commandClass(command->opcode)];
+    if (command->retry == false || command->attempts >= policy->retries)
+        return (false);
+
+    recordCompleted(command, status); // Each attempt shows up in the stats
+
+    command->attempts++;
+    _inFlight = 0;
+    _retryCount++;
+
+    _holding = true;
+    _holdUntil = millis() + ((unsigned long)policy->backoffMs << (command->attempts - 1));
+    return (true);
+}
+
+// Too many timeouts in a row. Reset the MY1690 ahead of anything else queued, then put its settings back.
+void SparkFunMY1690::escalate(void)
+{
+    _consecutiveTimeouts = 0;
+
+    // Taken now, the reset clears the cache
+    _restoreMask = 0;
+    if (_cacheEnabled == true)
+    {
+        for (uint8_t field = MY1690_STATE_VOLUME; field <= MY1690_STATE_PLAY_MODE; field++)
+        {
+            if (_stateValid & (1 << field))
+            {
+                _restoreMask |= (1 << field);
+                _restoreValue[field] = _stateValue[field];
+            }
+        }
+    }
+
+    if (insertNext(MP3_COMMAND_RESET, 0, 0, recoveryComplete, this) == MY1690_INVALID_HANDLE)
+    {
+        _restoreMask = 0; // Queue is full, try again on the next run of timeouts
+        return;
+    }
+
+    _volumeEstimate = MY1690_VOLUME_UNKNOWN;
+    _recoveryStep = 1;
+    _recoveryCount++;
+}
+
+// Queues the next saved setting, one at a time so each goes out before the commands that were waiting
+void SparkFunMY1690::restoreNext(void)
+{
+    static const uint8_t restoreOpcodes[] = {MP3_COMMAND_SET_VOLUME, MP3_COMMAND_SET_EQ_MODE,
+                                             MP3_COMMAND_SET_LOOP_MODE};
+
+    for (uint8_t field = MY1690_STATE_VOLUME; field <= MY1690_STATE_PLAY_MODE; field++)
+    {
+        if ((_restoreMask & (1 << field)) == 0)
+            continue;
+
+        _restoreMask &= ~(1 << field);
+        if (insertNext(restoreOpcodes[field], _restoreValue[field], 1, recoveryComplete, this) !=
+            MY1690_INVALID_HANDLE)
+            return;
+    }
+
+    _restoreMask = 0;
+    _recoveryStep = 0;
+}
+
+void SparkFunMY1690::recoveryComplete(MY1690Handle handle, MY1690Status status, uint16_t value, void *context)
+{
+    (void)handle;
+    (void)value;
+    SparkFunMY1690 *player = (SparkFunMY1690 *)context;
+
+    if (player->_recoveryStep == 1)
+    {
+        if (status != MY1690_STATUS_OK)
+        {
+            // Still not answering. The next run of timeouts tries again.
+            player->_restoreMask = 0;
+            player->_recoveryStep = 0;
+            return;
+        }
+
+        // Let the 'STOPMP3' and second 'OK' of the reset go by before restoring anything
+        player->_recoveryStep = 2;
+        player->_holding = true;
+        player->_holdUntil = millis() + MY1690_RESET_SETTLE_MS;
+    }
+
+    player->restoreNext();
+}
+
+void SparkFunMY1690::setRetryPolicy(MY1690CommandClass commandClass, uint8_t retries, uint16_t backoffMs)
+{
+    if (commandClass >= MY1690_CLASSES)
+        return;
+    _retryPolicy[commandClass].retries = retries;
+    _retryPolicy[commandClass].backoffMs = backoffMs;
+}
+
+void SparkFunMY1690::setResetThreshold(uint8_t timeouts)
+{
+    _resetThreshold = timeouts;
+    _consecutiveTimeouts = 0;
+}
+
+uint16_t SparkFunMY1690::getRetryCount(void)
+{
+    return (_retryCount);
+}
+
+uint16_t SparkFunMY1690::getRecoveryCount(void)
+{
+    return (_recoveryCount);
+}
+
+MY1690Status SparkFunMY1690::getLastStatus(void)
+{
+    return (_lastStatus);
+}
+
+MY1690Status SparkFunMY1690::getResult(MY1690Handle handle, uint16_t *value)
+{
+    if (handle == MY1690_INVALID_HANDLE)
+        return (MY1690_STATUS_INVALID);
+
+    if (queuedCommand(handle) != nullptr)
+        return (MY1690_STATUS_PENDING);
+
+    for (uint8_t x = 0; x < MY1690_RESULT_SLOTS; x++)
+    {
+        if (_results[x].handle == handle)
+        {
+            if (value != nullptr)
+                *value = _results[x].value;
+            return ((MY1690Status)_results[x].status);
+        }
+    }
+
+    return (MY1690_STATUS_INVALID);
+}
+
+// Returns the command with a handle if it is still queued or waiting on a reply, otherwise nullptr
+MY1690Command *SparkFunMY1690::queuedCommand(MY1690Handle handle)
+{
+    for (uint8_t x = 0; x < _queueCount; x++)
+    {
+        MY1690Command *command = &_queue[(_queueHead + x) % MY1690_QUEUE_SIZE];
+        if (command->handle == handle)
+            return (command);
+    }
+    return (nullptr);
+}
+
+MY1690Status SparkFunMY1690::waitFor(MY1690Handle handle, uint16_t *value)
+{
+    MY1690Status status;
+    while ((status = getResult(handle, value)) == MY1690_STATUS_PENDING)
+    {
+        update();
+        idle();
+    }
+    return (status);
+}
+
+bool SparkFunMY1690::cancel(MY1690Handle handle)
+{
+    if (handle == MY1690_INVALID_HANDLE)
+        return (false);
+    MY1690Command *command = queuedCommand(handle);
+    if (command == nullptr)
+        return (false);
+
+    MY1690Command cancelled = *command;
+    uint8_t position = (command - _queue + MY1690_QUEUE_SIZE - _queueHead) % MY1690_QUEUE_SIZE;
+    if (position < _inFlight)
+    {
+        // Left to take its reply, so the ones behind it still match up
+        command->handle = MY1690_INVALID_HANDLE;
+        command->callback = nullptr;
+        command->retry = false;
+    }
+    else
+    {
+        for (uint8_t x = position + 1; x < _queueCount; x++)
+            _queue[(_queueHead + x - 1) % MY1690_QUEUE_SIZE] = _queue[(_queueHead + x) % MY1690_QUEUE_SIZE];
+        _queueCount--;
+    }
+    _cancelledCount++;
+
+    // Last, so the callback sees a consistent queue
+    finishCommand(&cancelled, MY1690_STATUS_CANCELLED, 0);
+    return (true);
+}
+
+uint8_t SparkFunMY1690::cancelAll(void)
+{
+    // Taken first, as the callbacks are free to submit more
+    MY1690Handle handles[MY1690_QUEUE_SIZE];
+    uint8_t count = _queueCount;
+    for (uint8_t x = 0; x < count; x++)
+        handles[x] = _queue[(_queueHead + x) % MY1690_QUEUE_SIZE].handle;
+
+    uint8_t cancelled = 0;
+    for (uint8_t x = 0; x < count; x++)
+    {
+        if (cancel(handles[x]) == true)
+            cancelled++;
+    }
+    return (cancelled);
+}
+
+uint8_t SparkFunMY1690::commandsPending(void)
+{
+    return (_queueCount);
+}
+
+uint16_t SparkFunMY1690::getCancelledCount(void)
+{
+    return (_cancelledCount);
+}
+
+unsigned long SparkFunMY1690::getDispatchLatencyUs(MY1690Priority priority)
+{
+    if (priority >= MY1690_PRIORITIES)
+        return (0);
+    return (_dispatchLatencyUs[priority]);
+}
+
+unsigned long SparkFunMY1690::getMaxDispatchLatencyUs(MY1690Priority priority)
+{
+    if (priority >= MY1690_PRIORITIES)
+        return (0);
+    return (_maxDispatchLatencyUs[priority]);
+}
+
+void SparkFunMY1690::resetDispatchLatency(void)
+{
+    for (uint8_t x = 0; x < MY1690_PRIORITIES; x++)
+    {
+        _dispatchLatencyUs[x] = 0;
+        _maxDispatchLatencyUs[x] = 0;
+    }
+}
+
+void SparkFunMY1690::setSleepHook(MY1690SleepHook hook, void *context)
+{
+    _sleepHook = hook;
+    _sleepContext = context;
+}
+
+void SparkFunMY1690::platformSleep(uint32_t maxMs, void *context)
+{
+    (void)maxMs;
+    (void)context;
+#if defined(__AVR__)
+    // The CPU stops but the UART, pin change and timer interrupts still wake it
+    set_sleep_mode(SLEEP_MODE_IDLE);
+    sleep_enable();
+    sleep_cpu();
+    sleep_disable();
+#elif defined(ESP32) || defined(ESP8266)
+    delay(1);
+#elif defined(ARDUINO_ARCH_SAMD) || defined(ARDUINO_ARCH_STM32)
+    __asm__ volatile("wfi"); // SysTick wakes it within a millisecond
+#else
+    yield();
+#endif
+}
+
+// How long the library can sleep before it next has to act, in milliseconds
+uint32_t SparkFunMY1690::sleepBudget(void)
+{
+    if (_serialPort != nullptr && _serialPort->available() > 0)
+        return (0);
+    if (_busySlot >= 0 && (_tracksStarted != _startedReported || _tracksFinished != _finishedReported))
+        return (0);
+
+    unsigned long now = millis();
+    if (_holding == true)
+    {
+        long left = (long)(_holdUntil - now);
+        return (left > 0 ? left : 0);
+    }
+    if (_queueCount > _inFlight && _inFlight == 0)
+        return (0); // Ready to send
+
+    if (_inFlight > 0)
+    {
+        unsigned long waited = now - _sentAt;
+        uint16_t timeout = replyTimeout();
+        return (waited < timeout ? timeout - waited : 0);
+    }
+    return (MY1690_IDLE_SLEEP_MS);
+}
+
+void SparkFunMY1690::idle(void)
+{
+    _woken = false;
+
+    // The caller has not seen the command that just completed, and may have more to send
+    bool completed = _completedSinceIdle;
+    _completedSinceIdle = false;
+
+    uint32_t budget;
+    if (_sleepHook == nullptr || completed == true || (budget = sleepBudget()) == 0)
+    {
+        yield();
+        return;
+    }
+
+    unsigned long asleepAt = micros();
+    _sleepHook(budget, _sleepContext);
+    _wokeAt = micros();
+    _woken = true;
+    _wakeUpdated = false;
+
+    _sleepCount++;
+    uint32_t asleep = _wokeAt - asleepAt + _timeAsleepUs;
+    _timeAsleepMs += asleep / 1000;
+    _timeAsleepUs = asleep % 1000;
+}
+
+// Measures how quickly a frame goes out after waking
+void SparkFunMY1690::frameWritten(void)
+{
+    if (_woken == false)
+        return;
+    _woken = false;
+
+    _wakeLatencyUs = micros() - _wokeAt;
+    if (_wakeLatencyUs > _maxWakeLatencyUs)
+        _maxWakeLatencyUs = _wakeLatencyUs;
+}
+
+unsigned long SparkFunMY1690::getWakeLatencyUs(void)
+{
+    return (_wakeLatencyUs);
+}
+
+unsigned long SparkFunMY1690::getMaxWakeLatencyUs(void)
+{
+    return (_maxWakeLatencyUs);
+}
+
+uint32_t SparkFunMY1690::getSleepCount(void)
+{
+    return (_sleepCount);
+}
+
+uint32_t SparkFunMY1690::getTimeAsleepMs(void)
+{
+    return (_timeAsleepMs);
+}
+
+bool SparkFunMY1690::volumeChangesQueued(void)
+{
+    for (uint8_t x = 0; x < _queueCount; x++)
+    {
+        uint8_t opcode = _queue[(_queueHead + x) % MY1690_QUEUE_SIZE].opcode;
+        if (opcode == MP3_COMMAND_SET_VOLUME || opcode == MP3_COMMAND_VOLUME_UP || opcode == MP3_COMMAND_VOLUME_DOWN)
+            return (true);
+    }
+    return (false);
+}
+
+void SparkFunMY1690::setPipelineDepth(uint8_t depth)
+{
+    if (depth < 1)
+        depth = 1;
+    if (depth > MY1690_QUEUE_SIZE)
+        depth = MY1690_QUEUE_SIZE;
+    _pipelineDepth = depth;
+}
+
+void SparkFunMY1690::setCoalescing(bool enable)
+{
+    _coalescing = enable;
+}
+
+void SparkFunMY1690::setBaudRate(uint32_t baudRate)
+{
+    if (baudRate == 0)
+        return;
+    if (baudRate != _baudRate)
+        resetAdaptiveTimeout(); // Learned times include the bytes on the wire
+    _baudRate = baudRate;
+
+    uint32_t byteTimeUs = 10000000UL / baudRate; // 8N1 is ten bits per byte
+    _responseTimeoutMs = MY1690_DEVICE_LATENCY_MS + (MY1690_LATENCY_BYTES * byteTimeUs) / 1000;
+    _interbyteTimeoutMs = MY1690_DEVICE_GAP_MS + (MY1690_GAP_BYTES * byteTimeUs) / 1000;
+    _parser.setInterbyteTimeout(_interbyteTimeoutMs);
+}
+
+uint32_t SparkFunMY1690::getBaudRate(void)
+{
+    return (_baudRate);
+}
+
+uint16_t SparkFunMY1690::getResponseTimeout(void)
+{
+    return (_responseTimeoutMs);
+}
+
+uint16_t SparkFunMY1690::getResponseTimeout(uint8_t opcode)
+{
+#if MY1690_ENABLE_ADAPTIVE_TIMEOUT
+    int8_t index = statsIndex(opcode);
+    if (_adaptiveTimeout == false || index < 0)
+        return (_responseTimeoutMs);
+    MY1690LatencyEstimate *estimate = &_latency[index];
+
+    uint32_t timeout = _responseTimeoutMs;
+    if (estimate->samples >= MY1690_ADAPTIVE_SAMPLES)
+    {
+        // RTO = SRTT + 4 * RTTVAR, rounded up to the next millisecond
+        timeout = (estimate->srtt + 4UL * estimate->rttvar + 7) / 8;
+
+        // Never shorter than the frame and the start of the reply take on the wire
+        uint32_t shortest = (MY1690_LATENCY_BYTES * 10000UL) / _baudRate + MY1690_ADAPTIVE_MARGIN_MS;
+        if (timeout < shortest)
+            timeout = shortest;
+    }
+
+    timeout <<= estimate->backoffs;
+    if (timeout > MY1690_ADAPTIVE_MAX_MS)
+        timeout = MY1690_ADAPTIVE_MAX_MS;
+    return (timeout);
+#else
+    (void)opcode;
+    return (_responseTimeoutMs);
+#endif
+}
+
+uint16_t SparkFunMY1690::getInterbyteTimeout(void)
+{
+    return (_interbyteTimeoutMs);
+}
+
+// How long the command at the head of the queue waits for its reply
+uint16_t SparkFunMY1690::replyTimeout(void)
+{
+    // Replies to cancelled queries come first, and say nothing about this command
+    if (_discardReplies > 0)
+        return (_responseTimeoutMs);
+    return (getResponseTimeout(_queue[_queueHead].opcode));
+}
+
+void SparkFunMY1690::enableAdaptiveTimeout(bool enable)
+{
+    _adaptiveTimeout = enable;
+}
+
+void SparkFunMY1690::resetAdaptiveTimeout(void)
+{
+#if MY1690_ENABLE_ADAPTIVE_TIMEOUT
+    memset(_latency, 0, sizeof(_latency));
+#endif
+}
+
+// Fold the head command's reply time into what is known about its opcode
+void SparkFunMY1690::learnTimeout(const MY1690Command *command, MY1690Status status)
+{
+#if MY1690_ENABLE_ADAPTIVE_TIMEOUT
+    int8_t index = statsIndex(command->opcode);
+    if (index < 0 || command->responseType == MY1690_RESPONSE_NONE)
+        return;
+    MY1690LatencyEstimate *estimate = &_latency[index];
+
+    if (status == MY1690_STATUS_TIMEOUT)
+    {
+        // Back off, as TCP does, until a reply gets through
+        if (estimate->backoffs < 8)
+            estimate->backoffs++;
+        return;
+    }
+
+    // A retry's reply may be to the first try, and a pipelined reply was partly made while waiting
+    if (status != MY1690_STATUS_OK || command->attempts > 0 || _sentAlone == false)
+        return;
+
+    uint32_t sample = (micros() - _sentAtUs) / 125; // Eighths of a millisecond
+    if (sample > 0xFFFF)
+        sample = 0xFFFF;
+
+    // The device has changed pace since the last reply timed, so the old average is no guide
+    if (estimate->samples == 0 || estimate->backoffs > 0)
+    {
+        estimate->srtt = sample;
+        estimate->rttvar = sample / 2;
+        estimate->backoffs = 0;
+    }
+    else
+    {
+        int32_t error = (int32_t)sample - estimate->srtt;
+        estimate->srtt += error / 8;
+        if (error < 0)
+            error = -error;
+        estimate->rttvar += (error - (int32_t)estimate->rttvar) / 4;
+    }
+    if (estimate->samples < 255)
+        estimate->samples++;
+#else
+    (void)command;
+    (void)status;
+#endif
+}
+
+// Sum of every byte ahead of the checksum. Starts from a seed so an all-zero table fails.
+uint8_t SparkFunMY1690::tableChecksum(const MY1690TimeoutTable *table)
+{
+    const uint8_t *bytes = (const uint8_t *)table;
+    uint8_t sum = 0xA5;
+    for (size_t x = 0; x < offsetof(MY1690TimeoutTable, checksum); x++)
+        sum += bytes[x];
+    return (sum);
+}
+
+void SparkFunMY1690::getTimeoutTable(MY1690TimeoutTable &table)
+{
+    memset(&table, 0, sizeof(table)); // Padding too, so the checksum is repeatable
+    table.magic = MY1690_TIMEOUT_TABLE_MAGIC;
+    table.commands = MY1690_STATS_COMMANDS;
+    table.baudRate = _baudRate;
+#if MY1690_ENABLE_ADAPTIVE_TIMEOUT
+    memcpy(table.estimates, _latency, sizeof(_latency));
+#endif
+    table.checksum = tableChecksum(&table);
+}
+
+bool SparkFunMY1690::setTimeoutTable(const MY1690TimeoutTable &table)
+{
+#if MY1690_ENABLE_ADAPTIVE_TIMEOUT
+    if (table.magic != MY1690_TIMEOUT_TABLE_MAGIC || table.commands != MY1690_STATS_COMMANDS ||
+        table.baudRate != _baudRate || table.checksum != tableChecksum(&table))
+        return (false);
+
+    memcpy(_latency, table.estimates, sizeof(_latency));
+    return (true);
+#else
+    (void)table;
+    return (false);
+#endif
+}
+
+uint16_t SparkFunMY1690::getCoalescedCount(void)
+{
+    return (_coalescedCount);
+}
+
+const char *SparkFunMY1690::getResponseString(void)
+{
+    return (_response);
+}
+
+// Submit a command and block until it completes
+MY1690Status SparkFunMY1690::transact(uint8_t opcode, uint16_t param, uint8_t paramLength, uint16_t *value)
+{
+    MY1690Handle handle;
+    while ((handle = submit(opcode, param, paramLength)) == MY1690_INVALID_HANDLE)
+    {
+        update(); // Queue is full, let it drain
+        idle();
+    }
+
+    _lastStatus = waitFor(handle, value);
+    return (_lastStatus);
+}
+
+// The frames of the commands sent most, built by the compiler. Returns nullptr if the command has none.
+static const uint8_t *fixedFrame(const MY1690Command *command, uint8_t &length)
+{
+    if (command->paramLength == 0)
+    {
+        length = MY1690Frame<MP3_COMMAND_PLAY>::length;
+        switch (command->opcode)
+        {
+        case MP3_COMMAND_PLAY:
+            return (MY1690Frame<MP3_COMMAND_PLAY>::bytes);
+        case MP3_COMMAND_PAUSE:
+            return (MY1690Frame<MP3_COMMAND_PAUSE>::bytes);
+        case MP3_COMMAND_STOP:
+            return (MY1690Frame<MP3_COMMAND_STOP>::bytes);
+        }
+    }
+    else if (command->paramLength == 1 && command->opcode == MP3_COMMAND_SET_LOOP_MODE)
+    {
+        length = MY1690Frame<MP3_COMMAND_SET_LOOP_MODE, MP3_LOOP_MODE_FULL>::length;
+        switch (command->param[0])
+        {
+        case MP3_LOOP_MODE_FULL:
+            return (MY1690Frame<MP3_COMMAND_SET_LOOP_MODE, MP3_LOOP_MODE_FULL>::bytes);
+        case MP3_LOOP_MODE_FOLDER:
+            return (MY1690Frame<MP3_COMMAND_SET_LOOP_MODE, MP3_LOOP_MODE_FOLDER>::bytes);
+        case MP3_LOOP_MODE_SINGLE:
+            return (MY1690Frame<MP3_COMMAND_SET_LOOP_MODE, MP3_LOOP_MODE_SINGLE>::bytes);
+        case MP3_LOOP_MODE_RANDOM:
+            return (MY1690Frame<MP3_COMMAND_SET_LOOP_MODE, MP3_LOOP_MODE_RANDOM>::bytes);
+        case MP3_LOOP_MODE_NO_LOOP:
+            return (MY1690Frame<MP3_COMMAND_SET_LOOP_MODE, MP3_LOOP_MODE_NO_LOOP>::bytes);
+        }
+    }
+    return (nullptr);
+}
+
+void SparkFunMY1690::writeCommand(MY1690Command *command)
+{
+    // One write per frame lets the UART driver take the whole thing at once
+    uint8_t frame[MP3_NUM_CMD_BYTES];
+    uint8_t length;
+    const uint8_t *fixed = fixedFrame(command, length);
+    if (fixed != nullptr)
+        memcpy_P(frame, fixed, length);
+    else
+        length = buildFrame(frame, command->opcode, command->param, command->paramLength);
+    _serialPort->write(frame, length);
+    frameWritten();
+}
+
+bool SparkFunMY1690::writeFrame(const uint8_t *frame, uint8_t length)
+{
+    if (_serialPort == nullptr || _queueCount > 0 || length < 5)
+        return (false);
+
+    _serialPort->write(frame, length);
+    frameWritten();
+
+    // Keep the cache in step as if the command had gone through the queue
+    MY1690Command command;
+    command.opcode = frame[2];
+    command.paramLength = length - 5;
+    command.param[0] = command.paramLength > 0 ? frame[3] : 0;
+    command.param[1] = command.paramLength > 1 ? frame[4] : 0;
+    command.responseType = MY1690_RESPONSE_NONE;
+    command.handle = MY1690_INVALID_HANDLE;
+    command.callback = nullptr;
+    command.context = nullptr;
+    command.attempts = 0;
+    updateState(&command, MY1690_STATUS_OK, 0);
+
+    if (_onCommandCompleted != nullptr)
+        _onCommandCompleted(&command, MY1690_STATUS_OK, 0, _onCommandCompletedContext);
+
+    return (true);
+}
+
+MY1690LineType SparkFunMY1690::readUnsolicited(char *buffer, uint8_t bufferSize)
+{
+    for (uint8_t x = 0; x < _parser.lineCount(); x++)
+    {
+        MY1690Line *line = _parser.line(x);
+        if (line->type != MY1690_LINE_NONE && line->unsolicited == true)
+        {
+            MY1690LineType type = (MY1690LineType)line->type;
+            if (buffer != nullptr)
+                _parser.copy(line, buffer, bufferSize);
+            _parser.release(line);
+            _parser.compact();
+            return (type);
+        }
+    }
+    return (MY1690_LINE_NONE);
+}
+
+void SparkFunMY1690::onStop(MY1690EventCallback callback, void *context)
+{
+    _onStop = callback;
+    _onStopContext = context;
+}
+
+void SparkFunMY1690::onCardChange(MY1690CardCallback callback, void *context)
+{
+    _onCardChange = callback;
+    _onCardChangeContext = context;
+}
+
+void SparkFunMY1690::onMessage(MY1690MessageCallback callback, void *context)
+{
+    _onMessage = callback;
+    _onMessageContext = context;
+}
+
+void SparkFunMY1690::setCardMessages(const char *inserted, const char *removed)
+{
+    _cardInsertedMessage = inserted;
+    _cardRemovedMessage = removed;
+}
+
+uint16_t SparkFunMY1690::getStopCount(void)
+{
+    return (_stopCount);
+}
+
+unsigned long SparkFunMY1690::getStopMicros(void)
+{
+    return (_stopMicros);
+}
+
+bool SparkFunMY1690::isCardMessage(const MY1690Line *line)
+{
+    if (line->type != MY1690_LINE_STRING)
+        return (false);
+    return (_parser.equals(line, _cardInsertedMessage) || _parser.equals(line, _cardRemovedMessage));
+}
+
+// The oldest unsolicited line not yet offered to the handlers
+MY1690Line *SparkFunMY1690::nextUndispatched(void)
+{
+    for (uint8_t x = 0; x < _parser.lineCount(); x++)
+    {
+        MY1690Line *line = _parser.line(x);
+        if (line->type != MY1690_LINE_NONE && line->unsolicited == true && line->dispatched == false)
+            return (line);
+    }
+    return (nullptr);
+}
+
+// Hand each new unsolicited line to its handler
+// Lines without a handler stay for readUnsolicited()
+void SparkFunMY1690::dispatchUnsolicited(void)
+{
+    MY1690Line *line;
+    while ((line = nextUndispatched()) != nullptr)
+    {
+        line->dispatched = true; // Before any handler runs, so a handler that calls update() skips it
+
+        if (line->type == MY1690_LINE_STOP)
+        {
+            _stopCount++;
+            _stopMicros = micros();
+            if (_cacheEnabled == true)
+                storeState(MY1690_STATE_PLAY_STATUS, 0); // No need to ask
+
+            if (_onStop != nullptr)
+            {
+                _parser.release(line);
+                _parser.compact();
+                _onStop(_stopMicros, _onStopContext);
+            }
+        }
+        else if (_parser.equals(line, "MP3"))
+        {
+            _parser.release(line); // Tail of the 'STOPMP3' sent after a reset
+            _parser.compact();
+        }
+        else if (isCardMessage(line) == true)
+        {
+            bool inserted = _parser.equals(line, _cardInsertedMessage);
+            _stateValid &= ~(1 << MY1690_STATE_PLAY_STATUS); // Playback stops with the card
+
+            if (_onCardChange != nullptr)
+            {
+                _parser.release(line);
+                _parser.compact();
+                _onCardChange(inserted, _onCardChangeContext);
+            }
+        }
+        else if (_onMessage != nullptr)
+        {
+            char message[MY1690_RESPONSE_BUFFER_SIZE];
+            _parser.copy(line, message, sizeof(message));
+            _parser.release(line);
+            _parser.compact();
+            _onMessage(message, _onMessageContext);
+        }
+    }
+}
+
+MY1690ResponseParser::MY1690ResponseParser()
+{
+    for (uint8_t x = 0; x < MY1690_RX_LINE_SLOTS; x++)
+        _lines[x].type = MY1690_LINE_NONE;
+}
+
+void MY1690ResponseParser::feed(char incoming, unsigned long now)
+{
+    _lastByteAt = now;
+
+    if (incoming == '\r')
+        return; // Line endings are not stored
+
+    if (incoming == '\n')
+    {
+        if (_partialLength > 0)
+            closeLine(MY1690_LINE_NUMBER); // Classified by closeLine()
+        return;
+    }
+
+    if (_used == MY1690_RX_BUFFER_SIZE)
+    {
+        // Make room by throwing out the oldest line. If the partial line fills
+        // the whole buffer it is garbage, so close it and start over.
+        if (dropOldest() == false)
+        {
+            closeLine(MY1690_LINE_STRING);
+            dropOldest();
+        }
+    }
+
+    uint8_t partialStart = (_tail + _used - _partialLength) % MY1690_RX_BUFFER_SIZE;
+    _buffer[(partialStart + _partialLength) % MY1690_RX_BUFFER_SIZE] = incoming;
+    _partialLength++;
+    _used++;
+
+    // 'OK' and 'STOP' don't always get a line ending, so frame them as soon as they are complete
+    if (_partialLength == 2 && charAt(partialStart, 0) == 'O' && incoming == 'K')
+        closeLine(MY1690_LINE_OK);
+    else if (_partialLength == 4 && charAt(partialStart, 0) == 'S' && charAt(partialStart, 1) == 'T' &&
+             charAt(partialStart, 2) == 'O' && incoming == 'P')
+    {
+        closeLine(MY1690_LINE_STOP);
+        _afterStop = true;
+    }
+}
+
+void MY1690ResponseParser::poll(unsigned long now)
+{
+    // The device can take a few ms between response chars
+    if (_partialLength > 0 && now - _lastByteAt > _interbyteTimeoutMs)
+        closeLine(MY1690_LINE_NUMBER); // Classified by closeLine()
+}
+
+void MY1690ResponseParser::setInterbyteTimeout(uint16_t milliseconds)
+{
+    _interbyteTimeoutMs = milliseconds;
+}
+
+bool MY1690ResponseParser::receiving(void)
+{
+    return (_partialLength > 0);
+}
+
+uint8_t MY1690ResponseParser::lineCount(void)
+{
+    return (_lineCount);
+}
+
+MY1690Line *MY1690ResponseParser::line(uint8_t index)
+{
+    return (&_lines[(_lineHead + index) % MY1690_RX_LINE_SLOTS]);
+}
+
+void MY1690ResponseParser::release(MY1690Line *line)
+{
+    line->type = MY1690_LINE_NONE;
+}
+
+void MY1690ResponseParser::compact(void)
+{
+    // Cheap case, freed lines at the front
+    while (_lineCount > 0 && _lines[_lineHead].type == MY1690_LINE_NONE)
+    {
+        _tail = (_tail + _lines[_lineHead].length) % MY1690_RX_BUFFER_SIZE;
+        _used -= _lines[_lineHead].length;
+        _lineHead = (_lineHead + 1) % MY1690_RX_LINE_SLOTS;
+        _lineCount--;
+    }
+
+    // Freed lines behind a kept one, typically replies read after an unsolicited 'STOP'.
+    // Slide the kept bytes toward the tail so the holes don't fill the buffer.
+    uint8_t kept = 0;
+    uint8_t write = _tail;
+    for (uint8_t x = 0; x < _lineCount; x++)
+    {
+        MY1690Line current = _lines[(_lineHead + x) % MY1690_RX_LINE_SLOTS];
+        if (current.type == MY1690_LINE_NONE)
+            continue;
+
+        for (uint8_t i = 0; i < current.length; i++)
+            _buffer[(write + i) % MY1690_RX_BUFFER_SIZE] = charAt(current.start, i);
+        current.start = write;
+        write = (write + current.length) % MY1690_RX_BUFFER_SIZE;
+
+        _lines[(_lineHead + kept) % MY1690_RX_LINE_SLOTS] = current;
+        kept++;
+    }
+
+    if (kept == _lineCount)
+        return; // Nothing was freed
+
+    uint8_t partialStart = (_tail + _used - _partialLength) % MY1690_RX_BUFFER_SIZE;
+    for (uint8_t i = 0; i < _partialLength; i++)
+        _buffer[(write + i) % MY1690_RX_BUFFER_SIZE] = charAt(partialStart, i);
+
+    _lineCount = kept;
+    _used = ((write + MY1690_RX_BUFFER_SIZE - _tail) % MY1690_RX_BUFFER_SIZE) + _partialLength;
+}
+
+uint16_t MY1690ResponseParser::number(const MY1690Line *line)
+{
+    uint16_t responseValue = 0;
+    uint8_t length = trimmedLength(line);
+
+    for (uint8_t i = 0; i < length && i < 4; i++)
+    {
+        char incoming = charAt(line->start, i);
+
+        // Convert ASCII HEX values to decimal
+        responseValue <<= 4;
+        if (incoming >= '0' && incoming <= '9')
+            responseValue += (incoming - '0');
+        else if (incoming >= 'A' && incoming <= 'F')
+            responseValue += (incoming - 'A') + 10;
+        else if (incoming >= 'a' && incoming <= 'f')
+            responseValue += (incoming - 'a') + 10;
+    }
+    return (responseValue);
+}
+
+bool MY1690ResponseParser::equals(const MY1690Line *line, const char *text)
+{
+    uint8_t length = trimmedLength(line);
+    uint8_t i = 0;
+
+    for (; i < length; i++)
+    {
+        if (text[i] != charAt(line->start, i))
+            return (false);
+    }
+
+    return (text[i] == '\0' || text[i] == '\r' || text[i] == '\n');
+}
+
+uint8_t MY1690ResponseParser::copy(const MY1690Line *line, char *buffer, uint8_t bufferSize)
+{
+    if (bufferSize == 0)
+        return (0);
+
+    uint8_t length = trimmedLength(line);
+    if (length > bufferSize - 1)
+        length = bufferSize - 1;
+
+    for (uint8_t i = 0; i < length; i++)
+        buffer[i] = charAt(line->start, i);
+    buffer[length] = '\0';
+    return (length);
+}
+
+uint16_t MY1690ResponseParser::getDroppedLines(void)
+{
+    return (_droppedLines);
+}
+
+char MY1690ResponseParser::charAt(uint8_t start, uint8_t offset)
+{
+    return (_buffer[(start + offset) % MY1690_RX_BUFFER_SIZE]);
+}
+
+// Length without the trailing space v1.1 adds after a number
+uint8_t MY1690ResponseParser::trimmedLength(const MY1690Line *line)
+{
+    uint8_t length = line->length;
+    while (length > 0 && charAt(line->start, length - 1) == ' ')
+        length--;
+    return (length);
+}
+
+// Turn the partial line into a framed line
+// Number and string lines are told apart here
+void MY1690ResponseParser::closeLine(uint8_t type)
+{
+    if (_lineCount == MY1690_RX_LINE_SLOTS)
+        dropOldest();
+
+    MY1690Line *line = &_lines[(_lineHead + _lineCount) % MY1690_RX_LINE_SLOTS];
+    line->start = (_tail + _used - _partialLength) % MY1690_RX_BUFFER_SIZE;
+    line->length = _partialLength;
+    line->unsolicited = false;
+    line->dispatched = false;
+    _partialLength = 0;
+    _lineCount++;
+
+    if (type == MY1690_LINE_NUMBER || type == MY1690_LINE_STRING)
+    {
+        uint8_t length = trimmedLength(line);
+        type = (length > 0 && length <= 4) ? MY1690_LINE_NUMBER : MY1690_LINE_STRING;
+        for (uint8_t i = 0; i < length; i++)
+        {
+            char c = charAt(line->start, i);
+            if ((c < '0' || c > '9') && (c < 'A' || c > 'F') && (c < 'a' || c > 'f'))
+                type = MY1690_LINE_STRING;
+        }
+
+        if (length == 0)
+            type = MY1690_LINE_NONE; // Blank line, nothing to keep
+
+        // After a reset the IC sends 'STOPMP3\r\n'. The 'MP3' is part of the message, not a reply.
+        if (_afterStop == true && length == 3 && charAt(line->start, 0) == 'M' && charAt(line->start, 1) == 'P' &&
+            charAt(line->start, 2) == '3')
+            line->unsolicited = true;
+    }
+    _afterStop = false;
+    line->type = type;
+
+    compact();
+}
+
+// Free the oldest line to make room, whether or not it has been read
+bool MY1690ResponseParser::dropOldest(void)
+{
+    if (_lineCount == 0)
+        return (false);
+
+    if (_lines[_lineHead].type != MY1690_LINE_NONE)
+        _droppedLines++;
+    _lines[_lineHead].type = MY1690_LINE_NONE;
+    compact();
+    return (true);
+}
+
+void SparkFunMY1690::enableStateCache(bool enable)
+{
+    _cacheEnabled = enable;
+    _stateValid = 0;
+}
+
+void SparkFunMY1690::setCacheLifetime(MY1690StateField field, uint16_t milliseconds)
+{
+    if (field < MY1690_STATE_FIELDS)
+        _stateLifetime[field] = milliseconds;
+}
+
+void SparkFunMY1690::invalidateStateCache(void)
+{
+    _stateValid = 0;
+}
+
+MY1690State SparkFunMY1690::getState(void)
+{
+    static const uint8_t queries[MY1690_STATE_FIELDS] = {MP3_COMMAND_GET_VOLUME, MP3_COMMAND_GET_EQ,
+                                                         MP3_COMMAND_GET_LOOP_MODE, MP3_COMMAND_GET_STATUS};
+    MY1690Handle handles[MY1690_STATE_FIELDS];
+
+    // Queue a refresh of every stale field, then wait for all of them
+    for (uint8_t x = 0; x < MY1690_STATE_FIELDS; x++)
+    {
+        handles[x] = MY1690_INVALID_HANDLE;
+        uint8_t cached;
+        if (cachedState((MY1690StateField)x, &cached) == false)
+        {
+            while ((handles[x] = submit(queries[x])) == MY1690_INVALID_HANDLE)
+            {
+                update(); // Queue is full, let it drain
+                idle();
+            }
+        }
+    }
+
+    // Results land in the cache through updateState(). Read the values here as well
+    // in case the cache is disabled.
+    uint16_t value[MY1690_STATE_FIELDS] = {0};
+    for (uint8_t x = 0; x < MY1690_STATE_FIELDS; x++)
+    {
+        if (handles[x] == MY1690_INVALID_HANDLE)
+            value[x] = _stateValue[x];
+        else
+            waitFor(handles[x], &value[x]);
+    }
+
+    MY1690State state;
+    state.volume = value[MY1690_STATE_VOLUME];
+    state.eq = value[MY1690_STATE_EQ];
+    state.playMode = value[MY1690_STATE_PLAY_MODE];
+    state.playStatus = value[MY1690_STATE_PLAY_STATUS];
+    return (state);
+}
+
+MY1690Status SparkFunMY1690::getSnapshot(MY1690Snapshot &snapshot, uint16_t timeoutMs)
+{
+    static const uint8_t queries[MY1690_SNAPSHOT_FIELDS] = {
+        MP3_COMMAND_GET_STATUS,        MP3_COMMAND_GET_VOLUME,       MP3_COMMAND_GET_EQ,
+        MP3_COMMAND_GET_LOOP_MODE,     MP3_COMMAND_GET_CURRENT_TRACK, MP3_COMMAND_GET_CURRENT_TRACK_TIME,
+        MP3_COMMAND_GET_CURRENT_TRACK_TIME_TOTAL};
+
+    unsigned long startUs = micros();
+    unsigned long startMs = millis();
+
+    memset(&snapshot, 0, sizeof(snapshot));
+    _snapshot = &snapshot;
+    _snapshotDone = 0;
+    _snapshotStatus = MY1690_STATUS_OK;
+    for (uint8_t x = 0; x < MY1690_SNAPSHOT_FIELDS; x++)
+        _snapshotHandles[x] = MY1690_INVALID_HANDLE;
+
+    MY1690Status result = MY1690_STATUS_OK;
+    uint8_t submitted = 0;
+    while (_snapshotDone != MY1690_SNAPSHOT_ALL)
+    {
+        // Queue the rest as space frees up
+        while (submitted < MY1690_SNAPSHOT_FIELDS)
+        {
+            MY1690Handle handle = submit(queries[submitted], 0, 0, snapshotReply, this);
+            if (handle == MY1690_INVALID_HANDLE)
+                break; // Queue is full
+            _snapshotHandles[submitted++] = handle;
+        }
+
+        if (millis() - startMs >= timeoutMs)
+        {
+            result = MY1690_STATUS_TIMEOUT;
+            break;
+        }
+
+        update();
+        idle();
+    }
+
+    // Nothing is left behind in the queue. Replies to queries already sent are dropped by snapshotReply().
+    _snapshot = nullptr;
+    for (uint8_t x = 0; x < submitted; x++)
+    {
+        if ((_snapshotDone & (1 << x)) == 0)
+            cancel(_snapshotHandles[x]);
+    }
+
+    if (result == MY1690_STATUS_OK)
+        result = _snapshotStatus;
+
+    snapshot.takenUs = micros() - startUs;
+    return (result);
+}
+
+// Queries that may be on the wire at once. A snapshot's own queries all answer with numbers, in order,
+// so they can go together whatever the depth, as long as nothing else is queued.
+uint8_t SparkFunMY1690::pipelineDepth(void)
+{
+    if (_snapshot == nullptr)
+        return (_pipelineDepth);
+
+    for (uint8_t x = 0; x < _queueCount; x++)
+    {
+        if (_queue[(_queueHead + x) % MY1690_QUEUE_SIZE].callback != snapshotReply)
+            return (_pipelineDepth);
+    }
+    return (MY1690_QUEUE_SIZE);
+}
+
+void SparkFunMY1690::snapshotReply(MY1690Handle handle, MY1690Status status, uint16_t value, void *context)
+{
+    SparkFunMY1690 *player = (SparkFunMY1690 *)context;
+    MY1690Snapshot *snapshot = player->_snapshot;
+    if (snapshot == nullptr)
+        return; // getSnapshot() has already given up
+
+    uint8_t field = 0;
+    while (field < MY1690_SNAPSHOT_FIELDS && player->_snapshotHandles[field] != handle)
+        field++;
+    if (field == MY1690_SNAPSHOT_FIELDS)
+        return;
+
+    player->_snapshotDone |= (1 << field);
+    if (status != MY1690_STATUS_OK)
+    {
+        if (player->_snapshotStatus == MY1690_STATUS_OK)
+            player->_snapshotStatus = status;
+        return;
+    }
+
+    snapshot->valid |= (1 << field);
+    switch (field)
+    {
+    case MY1690_SNAPSHOT_PLAY_STATUS:
+        snapshot->playStatus = value;
+        break;
+    case MY1690_SNAPSHOT_VOLUME:
+        snapshot->volume = value;
+        break;
+    case MY1690_SNAPSHOT_EQ:
+        snapshot->eq = value;
+        break;
+    case MY1690_SNAPSHOT_PLAY_MODE:
+        snapshot->playMode = value;
+        break;
+    case MY1690_SNAPSHOT_TRACK_NUMBER:
+        snapshot->trackNumber = value;
+        break;
+    case MY1690_SNAPSHOT_ELAPSED_TIME:
+        snapshot->elapsedTime = value;
+        break;
+    case MY1690_SNAPSHOT_TOTAL_TIME:
+        snapshot->totalTime = value;
+        break;
+    }
+}
+
+void SparkFunMY1690::storeState(MY1690StateField field, uint8_t value)
+{
+    _stateValue[field] = value;
+    _stateTime[field] = millis();
+    _stateValid |= (1 << field);
+}
+
+// Returns true, and the value, if the field is cached and still fresh
+bool SparkFunMY1690::cachedState(MY1690StateField field, uint8_t *value)
+{
+    if (_cacheEnabled == false || (_stateValid & (1 << field)) == 0)
+        return (false);
+
+    if (millis() - _stateTime[field] >= _stateLifetime[field])
+        return (false); // Stale
+
+    *value = _stateValue[field];
+    return (true);
+}
+
+// Write-through of completed commands into the state cache
+void SparkFunMY1690::updateState(const MY1690Command *command, MY1690Status status, uint16_t value)
+{
+    if (_cacheEnabled == false || status != MY1690_STATUS_OK)
+        return;
+
+    switch (command->opcode)
+    {
+    case MP3_COMMAND_GET_VOLUME:
+        storeState(MY1690_STATE_VOLUME, value);
+        break;
+    case MP3_COMMAND_GET_EQ:
+        storeState(MY1690_STATE_EQ, value);
+        break;
+    case MP3_COMMAND_GET_LOOP_MODE:
+        storeState(MY1690_STATE_PLAY_MODE, value);
+        break;
+    case MP3_COMMAND_GET_STATUS:
+        storeState(MY1690_STATE_PLAY_STATUS, value);
+        break;
+
+    case MP3_COMMAND_SET_VOLUME:
+        storeState(MY1690_STATE_VOLUME, command->param[0] > 30 ? 30 : command->param[0]);
+        break;
+    case MP3_COMMAND_VOLUME_UP:
+        if ((_stateValid & (1 << MY1690_STATE_VOLUME)) && _stateValue[MY1690_STATE_VOLUME] < 30)
+            storeState(MY1690_STATE_VOLUME, _stateValue[MY1690_STATE_VOLUME] + 1);
+        break;
+    case MP3_COMMAND_VOLUME_DOWN:
+        if ((_stateValid & (1 << MY1690_STATE_VOLUME)) && _stateValue[MY1690_STATE_VOLUME] > 0)
+            storeState(MY1690_STATE_VOLUME, _stateValue[MY1690_STATE_VOLUME] - 1);
+        break;
+    case MP3_COMMAND_SET_EQ_MODE:
+        storeState(MY1690_STATE_EQ, command->param[0]);
+        break;
+    case MP3_COMMAND_SET_LOOP_MODE:
+        storeState(MY1690_STATE_PLAY_MODE, command->param[0]);
+        break;
+
+    case MP3_COMMAND_PLAY:
+    case MP3_COMMAND_NEXT:
+    case MP3_COMMAND_PREVIOUS:
+    case MP3_COMMAND_SELECT_TRACK_PLAY:
+        storeState(MY1690_STATE_PLAY_STATUS, 1);
+        break;
+    case MP3_COMMAND_PAUSE:
+        storeState(MY1690_STATE_PLAY_STATUS, 2);
+        break;
+    case MP3_COMMAND_STOP:
+        storeState(MY1690_STATE_PLAY_STATUS, 0);
+        break;
+    case MP3_COMMAND_PLAY_PAUSE:
+    case MP3_COMMAND_FASTFOWARD:
+    case MP3_COMMAND_REWIND:
+        _stateValid &= ~(1 << MY1690_STATE_PLAY_STATUS);
+        break;
+
+    case MP3_COMMAND_RESET:
+        _stateValid = 0; // Back to power-on defaults, whatever the firmware says they are
+        break;
+
+    default:
+        break;
+    }
+}
+
+// Opcodes in the order of their stats slots
+static const uint8_t statsOpcodes[MY1690_STATS_COMMANDS] PROGMEM = {
+    MP3_COMMAND_PLAY,
+    MP3_COMMAND_PAUSE,
+    MP3_COMMAND_NEXT,
+    MP3_COMMAND_PREVIOUS,
+    MP3_COMMAND_VOLUME_UP,
+    MP3_COMMAND_VOLUME_DOWN,
+    MP3_COMMAND_RESET,
+    MP3_COMMAND_FASTFOWARD,
+    MP3_COMMAND_REWIND,
+    MP3_COMMAND_PLAY_PAUSE,
+    MP3_COMMAND_STOP,
+    MP3_COMMAND_SET_VOLUME,
+    MP3_COMMAND_SET_EQ_MODE,
+    MP3_COMMAND_SET_LOOP_MODE,
+    MP3_COMMAND_SET_BUSY_LEVEL,
+    MP3_COMMAND_SELECT_TRACK_PLAY,
+    MP3_COMMAND_GET_STATUS,
+    MP3_COMMAND_GET_VOLUME,
+    MP3_COMMAND_GET_EQ,
+    MP3_COMMAND_GET_LOOP_MODE,
+    MP3_COMMAND_GET_VERSION_NUMBER,
+    MP3_COMMAND_GET_SONG_COUNT,
+    MP3_COMMAND_GET_CURRENT_TRACK,
+    MP3_COMMAND_GET_CURRENT_TRACK_TIME,
+    MP3_COMMAND_GET_CURRENT_TRACK_TIME_TOTAL,
+    MP3_COMMAND_GET_CURRENT_TRACK_NAME,
+    MP3_COMMAND_GET_SONGS_IN_FOLDER_COUNT,
+};
+
+// Returns the stats slot of an opcode, -1 if the opcode is unknown
+int8_t SparkFunMY1690::statsIndex(uint8_t opcode)
+{
+    for (uint8_t x = 0; x < MY1690_STATS_COMMANDS; x++)
+    {
+        if (pgm_read_byte(&statsOpcodes[x]) == opcode)
+            return (x);
+    }
+    return (-1);
+}
+
+void SparkFunMY1690::recordSent(MY1690Command *command)
+{
+#if MY1690_ENABLE_STATS
+    command->sentMicros = micros();
+
+    int8_t index = statsIndex(command->opcode);
+    if (index >= 0)
+        _stats[index].sent++;
+#else
+    (void)command;
+#endif
+}
+
+void SparkFunMY1690::recordCompleted(const MY1690Command *command, MY1690Status status)
+{
+#if MY1690_ENABLE_STATS
+    int8_t index = statsIndex(command->opcode);
+    if (index < 0)
+        return;
+    MY1690CommandStats *stats = &_stats[index];
+
+    if (status == MY1690_STATUS_TIMEOUT)
+    {
+        stats->timeouts++;
+        return; // No round trip to record
+    }
+
+    if (status == MY1690_STATUS_OK)
+        stats->ok++;
+    else
+        stats->parseErrors++;
+
+    uint32_t roundTrip = micros() - command->sentMicros;
+    if (stats->ok + stats->parseErrors == 1 || roundTrip < stats->minUs)
+        stats->minUs = roundTrip;
+    if (roundTrip > stats->maxUs)
+        stats->maxUs = roundTrip;
+    stats->totalUs += roundTrip;
+
+    static const uint8_t binLimitsMs[MY1690_STATS_HISTOGRAM_BINS - 1] = {5, 10, 20, 50, 100};
+    uint8_t bin = 0;
+    while (bin < MY1690_STATS_HISTOGRAM_BINS - 1 && roundTrip >= binLimitsMs[bin] * 1000UL)
+        bin++;
+    stats->histogram[bin]++;
+#else
+    (void)command;
+    (void)status;
+#endif
+}
+
+const MY1690CommandStats *SparkFunMY1690::getStats(uint8_t opcode)
+{
+#if MY1690_ENABLE_STATS
+    int8_t index = statsIndex(opcode);
+    if (index >= 0)
+        return (&_stats[index]);
+#else
+    (void)opcode;
+#endif
+    return (nullptr);
+}
+
+void SparkFunMY1690::resetStats(void)
+{
+#if MY1690_ENABLE_STATS
+    memset(_stats, 0, sizeof(_stats));
+#endif
+}
+
+void SparkFunMY1690::printStats(Print &out)
+{
+#if MY1690_ENABLE_STATS
+    out.println(F("Cmd   Sent  OK    Tmout PErr  Min(us) Mean(us) Max(us) <5ms <10 <20 <50 <100 >=100"));
+    for (uint8_t x = 0; x < MY1690_STATS_COMMANDS; x++)
+    {
+        MY1690CommandStats *stats = &_stats[x];
+        if (stats->sent == 0)
+            continue;
+
+        uint16_t completed = stats->ok + stats->parseErrors;
+
+        out.print(F("0x"));
+        out.print(pgm_read_byte(&statsOpcodes[x]), HEX);
+        out.print(F("  "));
+        out.print(stats->sent);
+        out.print(F("\t"));
+        out.print(stats->ok);
+        out.print(F("\t"));
+        out.print(stats->timeouts);
+        out.print(F("\t"));
+        out.print(stats->parseErrors);
+        out.print(F("\t"));
+        out.print(stats->minUs);
+        out.print(F("\t"));
+        out.print(completed > 0 ? stats->totalUs / completed : 0);
+        out.print(F("\t"));
+        out.print(stats->maxUs);
+        for (uint8_t bin = 0; bin < MY1690_STATS_HISTOGRAM_BINS; bin++)
+        {
+            out.print(F("\t"));
+            out.print(stats->histogram[bin]);
+        }
+        out.println();
+    }
+#else
+    out.println(F("Stats are disabled. Set MY1690_ENABLE_STATS to 1 to record them."));
+#endif
+}
+
+SparkFunMY1690 *SparkFunMY1690::_busyOwners[MY1690_BUSY_INTERRUPT_SLOTS] = {nullptr, nullptr};
+
+// attachInterrupt() takes a plain function, so each slot gets its own trampoline
+void MY1690_ISR_ATTR SparkFunMY1690::busyInterrupt0(void)
+{
+    if (_busyOwners[0] != nullptr)
+        _busyOwners[0]->busyEdge();
+}
+
+void MY1690_ISR_ATTR SparkFunMY1690::busyInterrupt1(void)
+{
+    if (_busyOwners[1] != nullptr)
+        _busyOwners[1]->busyEdge();
+}
+
+bool SparkFunMY1690::enableBusyInterrupt(bool enable, uint16_t debounceUs)
+{
+    if (_busyPin == 255)
+        return (false);
+
+    if (enable == false)
+    {
+        if (_busySlot >= 0)
+        {
+            detachInterrupt(digitalPinToInterrupt(_busyPin));
+            _busyOwners[_busySlot] = nullptr;
+            _busySlot = -1;
+        }
+        return (true);
+    }
+
+    int interrupt = digitalPinToInterrupt(_busyPin);
+#ifdef NOT_AN_INTERRUPT
+    if (interrupt == NOT_AN_INTERRUPT)
+        return (false);
+#endif
+
+    _busyDebounceUs = debounceUs;
+
+    if (_busySlot < 0)
+    {
+        for (uint8_t x = 0; x < MY1690_BUSY_INTERRUPT_SLOTS; x++)
+        {
+            if (_busyOwners[x] == nullptr)
+            {
+                _busySlot = x;
+                break;
+            }
+        }
+        if (_busySlot < 0)
+            return (false); // All slots taken
+
+        // Start from the current level so an already playing track is not reported as a new one
+        _busyLevel = (digitalRead(_busyPin) == HIGH);
+        _busyEdgeMicros = micros() - debounceUs;
+        _startedReported = _tracksStarted;
+        _finishedReported = _tracksFinished;
+
+        _busyOwners[_busySlot] = this;
+        attachInterrupt(interrupt, _busySlot == 0 ? busyInterrupt0 : busyInterrupt1, CHANGE);
+    }
+
+    return (true);
+}
+
+// Runs in the interrupt. Accepts an edge that changes the debounced level and is not bounce from the last one.
+void MY1690_ISR_ATTR SparkFunMY1690::busyEdge(void)
+{
+    unsigned long now = micros();
+    bool level = (digitalRead(_busyPin) == HIGH);
+
+    if (level == _busyLevel)
+        return;
+    if (now - _busyEdgeMicros < _busyDebounceUs)
+        return; // Still settling. update() catches the level if it sticks.
+
+    _busyLevel = level;
+    _busyEdgeMicros = now;
+    if (level == true)
+    {
+        _trackStartedMicros = now;
+        _tracksStarted++;
+    }
+    else
+    {
+        _trackFinishedMicros = now;
+        _tracksFinished++;
+    }
+}
+
+// Called from update(). Raises the events for edges the interrupt has recorded since last time.
+void SparkFunMY1690::dispatchBusyEvents(void)
+{
+    // An edge swallowed by the debounce window leaves the pin at a level the interrupt never accepted
+    noInterrupts();
+    if ((digitalRead(_busyPin) == HIGH) != _busyLevel)
+        busyEdge();
+    uint16_t started = _tracksStarted;
+    uint16_t finished = _tracksFinished;
+    unsigned long startedAt = _trackStartedMicros;
+    unsigned long finishedAt = _trackFinishedMicros;
+    interrupts();
+
+    bool newStart = (started != _startedReported);
+    bool newFinish = (finished != _finishedReported);
+    if (newStart == false && newFinish == false)
+        return;
+
+    _startedReported = started;
+    _finishedReported = finished;
+
+    // The busy pin says nothing about pause versus stop, so only mark the status stale
+    _stateValid &= ~(1 << MY1690_STATE_PLAY_STATUS);
+
+    // Both can be pending after a slow loop. Report them in the order they happened.
+    bool finishFirst = newStart && newFinish && (long)(startedAt - finishedAt) > 0;
+
+    if (newFinish && finishFirst && _onTrackFinished != nullptr)
+        _onTrackFinished(finishedAt, _onTrackFinishedContext);
+    if (newStart && _onTrackStarted != nullptr)
+        _onTrackStarted(startedAt, _onTrackStartedContext);
+    if (newFinish && finishFirst == false && _onTrackFinished != nullptr)
+        _onTrackFinished(finishedAt, _onTrackFinishedContext);
+}
+
+void SparkFunMY1690::onCommandCompleted(MY1690CommandObserver observer, void *context)
+{
+    _onCommandCompleted = observer;
+    _onCommandCompletedContext = context;
+}
+
+void SparkFunMY1690::onTrackStarted(MY1690EventCallback callback, void *context)
+{
+    _onTrackStarted = callback;
+    _onTrackStartedContext = context;
+}
+
+void SparkFunMY1690::onTrackFinished(MY1690EventCallback callback, void *context)
+{
+    _onTrackFinished = callback;
+    _onTrackFinishedContext = context;
+}
+
+uint16_t SparkFunMY1690::getTracksStarted(void)
+{
+    noInterrupts();
+    uint16_t count = _tracksStarted;
+    interrupts();
+    return (count);
+}
+
+uint16_t SparkFunMY1690::getTracksFinished(void)
+{
+    noInterrupts();
+    uint16_t count = _tracksFinished;
+    interrupts();
+    return (count);
+}
+
+unsigned long SparkFunMY1690::getTrackStartedMicros(void)
+{
+    noInterrupts();
+    unsigned long timestamp = _trackStartedMicros;
+    interrupts();
+    return (timestamp);
+}
+
+bool SparkFunMY1690::isBusyInterruptEnabled(void)
+{
+    return (_busySlot >= 0);
+}
+
+unsigned long SparkFunMY1690::getTrackFinishedMicros(void)
+{
+    noInterrupts();
+    unsigned long timestamp = _trackFinishedMicros;
+    interrupts();
+    return (timestamp);
+}
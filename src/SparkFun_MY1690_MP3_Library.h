@@ -73,6 +73,483 @@
 #define MP3_START_CODE 0x7E
 #define MP3_END_CODE 0xEF
 
+#define MY1690_BAUD_RATE 9600        // What the MY1690 talks at out of the box
+#define MY1690_BEGIN_TIMEOUT_MS 2000 // Datasheet says MY1690 needs 1.5s after power-on
+
+// Timeouts are these device delays plus the time the bytes take on the wire at the link speed
+#define MY1690_DEVICE_LATENCY_MS 90 // Time the MY1690 takes to start a reply. 100ms in all at 9600bps.
+#define MY1690_DEVICE_GAP_MS 2      // Pause the MY1690 can leave between characters. 10ms in all at 9600bps.
+#define MY1690_LATENCY_BYTES 10     // A command frame going out plus the first characters of the reply
+#define MY1690_GAP_BYTES 8          // Character times of silence that end a reply with no line ending
+
+// Number of commands that can wait to be sent to the MY1690
+#ifndef MY1690_QUEUE_SIZE
+#define MY1690_QUEUE_SIZE 4
+#endif
+
+// Number of completed results kept around for getResult()
+#ifndef MY1690_RESULT_SLOTS
+#define MY1690_RESULT_SLOTS 4
+#endif
+
+// Number of queries that may be sent before the first one has been answered
+#ifndef MY1690_PIPELINE_DEPTH
+#define MY1690_PIPELINE_DEPTH 1
+#endif
+
+#define MY1690_RESPONSE_BUFFER_SIZE 13 // Longest string reply kept for getResponseString(), an 8.3 name and null
+
+// Bytes of received replies the parser can hold, including unsolicited lines waiting to be read
+#ifndef MY1690_RX_BUFFER_SIZE
+#define MY1690_RX_BUFFER_SIZE 32
+#endif
+
+// Number of framed lines the parser can hold
+#ifndef MY1690_RX_LINE_SLOTS
+#define MY1690_RX_LINE_SLOTS 4
+#endif
+
+// Set to 1 to record per-command counters and round trip times, see printStats()
+// Costs about 32 bytes of RAM per command the library knows, nothing when left at 0
+#ifndef MY1690_ENABLE_STATS
+#define MY1690_ENABLE_STATS 0
+#endif
+
+#define MY1690_STATS_COMMANDS 27        // Number of MP3_COMMAND_ opcodes
+#define MY1690_STATS_HISTOGRAM_BINS 6   // <5ms, <10ms, <20ms, <50ms, <100ms, >=100ms
+
+// Set to 1 to learn reply times for enableAdaptiveTimeout()
+// Costs 6 bytes of RAM per command the library knows, nothing when left at 0
+#ifndef MY1690_ENABLE_ADAPTIVE_TIMEOUT
+#define MY1690_ENABLE_ADAPTIVE_TIMEOUT 0
+#endif
+
+#define MY1690_ADAPTIVE_SAMPLES 4         // Replies timed for a command before its learned timeout is used
+#define MY1690_ADAPTIVE_MARGIN_MS 5       // Kept over the time the bytes take on the wire by the shortest timeout
+#define MY1690_ADAPTIVE_MAX_MS 2000       // Longest learned timeout
+#define MY1690_TIMEOUT_TABLE_MAGIC 0x4D55 // Start of a valid MY1690TimeoutTable. Changes when its layout does.
+
+// Edges on the busy pin closer together than this are treated as bounce, see enableBusyInterrupt()
+#ifndef MY1690_BUSY_DEBOUNCE_US
+#define MY1690_BUSY_DEBOUNCE_US 1000
+#endif
+
+#define MY1690_BUSY_INTERRUPT_SLOTS 2 // Players that can have a busy pin interrupt attached at once
+
+// Interrupt handlers must sit in IRAM on the Espressif parts
+#if defined(ESP32) || defined(ESP8266)
+#define MY1690_ISR_ATTR IRAM_ATTR
+#else
+#define MY1690_ISR_ATTR
+#endif
+
+// Retries for commands that are safe to send twice, see setRetryPolicy()
+#ifndef MY1690_RETRIES
+#define MY1690_RETRIES 2
+#endif
+#define MY1690_RETRY_BACKOFF_MS 20 // Wait before the first retry. Doubles for each one after.
+
+// Longest a sleep hook is asked to sleep when nothing is due, see idle()
+#define MY1690_IDLE_SLEEP_MS 100
+
+// Timeouts in a row, after retries, that make the engine reset the MY1690. 0 never resets.
+#ifndef MY1690_RESET_AFTER_TIMEOUTS
+#define MY1690_RESET_AFTER_TIMEOUTS 3
+#endif
+#define MY1690_RESET_SETTLE_MS 100 // The second 'OK' of a reset arrives ~85ms after the first
+
+// Messages the MY1690 sends when the SD card is inserted or removed, see setCardMessages()
+#ifndef MY1690_CARD_INSERTED_MESSAGE
+#define MY1690_CARD_INSERTED_MESSAGE "TF IN"
+#endif
+#ifndef MY1690_CARD_REMOVED_MESSAGE
+#define MY1690_CARD_REMOVED_MESSAGE "TF OUT"
+#endif
+
+#define MY1690_INVALID_HANDLE 0
+#define MY1690_VOLUME_UNKNOWN 0xFF
+
+/*!
+ * @brief The kind of reply the MY1690 sends back for a command.
+ */
+typedef enum
+{
+    MY1690_RESPONSE_NONE = 0, // Nothing comes back (play, stop and set volume in v1.1)
+    MY1690_RESPONSE_OK,       // 'OK' with no line ending
+    MY1690_RESPONSE_NUMBER,   // Four hex digits, ie '0001 \r\n' or 'OK0001 \r\n'
+    MY1690_RESPONSE_STRING,   // A line of text, ie 'OK1.1\r\n'
+} MY1690ResponseType;
+
+/*!
+ * @brief The outcome of a command submitted to the engine.
+ */
+typedef enum
+{
+    MY1690_STATUS_PENDING = 0, // Still queued or waiting on the device
+    MY1690_STATUS_OK,          // Device replied as expected
+    MY1690_STATUS_TIMEOUT,     // Device did not reply in time
+    MY1690_STATUS_PARSE_ERROR, // Device answered a query with something that isn't a valid reply
+    MY1690_STATUS_INVALID,     // Unknown handle, or its result has been recycled
+    MY1690_STATUS_NACK,        // Device answered a control command with something other than 'OK'
+    MY1690_STATUS_CANCELLED,   // Query dropped to make way for a high priority command
+} MY1690Status;
+
+/*!
+ * @brief Groups of commands that share a retry policy.
+ */
+typedef enum
+{
+    MY1690_CLASS_QUERY = 0, // Reads, always safe to repeat
+    MY1690_CLASS_SETTER,    // Absolute settings such as set volume and select track, safe to repeat
+    MY1690_CLASS_ACTION,    // Steps and toggles such as next, volume up and play/pause, never repeated
+    MY1690_CLASSES,         // Number of classes
+} MY1690CommandClass;
+
+typedef struct
+{
+    uint8_t retries;    // Extra attempts after a timeout or garbled reply
+    uint16_t backoffMs; // Wait before the first retry, doubled for each one after
+} MY1690RetryPolicy;
+
+typedef uint8_t MY1690Handle;
+
+/*!
+ * @brief Called from update() when a submitted command completes.
+ *
+ * @param handle The handle that submit() returned for this command.
+ * @param status How the command completed.
+ * @param value The number the device replied with, or the length of a string reply.
+ * @param context The pointer passed to submit().
+ */
+typedef void (*MY1690Callback)(MY1690Handle handle, MY1690Status status, uint16_t value, void *context);
+
+/*!
+ * @brief Called from update() when a track starts or finishes.
+ *
+ * @param edgeMicros The micros() timestamp of the busy pin edge, taken in the interrupt,
+ *                   or of the 'STOP' message being read.
+ * @param context The pointer passed to onTrackStarted(), onTrackFinished() or onStop().
+ */
+typedef void (*MY1690EventCallback)(unsigned long edgeMicros, void *context);
+
+/*!
+ * @brief Called from update() when the MY1690 reports the SD card going in or out.
+ *
+ * @param inserted true when a card was inserted, false when it was removed.
+ * @param context The pointer passed to onCardChange().
+ */
+typedef void (*MY1690CardCallback)(bool inserted, void *context);
+
+/*!
+ * @brief Called from update() with any other line the MY1690 sent on its own.
+ *
+ * @param message The line, null terminated, without its line ending.
+ * @param context The pointer passed to onMessage().
+ */
+typedef void (*MY1690MessageCallback)(const char *message, void *context);
+
+/*!
+ * @brief Called while the library waits, to put the microcontroller to sleep. See setSleepHook().
+ *
+ * Must return when a byte arrives on the serial port or the busy pin changes, and by
+ * maxMs at the latest.
+ *
+ * @param maxMs The longest the library can afford to sleep, in milliseconds.
+ * @param context The pointer passed to setSleepHook().
+ */
+typedef void (*MY1690SleepHook)(uint32_t maxMs, void *context);
+
+/*!
+ * @brief How urgently a command submitted to the engine goes out.
+ */
+typedef enum
+{
+    MY1690_PRIORITY_NORMAL = 0, // Sent in the order submitted
+    MY1690_PRIORITY_HIGH,       // Sent ahead of normal commands. Queries waiting on the device are cancelled.
+    MY1690_PRIORITIES,          // Number of priorities
+} MY1690Priority;
+
+typedef struct
+{
+    uint8_t opcode;
+    uint8_t param[2];
+    uint8_t paramLength;
+    uint8_t responseType; // MY1690ResponseType
+    uint8_t priority;     // MY1690Priority
+    unsigned long submittedMicros;
+    MY1690Handle handle;
+    MY1690Callback callback;
+    void *context;
+    uint8_t attempts; // Retries used so far
+    bool retry;       // false to give up after the first try, whatever the retry policy
+#if MY1690_ENABLE_STATS
+    unsigned long sentMicros;
+#endif
+} MY1690Command;
+
+/*!
+ * @brief Called from update() each time any command completes, before the command's own callback.
+ *
+ * @param command The command, including its opcode and parameters.
+ * @param status How the command completed.
+ * @param value The number the device replied with, or the length of a string reply.
+ * @param context The pointer passed to onCommandCompleted().
+ */
+typedef void (*MY1690CommandObserver)(const MY1690Command *command, MY1690Status status, uint16_t value,
+                                      void *context);
+
+/*!
+ * @brief Counters and round trip times recorded for one opcode when MY1690_ENABLE_STATS is 1.
+ */
+typedef struct
+{
+    uint16_t sent;
+    uint16_t ok;
+    uint16_t timeouts;
+    uint16_t parseErrors; // Replies that were garbled, or refused with a NACK
+    uint32_t minUs; // Round trip from the frame going out to the reply being parsed
+    uint32_t maxUs;
+    uint32_t totalUs; // Sum over completed replies, for the mean
+    uint16_t histogram[MY1690_STATS_HISTOGRAM_BINS];
+} MY1690CommandStats;
+
+/*!
+ * @brief Reply time learned for one opcode, smoothed the way TCP smooths round trip times.
+ */
+typedef struct
+{
+    uint16_t srtt;   // Smoothed reply time, in eighths of a millisecond
+    uint16_t rttvar; // Smoothed deviation from it, in eighths of a millisecond
+    uint8_t samples;  // Replies timed, stops counting at 255
+    uint8_t backoffs; // Timeouts since the last reply timed, each doubling the timeout
+} MY1690LatencyEstimate;
+
+/*!
+ * @brief The reply times learned for enableAdaptiveTimeout(), laid out to be stored as is.
+ *
+ * Write it with EEPROM.put() or Preferences::putBytes() and hand it back to setTimeoutTable() after a restart.
+ */
+typedef struct
+{
+    uint16_t magic;    // MY1690_TIMEOUT_TABLE_MAGIC
+    uint8_t commands;  // MY1690_STATS_COMMANDS
+    uint32_t baudRate; // Link speed the times were learned at
+    MY1690LatencyEstimate estimates[MY1690_STATS_COMMANDS];
+    uint8_t checksum;
+} MY1690TimeoutTable;
+
+typedef struct
+{
+    MY1690Handle handle;
+    uint8_t status; // MY1690Status
+    uint16_t value;
+} MY1690Result;
+
+/*!
+ * @brief Fields kept by the optional state cache.
+ */
+typedef enum
+{
+    MY1690_STATE_VOLUME = 0,
+    MY1690_STATE_EQ,
+    MY1690_STATE_PLAY_MODE,
+    MY1690_STATE_PLAY_STATUS,
+    MY1690_STATE_FIELDS, // Number of fields
+} MY1690StateField;
+
+/*!
+ * @brief A snapshot of the state cache.
+ */
+typedef struct
+{
+    uint8_t volume;     // 0-30
+    uint8_t eq;         // 0-5 (None\POP\ROCK\JAZZ\CLASSIC\BASS)
+    uint8_t playMode;   // 0-4 (Full/Folder/Single/Random/No Loop)
+    uint8_t playStatus; // 0(Stop) 1(Play) 2(Pause) 3(Fast forward) 4(Rewind)
+} MY1690State;
+
+// Fields of MY1690Snapshot, in the order their queries are sent
+typedef enum
+{
+    MY1690_SNAPSHOT_PLAY_STATUS = 0,
+    MY1690_SNAPSHOT_VOLUME,
+    MY1690_SNAPSHOT_EQ,
+    MY1690_SNAPSHOT_PLAY_MODE,
+    MY1690_SNAPSHOT_TRACK_NUMBER,
+    MY1690_SNAPSHOT_ELAPSED_TIME,
+    MY1690_SNAPSHOT_TOTAL_TIME,
+    MY1690_SNAPSHOT_FIELDS, // Number of fields
+} MY1690SnapshotField;
+
+#define MY1690_SNAPSHOT_ALL ((1 << MY1690_SNAPSHOT_FIELDS) - 1)
+#define MY1690_SNAPSHOT_TIMEOUT_MS 500 // Default time allowed for a whole snapshot
+
+/*!
+ * @brief Everything getSnapshot() reads from the device in one burst.
+ */
+typedef struct
+{
+    uint8_t playStatus;    // 0(Stop) 1(Play) 2(Pause) 3(Fast forward) 4(Rewind)
+    uint8_t volume;        // 0-30
+    uint8_t eq;            // 0-5 (None\POP\ROCK\JAZZ\CLASSIC\BASS)
+    uint8_t playMode;      // 0-4 (Full/Folder/Single/Random/No Loop)
+    uint16_t trackNumber;  // 1-based
+    uint16_t elapsedTime;  // Seconds
+    uint16_t totalTime;    // Seconds
+    uint8_t valid;         // Bit per MY1690SnapshotField that was answered
+    unsigned long takenUs; // Time the whole snapshot took
+} MY1690Snapshot;
+
+#define MY1690_CACHE_LIFETIME_SETTINGS 10000 // ms. Volume, EQ and loop mode only change when we change them.
+#define MY1690_CACHE_LIFETIME_STATUS 250     // ms. Play status changes on its own when a track ends.
+
+/*!
+ * @brief XOR of a frame's length byte, opcode and parameters. Folds to a constant when they are constants.
+ */
+constexpr uint8_t my1690FrameCRC(uint8_t value)
+{
+    return (value);
+}
+
+template <typename... Bytes> constexpr uint8_t my1690FrameCRC(uint8_t value, uint8_t next, Bytes... rest)
+{
+    return (my1690FrameCRC((uint8_t)(value ^ next), rest...));
+}
+
+/*!
+ * @brief A complete frame built at compile time, ie MY1690Frame<MP3_COMMAND_PLAY>::bytes.
+ *
+ * The CRC is folded by the compiler and the bytes are kept in flash with PROGMEM. The engine
+ * sends these for play, pause, stop and the loop modes. Copy one out with memcpy_P() before
+ * handing it to writeFrame(), since AVR and ESP8266 can't read flash through a plain pointer.
+ */
+template <uint8_t Opcode, uint8_t... Params> struct MY1690Frame
+{
+    static constexpr uint8_t length = sizeof...(Params) + 5; // Start, length, opcode, params, CRC, end
+    static const uint8_t bytes[sizeof...(Params) + 5];
+};
+
+template <uint8_t Opcode, uint8_t... Params>
+const uint8_t MY1690Frame<Opcode, Params...>::bytes[sizeof...(Params) + 5] PROGMEM = {
+    MP3_START_CODE, sizeof...(Params) + 3, Opcode, Params...,
+    my1690FrameCRC(sizeof...(Params) + 3, Opcode, Params...), MP3_END_CODE};
+
+template <uint8_t Opcode, uint8_t... Params> constexpr uint8_t MY1690Frame<Opcode, Params...>::length;
+
+/*!
+ * @brief How the parser classified a line received from the MY1690.
+ */
+typedef enum
+{
+    MY1690_LINE_NONE = 0, // Slot is free
+    MY1690_LINE_OK,       // 'OK', which is sent with no line ending
+    MY1690_LINE_STOP,     // 'STOP', sent when a track ends
+    MY1690_LINE_NUMBER,   // One to four hex digits, ie '0001 '
+    MY1690_LINE_STRING,   // Anything else, ie '1.1'
+} MY1690LineType;
+
+typedef struct
+{
+    uint8_t start;  // Offset of the first byte in the parser's ring buffer
+    uint8_t length; // Bytes stored, without the line ending
+    uint8_t type;   // MY1690LineType
+    bool unsolicited; // Not a reply to a command, kept for readUnsolicited()
+    bool dispatched;  // Counted and offered to the handlers
+} MY1690Line;
+
+/*!
+ * @class MY1690ResponseParser
+ * @brief Incremental tokenizer for the replies sent by the MY1690.
+ *
+ * Bytes are fed in as they arrive and framed into lines inside a small ring buffer.
+ * Lines end with '\n', or after the inter-byte timeout. 'OK' and 'STOP' are framed
+ * as soon as they are seen at the start of a line because the MY1690 does not always
+ * follow them with a line ending, so 'OK0001 \r\n' becomes an OK line then a number line.
+ * Lines are classified and read in place; nothing is copied until a caller asks for it.
+ */
+class MY1690ResponseParser
+{
+  public:
+    MY1690ResponseParser();
+
+    /**
+     * @brief Sets the quiet time that closes a line with no line ending.
+     */
+    void setInterbyteTimeout(uint16_t milliseconds);
+
+    /**
+     * @brief Adds one received byte.
+     *
+     * @param incoming The byte read from the serial port.
+     * @param now The current millis(), used to detect the end of a reply with no line ending.
+     */
+    void feed(char incoming, unsigned long now);
+    /**
+     * @brief Closes a partial line once the inter-byte timeout has passed.
+     */
+    void poll(unsigned long now);
+    /**
+     * @brief Returns true while a line has been started but not yet closed.
+     */
+    bool receiving(void);
+
+    /**
+     * @brief Returns the number of line slots in use, oldest first.
+     */
+    uint8_t lineCount(void);
+    /**
+     * @brief Returns a line by age, 0 being the oldest.
+     */
+    MY1690Line *line(uint8_t index);
+    /**
+     * @brief Frees a line. Its bytes are reclaimed once every older line is freed, see compact().
+     */
+    void release(MY1690Line *line);
+    /**
+     * @brief Reclaims the slots and bytes of freed lines at the front of the buffer.
+     */
+    void compact(void);
+
+    /**
+     * @brief Returns the hex value of a number line.
+     */
+    uint16_t number(const MY1690Line *line);
+    /**
+     * @brief Compares a line against text. Trailing spaces in the line and a trailing \r\n in the text are ignored.
+     */
+    bool equals(const MY1690Line *line, const char *text);
+    /**
+     * @brief Copies a line, without trailing spaces, into a null terminated buffer.
+     *
+     * @return The number of characters copied.
+     */
+    uint8_t copy(const MY1690Line *line, char *buffer, uint8_t bufferSize);
+    /**
+     * @brief Returns the number of lines thrown away because the buffer was full.
+     */
+    uint16_t getDroppedLines(void);
+
+  protected:
+    char _buffer[MY1690_RX_BUFFER_SIZE];
+    uint8_t _tail = 0; // Oldest byte held
+    uint8_t _used = 0; // Bytes held by lines and the partial line
+
+    MY1690Line _lines[MY1690_RX_LINE_SLOTS];
+    uint8_t _lineHead = 0;
+    uint8_t _lineCount = 0;
+
+    uint8_t _partialLength = 0;
+    bool _afterStop = false; // The partial line directly follows a 'STOP'
+    unsigned long _lastByteAt = 0;
+    uint16_t _interbyteTimeoutMs = 10;
+    uint16_t _droppedLines = 0;
+
+    char charAt(uint8_t start, uint8_t offset);
+    uint8_t trimmedLength(const MY1690Line *line);
+    void closeLine(uint8_t type);
+    bool dropOldest(void);
+};
+
 /*!
  * @class SparkFunMY1690
  * @brief  A library for controlling the MY1690 Serial MP3 player module.
@@ -87,8 +564,176 @@ class SparkFunMY1690
 {
 
   protected:
-    Stream *_serialPort;
-    uint8_t _busyPin;
+    Stream *_serialPort = nullptr;
+    uint8_t _busyPin = 255;
+
+    // Command engine
+    MY1690Command _queue[MY1690_QUEUE_SIZE];
+    uint8_t _queueHead = 0;
+    uint8_t _queueCount = 0;
+    MY1690Handle _nextHandle = 1;
+    uint8_t _inFlight = 0;       // Commands at the head of the queue that have been sent
+    uint8_t _discardReplies = 0; // Replies still due to cancelled queries
+    unsigned long _discardUntil = 0;
+    uint16_t _cancelledCount = 0;
+    unsigned long _dispatchLatencyUs[MY1690_PRIORITIES] = {0}; // Submit to first byte on the wire
+    unsigned long _maxDispatchLatencyUs[MY1690_PRIORITIES] = {0};
+    uint8_t _pipelineDepth = MY1690_PIPELINE_DEPTH;
+    bool _coalescing = true;
+
+    // Link timing, see setBaudRate()
+    uint32_t _baudRate = MY1690_BAUD_RATE;
+    uint16_t _responseTimeoutMs = 100;
+    uint16_t _interbyteTimeoutMs = 10;
+    uint16_t _coalescedCount = 0;
+    uint8_t _volumeEstimate = MY1690_VOLUME_UNKNOWN; // Volume once the queue drains
+    unsigned long _sentAt = 0;
+    unsigned long _sentAtUs = 0;
+    bool _sentAlone = false; // Nothing was ahead of the reply being waited on, so its time can be learned
+    uint16_t _firmwareVersion = 0; // 0 until detected
+
+    MY1690Result _results[MY1690_RESULT_SLOTS];
+    uint8_t _resultNext = 0;
+
+    MY1690ResponseParser _parser;
+    char _response[MY1690_RESPONSE_BUFFER_SIZE];
+
+#if MY1690_ENABLE_STATS
+    MY1690CommandStats _stats[MY1690_STATS_COMMANDS];
+#endif
+    static int8_t statsIndex(uint8_t opcode);
+    void recordSent(MY1690Command *command);
+    void recordCompleted(const MY1690Command *command, MY1690Status status);
+
+    // Adaptive timeouts
+    bool _adaptiveTimeout = false;
+#if MY1690_ENABLE_ADAPTIVE_TIMEOUT
+    MY1690LatencyEstimate _latency[MY1690_STATS_COMMANDS];
+#endif
+    uint16_t replyTimeout(void);
+    void learnTimeout(const MY1690Command *command, MY1690Status status);
+    static uint8_t tableChecksum(const MY1690TimeoutTable *table);
+
+    // Retries and recovery
+    MY1690RetryPolicy _retryPolicy[MY1690_CLASSES];
+    bool _holding = false; // Nothing is sent until _holdUntil, for backoff and after a reset
+    unsigned long _holdUntil = 0;
+    uint8_t _resetThreshold = MY1690_RESET_AFTER_TIMEOUTS;
+    uint8_t _consecutiveTimeouts = 0;
+    uint8_t _recoveryStep = 0; // 0 idle, 1 waiting on the reset, 2 restoring settings
+    uint8_t _restoreMask = 0;  // Bit per MY1690StateField still to restore
+    uint8_t _restoreValue[MY1690_STATE_FIELDS];
+    uint16_t _retryCount = 0;
+    uint16_t _recoveryCount = 0;
+    MY1690Status _lastStatus = MY1690_STATUS_OK;
+
+    // Low power waits
+    MY1690SleepHook _sleepHook = nullptr;
+    void *_sleepContext = nullptr;
+    bool _woken = false;       // Slept, and no frame has gone out since
+    bool _wakeUpdated = false; // update() has run since waking
+    bool _completedSinceIdle = false;
+    unsigned long _wokeAt = 0;
+    unsigned long _wakeLatencyUs = 0;
+    unsigned long _maxWakeLatencyUs = 0;
+    uint32_t _sleepCount = 0;
+    uint32_t _timeAsleepMs = 0;
+    uint16_t _timeAsleepUs = 0; // Left over below a millisecond
+    uint32_t sleepBudget(void);
+    void frameWritten(void);
+
+    static MY1690CommandClass commandClass(uint8_t opcode);
+    bool retryCommand(MY1690Status status);
+    void escalate(void);
+    void restoreNext(void);
+    static void recoveryComplete(MY1690Handle handle, MY1690Status status, uint16_t value, void *context);
+
+    // State cache
+    bool _cacheEnabled = false;
+    uint8_t _stateValid = 0; // Bit per MY1690StateField
+    uint8_t _stateValue[MY1690_STATE_FIELDS];
+    unsigned long _stateTime[MY1690_STATE_FIELDS];
+    uint16_t _stateLifetime[MY1690_STATE_FIELDS];
+
+    // Snapshot in progress. Callbacks that arrive after getSnapshot() gave up find it nullptr.
+    MY1690Snapshot *_snapshot = nullptr;
+    MY1690Handle _snapshotHandles[MY1690_SNAPSHOT_FIELDS];
+    uint8_t _snapshotDone = 0; // Bit per field completed, answered or not
+    MY1690Status _snapshotStatus = MY1690_STATUS_OK; // First field that failed
+    static void snapshotReply(MY1690Handle handle, MY1690Status status, uint16_t value, void *context);
+    uint8_t pipelineDepth(void);
+
+    // Busy pin interrupt. The volatile fields are written by the interrupt handler.
+    int8_t _busySlot = -1; // Index into _busyOwners, -1 while the interrupt is not attached
+    uint16_t _busyDebounceUs = MY1690_BUSY_DEBOUNCE_US;
+    volatile bool _busyLevel = false; // Debounced level, true while a track plays
+    volatile unsigned long _busyEdgeMicros = 0;
+    volatile unsigned long _trackStartedMicros = 0;
+    volatile unsigned long _trackFinishedMicros = 0;
+    volatile uint16_t _tracksStarted = 0;
+    volatile uint16_t _tracksFinished = 0;
+    uint16_t _startedReported = 0; // Counts already passed to the callbacks
+    uint16_t _finishedReported = 0;
+    MY1690EventCallback _onTrackStarted = nullptr;
+    void *_onTrackStartedContext = nullptr;
+    MY1690EventCallback _onTrackFinished = nullptr;
+    void *_onTrackFinishedContext = nullptr;
+
+    MY1690CommandObserver _onCommandCompleted = nullptr;
+    void *_onCommandCompletedContext = nullptr;
+
+    // Unsolicited messages
+    uint16_t _stopCount = 0;
+    unsigned long _stopMicros = 0;
+    const char *_cardInsertedMessage = MY1690_CARD_INSERTED_MESSAGE;
+    const char *_cardRemovedMessage = MY1690_CARD_REMOVED_MESSAGE;
+    MY1690EventCallback _onStop = nullptr;
+    void *_onStopContext = nullptr;
+    MY1690CardCallback _onCardChange = nullptr;
+    void *_onCardChangeContext = nullptr;
+    MY1690MessageCallback _onMessage = nullptr;
+    void *_onMessageContext = nullptr;
+
+    bool isCardMessage(const MY1690Line *line);
+    MY1690Line *nextUndispatched(void);
+    void dispatchUnsolicited(void);
+
+    static SparkFunMY1690 *_busyOwners[MY1690_BUSY_INTERRUPT_SLOTS];
+    static void busyInterrupt0(void);
+    static void busyInterrupt1(void);
+    void busyEdge(void);
+    void dispatchBusyEvents(void);
+
+    static MY1690ResponseType expectedResponse(uint8_t opcode);
+    void fillCommand(MY1690Command *command, uint8_t opcode, uint16_t param, uint8_t paramLength,
+                     MY1690Callback callback, void *context);
+    MY1690Command *queuedCommand(MY1690Handle handle);
+    MY1690Handle insertNext(uint8_t opcode, uint16_t param, uint8_t paramLength, MY1690Callback callback,
+                            void *context);
+    MY1690Handle insertAt(uint8_t position, uint8_t opcode, uint16_t param, uint8_t paramLength,
+                          MY1690Callback callback, void *context);
+    MY1690Handle submitHigh(uint8_t opcode, uint16_t param, uint8_t paramLength, MY1690Callback callback,
+                            void *context);
+    void trackVolume(uint8_t opcode, uint16_t param);
+    void cancelQueries(void);
+    void discardReplies(void);
+    void sendQueued(void);
+    void finishCommand(const MY1690Command *command, MY1690Status status, uint16_t value);
+    MY1690Handle coalesce(uint8_t opcode, uint16_t param, uint8_t paramLength, MY1690Callback callback,
+                          void *context);
+    bool volumeChangesQueued(void);
+    void writeCommand(MY1690Command *command);
+    void completeCommand(MY1690Status status, uint16_t value);
+    uint16_t probeVersion(bool retry);
+    void readIncoming(void);
+    MY1690Line *firstReplyLine(void);
+    void retainUnsolicited(void);
+    void matchReply(MY1690Line *line);
+    MY1690Line *nextLine(bool acceptOK);
+    void storeState(MY1690StateField field, uint8_t value);
+    bool cachedState(MY1690StateField field, uint8_t *value);
+    void updateState(const MY1690Command *command, MY1690Status status, uint16_t value);
+    MY1690Status transact(uint8_t opcode, uint16_t param = 0, uint8_t paramLength = 0, uint16_t *value = nullptr);
 
   public:
     uint8_t commandBytes[MP3_NUM_CMD_BYTES];
@@ -102,12 +747,14 @@ class SparkFunMY1690
      *                   Defaults to `Serial`.
      * @param pin The busy pin used to monitor the module's status.
      *            Pass 255 if no busy pin is used. Defaults to 255.
+     * @param timeoutMs How long to keep probing for the module before giving up.
+     *                  Defaults to MY1690_BEGIN_TIMEOUT_MS, enough for a module that was just powered on.
      *
      * @return Returns `true` if the initialization was successful, `false` otherwise.
      *
      * @note Call this method before using any other functions in the class.
      */
-    bool begin(Stream &serialPort = Serial, uint8_t pin = 255);
+    bool begin(Stream &serialPort = Serial, uint8_t pin = 255, uint16_t timeoutMs = MY1690_BEGIN_TIMEOUT_MS);
 
     // Control functions
     /**
@@ -266,7 +913,9 @@ class SparkFunMY1690
     /**
      * @brief Retrieves the version of the MY1690 MP3 decoder firmware.
      *
-     * @return uint16_t The version number of the firmware.
+     * The device is only asked once. begin() and isConnected() store the version they detect.
+     *
+     * @return uint16_t The version number of the firmware, 101 for v1.1. 0 if unknown.
      */
     uint16_t getVersion(void);
     /**
@@ -294,11 +943,31 @@ class SparkFunMY1690
      * @return uint16_t The total time of the track in seconds.
      */
     uint16_t getTrackTotalTime(void);
+    /**
+     * @brief Retrieves the file name of the current track.
+     *
+     * @param buffer Filled with the name, ie '0001.MP3', null terminated.
+     * @param bufferSize Size of buffer. 13 holds any 8.3 name.
+     *
+     * @return The number of characters copied, 0 if the module did not answer.
+     */
+    uint8_t getTrackName(char *buffer, uint8_t bufferSize);
+    /**
+     * @brief Retrieves the number of songs in a folder on the SD card.
+     *
+     * @param folder The folder number.
+     *
+     * @return uint16_t The number of songs in the folder. 0 if the folder is empty or missing.
+     */
+    uint16_t getSongsInFolderCount(uint8_t folder);
 
     // Helper functions
     /**
      * @brief Checks if the MP3 decoder module is connected and responsive.
      *
+     * Sends a single version request, which is never retried. Takes one round trip when
+     * the module is present, and one response timeout for the version query when it is not.
+     *
      * @return true if the module is connected and operational, false otherwise.
      */
     bool isConnected(void);
@@ -357,11 +1026,495 @@ class SparkFunMY1690
      */
     bool setPlayModeNoLoop(void); // Play a song, then stop
 
+    // Non-blocking command engine
+    /**
+     * @brief Queues a command for the MY1690 and returns immediately.
+     *
+     * The command is sent, and its reply parsed, by later calls to update().
+     * The reply the device sends is inferred from the opcode.
+     *
+     * A write that supersedes the last queued, not yet sent, command is merged into it:
+     * repeated set volume, EQ and loop mode commands keep only the last value, and a run
+     * of volume steps from a known level becomes one absolute set volume. The merged
+     * command keeps its original handle, which is returned.
+     *
+     * A high priority command goes ahead of every normal command not yet sent. Normal
+     * priority queries are cancelled, including any already sent and waiting on a reply,
+     * whose late replies are thrown away. If nothing else is waiting on the device the
+     * command is written before submit() returns. Otherwise it waits for that command's
+     * reply, at most getResponseTimeout(). High priority is only ever asked for here. The
+     * blocking calls such as setVolume() go at normal priority, so they never cancel the
+     * queries of add-ons such as MY1690Catalog running in the background.
+     *
+     * @param opcode One of the MP3_COMMAND_ values.
+     * @param param Parameter for the command. Two byte parameters are sent MSB first.
+     * @param paramLength Number of parameter bytes to send, 0 to 2.
+     * @param callback Optional function called from update() when the command completes.
+     * @param context Passed untouched to the callback.
+     * @param priority MY1690_PRIORITY_NORMAL or MY1690_PRIORITY_HIGH.
+     *
+     * @return A handle for getResult(), or MY1690_INVALID_HANDLE if the queue is full.
+     */
+    MY1690Handle submit(uint8_t opcode, uint16_t param = 0, uint8_t paramLength = 0,
+                        MY1690Callback callback = nullptr, void *context = nullptr,
+                        MY1690Priority priority = MY1690_PRIORITY_NORMAL);
+    /**
+     * @brief Moves the command engine forward without blocking.
+     *
+     * Reads whatever bytes the serial port has waiting, completes the command in flight
+     * when its reply is in or its timeout has passed, then sends the next queued command.
+     * Call this often from loop().
+     */
+    void update(void);
+    /**
+     * @brief Checks on a command returned by submit().
+     *
+     * @param handle The handle returned by submit().
+     * @param value Optional, filled with the number the device replied with.
+     *
+     * @return MY1690_STATUS_PENDING until the command completes, then its final status.
+     */
+    MY1690Status getResult(MY1690Handle handle, uint16_t *value = nullptr);
+    /**
+     * @brief Calls update() until the given command completes.
+     *
+     * @param handle The handle returned by submit().
+     * @param value Optional, filled with the number the device replied with.
+     *
+     * @return The final status of the command.
+     */
+    MY1690Status waitFor(MY1690Handle handle, uint16_t *value = nullptr);
+    /**
+     * @brief Completes a command with MY1690_STATUS_CANCELLED, calling its callback straight away.
+     *
+     * A command not yet sent is dropped from the queue. One already sent still has its
+     * reply waited for, so the replies behind it stay in order, but nothing more is heard of it.
+     *
+     * @param handle The handle returned by submit().
+     *
+     * @return false if the command has already completed.
+     */
+    bool cancel(MY1690Handle handle);
+    /**
+     * @brief Cancels every command queued or in flight, as cancel() does.
+     *
+     * @return The number of commands cancelled.
+     */
+    uint8_t cancelAll(void);
+    /**
+     * @brief Returns the number of commands queued or in flight.
+     */
+    uint8_t commandsPending(void);
+    /**
+     * @brief Returns the number of commands cancelled, by cancel() or for high priority commands.
+     */
+    uint16_t getCancelledCount(void);
+    /**
+     * @brief Returns the time, in microseconds, from submitting the last command of a priority to its first byte going out.
+     */
+    unsigned long getDispatchLatencyUs(MY1690Priority priority);
+    /**
+     * @brief Returns the longest submit to wire time seen for a priority.
+     */
+    unsigned long getMaxDispatchLatencyUs(MY1690Priority priority);
+    /**
+     * @brief Clears the dispatch latencies.
+     */
+    void resetDispatchLatency(void);
+    /**
+     * @brief Sets a function to sleep in while the library waits on the MY1690.
+     *
+     * Blocking calls such as getVolume() and waitFor() call idle() between checks on the
+     * serial port instead of spinning. Pass SparkFunMY1690::platformSleep for the built-in
+     * sleep, or a function of your own, such as one that starts ESP32 light sleep with UART
+     * and GPIO wakeups armed. Pass nullptr to go back to yield().
+     *
+     * @param hook The sleep function.
+     * @param context Passed back to the hook.
+     */
+    void setSleepHook(MY1690SleepHook hook, void *context = nullptr);
+    /**
+     * @brief The built-in sleep hook.
+     *
+     * Idle sleep on AVR and wait for interrupt on SAMD and STM32, woken by the UART,
+     * the busy pin or the 1 ms timer tick. On ESP32 and ESP8266 it delays a millisecond,
+     * which lets FreeRTOS automatic light sleep or modem sleep in. Elsewhere it yields.
+     */
+    static void platformSleep(uint32_t maxMs, void *context);
+    /**
+     * @brief Sleeps in the sleep hook until the library next has something to do.
+     *
+     * Returns straight away if a command is waiting to be sent. Call from loop() after
+     * update() to sleep between replies and track events. Without a hook it just yields.
+     */
+    void idle(void);
+    /**
+     * @brief Returns the time, in microseconds, from the last wake up to the frame sent after it.
+     */
+    unsigned long getWakeLatencyUs(void);
+    /**
+     * @brief Returns the longest wake up to frame time seen.
+     */
+    unsigned long getMaxWakeLatencyUs(void);
+    /**
+     * @brief Returns the number of times the sleep hook has been called.
+     */
+    uint32_t getSleepCount(void);
+    /**
+     * @brief Returns the total time spent in the sleep hook, in milliseconds.
+     */
+    uint32_t getTimeAsleepMs(void);
+    /**
+     * @brief Sets how many queries may be sent before the first is answered.
+     *
+     * Replies are matched to queries in order. Commands that may not answer,
+     * such as set volume on v1.1, are never stacked. Defaults to MY1690_PIPELINE_DEPTH.
+     *
+     * @param depth 1 (one command at a time) to MY1690_QUEUE_SIZE.
+     */
+    void setPipelineDepth(uint8_t depth);
+    /**
+     * @brief Enables or disables merging of superseded commands in the queue. Enabled by default.
+     */
+    void setCoalescing(bool enable);
+    /**
+     * @brief Tells the library how fast the serial link runs so its timeouts fit it.
+     *
+     * Call after changing the baud rate of the MY1690 and the serial port. The reply and
+     * inter-byte timeouts are the MY1690's own delays plus the time the bytes take on
+     * the wire, so a fast link stops waiting sooner and a slow SoftwareSerial link is not
+     * cut off early. Defaults to MY1690_BAUD_RATE.
+     *
+     * @param baudRate The link speed in bits per second, 8N1.
+     */
+    void setBaudRate(uint32_t baudRate);
+    /**
+     * @brief Returns the link speed given to setBaudRate().
+     */
+    uint32_t getBaudRate(void);
+    /**
+     * @brief Returns how long a command waits for its reply to start, in milliseconds.
+     */
+    uint16_t getResponseTimeout(void);
+    /**
+     * @brief Returns how long a command waits for its reply to start, in milliseconds.
+     *
+     * The time learned for the opcode once enableAdaptiveTimeout() is on and it has been
+     * timed often enough, otherwise getResponseTimeout().
+     *
+     * @param opcode One of the MP3_COMMAND_ values.
+     */
+    uint16_t getResponseTimeout(uint8_t opcode);
+    /**
+     * @brief Returns the quiet time that ends a reply with no line ending, in milliseconds.
+     */
+    uint16_t getInterbyteTimeout(void);
+    /**
+     * @brief Waits for each reply as long as that command has been seen to need.
+     *
+     * Reply times are learned per opcode, as TCP learns round trip times: a moving average
+     * with gain 1/8 plus four times the mean deviation, with gain 1/4. Each timeout in a
+     * row doubles the wait, and the next reply timed after that starts the average over.
+     * Only replies to first tries sent with nothing ahead of them are timed.
+     * A quick query fails in a few milliseconds while a track change on a large card still
+     * gets the time it takes. Until MY1690_ADAPTIVE_SAMPLES replies to an opcode have been
+     * timed it waits getResponseTimeout(), doubled for each timeout in a row.
+     *
+     * Needs the library built with MY1690_ENABLE_ADAPTIVE_TIMEOUT set to 1, otherwise every reply
+     * waits getResponseTimeout(). When it is, reply times are learned whether this is on or not.
+     *
+     * @param enable true to use the learned timeouts, false to wait getResponseTimeout() for every reply.
+     */
+    void enableAdaptiveTimeout(bool enable = true);
+    /**
+     * @brief Forgets the learned reply times. setBaudRate() does this when the speed changes.
+     */
+    void resetAdaptiveTimeout(void);
+    /**
+     * @brief Copies out the learned reply times to store until the next start.
+     *
+     * @param table Filled in, checksum included.
+     */
+    void getTimeoutTable(MY1690TimeoutTable &table);
+    /**
+     * @brief Loads reply times saved from getTimeoutTable().
+     *
+     * @param table The saved table.
+     *
+     * @return false if the table is blank or corrupt, came from a build that knows other commands,
+     * was learned at another baud rate, or MY1690_ENABLE_ADAPTIVE_TIMEOUT is 0.
+     */
+    bool setTimeoutTable(const MY1690TimeoutTable &table);
+    /**
+     * @brief Returns the number of commands merged away instead of being sent.
+     */
+    uint16_t getCoalescedCount(void);
+    /**
+     * @brief Returns the text of the most recent reply, without the line ending.
+     *
+     * Valid until the next command is sent.
+     */
+    const char *getResponseString(void);
+
+    // Retries and recovery
+    /**
+     * @brief Sets how often, and how patiently, a class of commands is retried.
+     *
+     * A command is retried when its reply times out or is garbled, but not when the
+     * module refuses it (MY1690_STATUS_NACK). Only the result of the final attempt is
+     * reported. Retries are skipped while other queries are pipelined behind the command,
+     * since their replies would be misread. Defaults to MY1690_RETRIES for queries and
+     * setters, and none for actions.
+     *
+     * @param commandClass The class to configure.
+     * @param retries Extra attempts after the first.
+     * @param backoffMs Wait before the first retry, doubled for each one after.
+     */
+    void setRetryPolicy(MY1690CommandClass commandClass, uint8_t retries, uint16_t backoffMs = MY1690_RETRY_BACKOFF_MS);
+    /**
+     * @brief Sets how many commands in a row may time out before the module is reset.
+     *
+     * After the reset, the volume, EQ and loop mode held by the state cache are sent back,
+     * so enableStateCache() should be on for them to survive. Commands already queued are
+     * sent once the module has settled.
+     *
+     * @param timeouts Timeouts in a row, after retries. 0 never resets. Defaults to MY1690_RESET_AFTER_TIMEOUTS.
+     */
+    void setResetThreshold(uint8_t timeouts);
+    /**
+     * @brief Returns the number of retries sent.
+     */
+    uint16_t getRetryCount(void);
+    /**
+     * @brief Returns the number of times the module was reset to recover from timeouts.
+     */
+    uint16_t getRecoveryCount(void);
+    /**
+     * @brief Returns how the last blocking call, such as getVolume() or setEQ(), completed.
+     *
+     * Tells a real reply of 0 apart from a command that timed out.
+     */
+    MY1690Status getLastStatus(void);
+
+    // Instrumentation, recorded only when MY1690_ENABLE_STATS is 1
+    /**
+     * @brief Returns the counters recorded for an opcode.
+     *
+     * @param opcode One of the MP3_COMMAND_ values.
+     *
+     * @return The counters, or nullptr if the opcode is unknown or MY1690_ENABLE_STATS is 0.
+     */
+    const MY1690CommandStats *getStats(uint8_t opcode);
+    /**
+     * @brief Clears all recorded counters.
+     */
+    void resetStats(void);
+    /**
+     * @brief Prints a table of the recorded counters for every opcode that has been sent.
+     *
+     * @param out Where to print, ie Serial.
+     */
+    void printStats(Print &out);
+
+    // State cache
+    /**
+     * @brief Enables the write-through cache of volume, EQ, loop mode and play status.
+     *
+     * While enabled, setters update the cache when the module accepts them and getters
+     * answer from memory until the field's lifetime runs out. The next read after that
+     * refreshes the field from the device. Set volume is not acknowledged by v1.1, so
+     * setVolume() writes through on send and no longer reads the volume back to verify.
+     *
+     * @param enable true to enable, false to disable and forget all cached values.
+     */
+    void enableStateCache(bool enable = true);
+    /**
+     * @brief Sets how long a cached field is trusted before it is read from the device again.
+     *
+     * @param field The field to configure.
+     * @param milliseconds Lifetime. 0 always reads from the device.
+     */
+    void setCacheLifetime(MY1690StateField field, uint16_t milliseconds);
+    /**
+     * @brief Marks every cached field as stale.
+     */
+    void invalidateStateCache(void);
+    /**
+     * @brief Returns a snapshot of the cached state.
+     *
+     * Stale fields are refreshed from the device first, with their queries pipelined
+     * when the pipeline depth allows it.
+     */
+    MY1690State getState(void);
+    /**
+     * @brief Reads status, volume, EQ, loop mode, track number, elapsed and total time in one burst.
+     *
+     * The seven queries are sent back to back, as many as the queue holds, and their replies
+     * are matched in order, so the snapshot takes little more than its bytes take on the wire
+     * instead of seven round trips. This goes past setPipelineDepth() only while the queue holds nothing but the
+     * snapshot's own queries. Always reads the device, never the cache, and refreshes the
+     * cache on the way. Queries still outstanding when time runs out are cancelled.
+     *
+     * @param snapshot Filled in. Check valid for the fields that were answered.
+     * @param timeoutMs Time allowed for the whole snapshot. Defaults to MY1690_SNAPSHOT_TIMEOUT_MS.
+     *
+     * @return MY1690_STATUS_OK if every field was answered, MY1690_STATUS_TIMEOUT if time
+     *         ran out, or the status of the first field that failed.
+     */
+    MY1690Status getSnapshot(MY1690Snapshot &snapshot, uint16_t timeoutMs = MY1690_SNAPSHOT_TIMEOUT_MS);
+
+    /**
+     * @brief Sets a function that sees every command as it completes, whoever sent it.
+     *
+     * Lets an add-on follow what the sketch does with the player, such as a pause or
+     * a skip, without a query. Commands sent with writeFrame() are passed on as well.
+     *
+     * @param observer Function to call, or nullptr to stop calling one.
+     * @param context Passed untouched to the observer.
+     */
+    void onCommandCompleted(MY1690CommandObserver observer, void *context = nullptr);
+
+    // Busy pin interrupt
+    /**
+     * @brief Tracks the busy pin with a pin change interrupt instead of polling it.
+     *
+     * Each edge is debounced and timestamped in the interrupt. update() then raises the
+     * onTrackStarted() and onTrackFinished() events, and isPlaying() answers from the
+     * debounced level. Track changes cost nothing on the serial link. An edge that gets
+     * past the debounce window out of order is picked up by the next update().
+     *
+     * @param enable true to attach the interrupt, false to detach it.
+     * @param debounceUs Edges closer together than this are ignored. Defaults to MY1690_BUSY_DEBOUNCE_US.
+     *
+     * @return false if no busy pin was given to begin(), the pin cannot interrupt,
+     *         or MY1690_BUSY_INTERRUPT_SLOTS players already have one attached.
+     */
+    bool enableBusyInterrupt(bool enable = true, uint16_t debounceUs = MY1690_BUSY_DEBOUNCE_US);
+    /**
+     * @brief Sets the function update() calls when the busy pin goes high.
+     *
+     * @param callback Function to call, or nullptr to stop calling one.
+     * @param context Passed untouched to the callback.
+     */
+    void onTrackStarted(MY1690EventCallback callback, void *context = nullptr);
+    /**
+     * @brief Sets the function update() calls when the busy pin goes low at the end of a track.
+     *
+     * @param callback Function to call, or nullptr to stop calling one.
+     * @param context Passed untouched to the callback.
+     */
+    void onTrackFinished(MY1690EventCallback callback, void *context = nullptr);
+    /**
+     * @brief Returns the number of rising busy pin edges seen since the interrupt was enabled. Wraps at 65535.
+     */
+    uint16_t getTracksStarted(void);
+    /**
+     * @brief Returns the number of falling busy pin edges seen since the interrupt was enabled. Wraps at 65535.
+     *
+     * Compare against an earlier reading to find out whether a track has ended since.
+     */
+    uint16_t getTracksFinished(void);
+    /**
+     * @brief Returns the micros() timestamp of the last rising busy pin edge.
+     */
+    unsigned long getTrackStartedMicros(void);
+    /**
+     * @brief Returns the micros() timestamp of the last falling busy pin edge.
+     */
+    unsigned long getTrackFinishedMicros(void);
+    /**
+     * @brief Returns true while the busy pin interrupt is attached.
+     */
+    bool isBusyInterruptEnabled(void);
+
+    /**
+     * @brief Writes a complete frame, built ahead of time, straight to the serial port.
+     *
+     * Skips the queue so a prepared command goes out within microseconds of being needed.
+     * Any reply is treated as stale and dropped, so only use it for commands whose
+     * answer is not needed, such as select track.
+     *
+     * @param frame The frame, from MP3_START_CODE to MP3_END_CODE.
+     * @param length Number of bytes in frame.
+     *
+     * @return false, and nothing is written, if commands are queued or in flight.
+     */
+    bool writeFrame(const uint8_t *frame, uint8_t length);
+    /**
+     * @brief Lays out a complete frame for a command whose parameters are only known at run time.
+     *
+     * See MY1690Frame for frames that can be built at compile time.
+     *
+     * @param frame Filled with the frame. Must hold paramLength + 5 bytes.
+     * @param opcode One of the MP3_COMMAND_ values.
+     * @param param The parameter bytes, MSB first.
+     * @param paramLength Number of parameter bytes.
+     *
+     * @return The number of bytes in the frame.
+     */
+    static uint8_t buildFrame(uint8_t *frame, uint8_t opcode, const uint8_t *param, uint8_t paramLength);
+
+    /**
+     * @brief Reads the oldest line the MY1690 sent on its own, such as 'STOP'.
+     *
+     * These lines are kept by the parser instead of being thrown away. Call update()
+     * first so the parser has seen everything the serial port received.
+     *
+     * @param buffer Filled with the line, null terminated. May be nullptr.
+     * @param bufferSize Size of buffer.
+     *
+     * @return The kind of line read, or MY1690_LINE_NONE if there is none.
+     */
+    MY1690LineType readUnsolicited(char *buffer = nullptr, uint8_t bufferSize = 0);
+
+    // Unsolicited messages
+    /**
+     * @brief Sets the function update() calls when the MY1690 sends 'STOP' at the end of a track.
+     *
+     * Messages sent on their own are picked out while the link is idle and between
+     * replies. A message taken by a handler is no longer returned by readUnsolicited().
+     *
+     * @param callback Function to call, or nullptr to stop calling one.
+     * @param context Passed untouched to the callback.
+     */
+    void onStop(MY1690EventCallback callback, void *context = nullptr);
+    /**
+     * @brief Sets the function update() calls when the MY1690 reports the SD card going in or out.
+     *
+     * @param callback Function to call, or nullptr to stop calling one.
+     * @param context Passed untouched to the callback.
+     */
+    void onCardChange(MY1690CardCallback callback, void *context = nullptr);
+    /**
+     * @brief Sets the function update() calls with any other line the MY1690 sends on its own.
+     *
+     * @param callback Function to call, or nullptr to stop calling one.
+     * @param context Passed untouched to the callback.
+     */
+    void onMessage(MY1690MessageCallback callback, void *context = nullptr);
+    /**
+     * @brief Sets the text of the card messages, for firmware that words them differently.
+     *
+     * @param inserted Sent when a card is inserted. Must stay valid, ie a string literal.
+     * @param removed Sent when a card is removed. Must stay valid, ie a string literal.
+     */
+    void setCardMessages(const char *inserted, const char *removed);
+    /**
+     * @brief Returns the number of 'STOP' messages received. Wraps at 65535.
+     *
+     * Compare against an earlier reading to find out whether a track has ended since.
+     */
+    uint16_t getStopCount(void);
+    /**
+     * @brief Returns the micros() timestamp of the last 'STOP' message.
+     */
+    unsigned long getStopMicros(void);
+
     void sendCommand(uint8_t commandLength);
 
     uint16_t getNumberResponse(void);
     bool getOKResponse(void);
-    bool getSTOPResponse(void);
+    bool getSTOPResponse(void); // Waits for the 'STOP' sent at the end of a track
     bool getStringResponse(const char *expectedResponse);
 
     bool responseAvailable(uint8_t maxTimeout = 100);
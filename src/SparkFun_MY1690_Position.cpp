@@ -0,0 +1,411 @@
+/*!
+ * @file SparkFun_MY1690_Position.cpp
+ * @brief  Tracks the playback position of the MY1690 Serial MP3 player without polling it
+ *
+ * SparkFun sells these at its website: www.sparkfun.com
+ *
+ * Do you like this library? Help support SparkFun. Buy a board!
+ * https://www.sparkfun.com/products/15050
+ *
+ * https://github.com/sparkfun/SparkFun_MY1690_MP3_Decoder_Arduino_Library
+ *
+ * @author SparkFun Electronics
+ * @date 2024
+ * @copyright Copyright (c) 2025, SparkFun Electronics Inc. This project is released under the MIT License.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+#include "SparkFun_MY1690_Position.h"
+
+#define MY1690_POSITION_STATUS_UNKNOWN 0xFF
+
+MY1690PositionTracker::MY1690PositionTracker(SparkFunMY1690 &player)
+{
+    _player = &player;
+}
+
+void MY1690PositionTracker::begin(void)
+{
+    _player->onCommandCompleted(commandCompleted, this);
+    _startedSeen = _player->getTracksStarted();
+    _finishedSeen = _player->getTracksFinished();
+    _stopsSeen = _player->getStopCount();
+    _needTrackInfo = true;
+    scheduleResync(0);
+}
+
+void MY1690PositionTracker::update(void)
+{
+    _player->update();
+
+    if (_player->isBusyInterruptEnabled() == true)
+        followBusyPin();
+    else if (_player->getStopCount() != _stopsSeen)
+    {
+        _stopsSeen = _player->getStopCount();
+        fallingEdge(); // The 'STOP' sent at the end of a track
+    }
+
+    // Past the end of the track by our reckoning, so find out whether it has really ended
+    if (_status == 1 && _duration > 0 && _resyncDue == false && getPositionMs() >= _duration * 1000UL &&
+        millis() - _lastSync >= MY1690_POSITION_SETTLE_MS)
+        scheduleResync(0);
+
+    if (_resyncInterval > 0 && _resyncDue == false && millis() - _lastSync >= _resyncInterval)
+        scheduleResync(0);
+
+    // Only ask while the sketch isn't using the player
+    if (_resyncDue == false || _pending > 0 || _player->commandsPending() > 0 || (long)(millis() - _resyncAt) < 0)
+        return;
+
+    _resyncDue = false;
+    _lastSync = millis();
+    _resyncCount++;
+
+    // Queries go out back to back when the pipeline allows it. The first that doesn't fit stops the rest.
+    _syncStatus = MY1690_POSITION_STATUS_UNKNOWN;
+    if (submitQuery(MP3_COMMAND_GET_STATUS, statusReady) == false ||
+        submitQuery(MP3_COMMAND_GET_CURRENT_TRACK_TIME, elapsedReady) == false)
+        return;
+    if (_needTrackInfo == true && submitQuery(MP3_COMMAND_GET_CURRENT_TRACK_TIME_TOTAL, durationReady) == true &&
+        submitQuery(MP3_COMMAND_GET_CURRENT_TRACK, trackReady) == true)
+        _needTrackInfo = false; // Set again if either reply is lost
+}
+
+bool MY1690PositionTracker::submitQuery(uint8_t opcode, MY1690Callback callback)
+{
+    if (_player->submit(opcode, 0, 0, callback, this) == MY1690_INVALID_HANDLE)
+    {
+        _resyncDue = true; // Queue full, try again on the next update()
+        return (false);
+    }
+    _pending++;
+    return (true);
+}
+
+uint32_t MY1690PositionTracker::getPositionMs(void)
+{
+    uint32_t position = _anchorPositionMs;
+    if (_status == 1)
+        position += millis() - _anchorMs;
+
+    // Hold at the end until the device confirms the track is over
+    if (_duration > 0 && position > _duration * 1000UL)
+        position = _duration * 1000UL;
+    return (position);
+}
+
+uint16_t MY1690PositionTracker::getPosition(void)
+{
+    return (getPositionMs() / 1000);
+}
+
+uint16_t MY1690PositionTracker::getDuration(void)
+{
+    return (_duration);
+}
+
+uint16_t MY1690PositionTracker::getTrackNumber(void)
+{
+    return (_track);
+}
+
+uint8_t MY1690PositionTracker::getPlayStatus(void)
+{
+    return (_status);
+}
+
+bool MY1690PositionTracker::isPlaying(void)
+{
+    return (_status == 1);
+}
+
+void MY1690PositionTracker::setResyncInterval(uint16_t milliseconds)
+{
+    _resyncInterval = milliseconds;
+}
+
+void MY1690PositionTracker::setDriftThreshold(uint16_t milliseconds)
+{
+    _driftThreshold = milliseconds;
+}
+
+long MY1690PositionTracker::getLastDriftMs(void)
+{
+    return (_lastDriftMs);
+}
+
+uint16_t MY1690PositionTracker::getResyncCount(void)
+{
+    return (_resyncCount);
+}
+
+void MY1690PositionTracker::resync(void)
+{
+    scheduleResync(0);
+}
+
+void MY1690PositionTracker::anchor(uint32_t positionMs, unsigned long atMs)
+{
+    _anchorPositionMs = positionMs;
+    _anchorMs = atMs;
+}
+
+// A track has been asked to start from the beginning
+void MY1690PositionTracker::startTrack(unsigned long atMs)
+{
+    _status = 1;
+    _duration = 0; // Until the new track's length has been read
+    anchor(0, atMs);
+    _expectStart = true;
+    _needTrackInfo = true;
+
+    // Give the MY1690 time to open the file before asking about it
+    scheduleResync(MY1690_POSITION_SETTLE_MS);
+}
+
+void MY1690PositionTracker::scheduleResync(uint16_t delayMs)
+{
+    _resyncDue = true;
+    _resyncAt = millis() + delayMs;
+}
+
+// Follow commands sent through the player, by the sketch or anything else
+void MY1690PositionTracker::commandCompleted(const MY1690Command *command, MY1690Status status, uint16_t value,
+                                             void *context)
+{
+    (void)value;
+    MY1690PositionTracker *tracker = (MY1690PositionTracker *)context;
+    unsigned long now = millis();
+    uint32_t position;
+
+    switch (command->opcode)
+    {
+    case MP3_COMMAND_SELECT_TRACK_PLAY:
+    case MP3_COMMAND_NEXT:
+    case MP3_COMMAND_PREVIOUS:
+    case MP3_COMMAND_PLAY:
+    case MP3_COMMAND_PAUSE:
+    case MP3_COMMAND_PLAY_PAUSE:
+    case MP3_COMMAND_STOP:
+    case MP3_COMMAND_RESET:
+    case MP3_COMMAND_FASTFOWARD:
+    case MP3_COMMAND_REWIND:
+        if (status != MY1690_STATUS_OK)
+        {
+            tracker->scheduleResync(0); // Can't tell whether it took effect
+            return;
+        }
+        break;
+
+    default:
+        return; // Doesn't move the position
+    }
+
+    switch (command->opcode)
+    {
+    case MP3_COMMAND_SELECT_TRACK_PLAY:
+        tracker->startTrack(now);
+        tracker->_track = ((uint16_t)command->param[0] << 8) | command->param[1];
+        break;
+
+    case MP3_COMMAND_NEXT:
+    case MP3_COMMAND_PREVIOUS:
+        tracker->startTrack(now);
+        tracker->_track = 0; // Not known until it is read
+        break;
+
+    case MP3_COMMAND_PLAY:
+        if (tracker->_status == 2)
+        {
+            tracker->anchor(tracker->_anchorPositionMs, now); // Resume
+            tracker->_status = 1;
+        }
+        else if (tracker->_status == 0)
+            tracker->startTrack(now);
+        break;
+
+    case MP3_COMMAND_PAUSE:
+        if (tracker->_status == 1)
+        {
+            tracker->anchor(tracker->getPositionMs(), now);
+            tracker->_status = 2;
+        }
+        break;
+
+    case MP3_COMMAND_PLAY_PAUSE:
+        if (tracker->_status == 1)
+        {
+            tracker->anchor(tracker->getPositionMs(), now);
+            tracker->_status = 2;
+        }
+        else if (tracker->_status == 2)
+        {
+            tracker->anchor(tracker->_anchorPositionMs, now);
+            tracker->_status = 1;
+        }
+        break;
+
+    case MP3_COMMAND_STOP:
+    case MP3_COMMAND_RESET:
+        tracker->_status = 0;
+        tracker->_expectStart = false;
+        tracker->anchor(0, now);
+        break;
+
+    case MP3_COMMAND_FASTFOWARD:
+        tracker->anchor(tracker->getPositionMs() + MY1690_POSITION_SEEK_MS, now);
+        tracker->scheduleResync(MY1690_POSITION_SETTLE_MS); // The step is only roughly a second
+        break;
+
+    case MP3_COMMAND_REWIND:
+        position = tracker->getPositionMs();
+        tracker->anchor(position > MY1690_POSITION_SEEK_MS ? position - MY1690_POSITION_SEEK_MS : 0, now);
+        tracker->scheduleResync(MY1690_POSITION_SETTLE_MS);
+        break;
+    }
+}
+
+void MY1690PositionTracker::followBusyPin(void)
+{
+    uint16_t started = _player->getTracksStarted();
+    uint16_t finished = _player->getTracksFinished();
+    bool rose = (started != _startedSeen);
+    bool fell = (finished != _finishedSeen);
+    _startedSeen = started;
+    _finishedSeen = finished;
+
+    // Convert the edge timestamp, taken in the interrupt, to millis()
+    unsigned long startedMs = millis() - (micros() - _player->getTrackStartedMicros()) / 1000;
+
+    if (rose == true && fell == true)
+    {
+        // Both since the last update(). Take them in the order they happened.
+        if ((long)(_player->getTrackStartedMicros() - _player->getTrackFinishedMicros()) > 0)
+        {
+            fallingEdge();
+            risingEdge(startedMs);
+        }
+        else
+        {
+            risingEdge(startedMs);
+            fallingEdge();
+        }
+    }
+    else if (rose == true)
+        risingEdge(startedMs);
+    else if (fell == true)
+        fallingEdge();
+}
+
+void MY1690PositionTracker::risingEdge(unsigned long atMs)
+{
+    if (_expectStart == true)
+    {
+        // The track we asked for has really started. Count from the edge, not the command.
+        _expectStart = false;
+        _status = 1;
+        anchor(0, atMs);
+    }
+    else if (_status == 0)
+    {
+        // Started without a command from us, ie the next track of a loop mode
+        startTrack(atMs);
+        _expectStart = false;
+        _track = 0;
+    }
+    else if (_status == 2)
+    {
+        anchor(_anchorPositionMs, atMs); // Resumed without a command from us
+        _status = 1;
+    }
+}
+
+void MY1690PositionTracker::fallingEdge(void)
+{
+    // A pause, or a track change we sent, also drops the busy pin
+    if (_status != 1 || _expectStart == true)
+        return;
+
+    _status = 0;
+    anchor(0, millis());
+}
+
+void MY1690PositionTracker::statusReady(MY1690Handle handle, MY1690Status status, uint16_t value, void *context)
+{
+    (void)handle;
+    MY1690PositionTracker *tracker = (MY1690PositionTracker *)context;
+    tracker->_pending--;
+
+    if (status != MY1690_STATUS_OK)
+        return;
+    if (value == 3 || value == 4)
+        value = 1; // Fast forward and rewind still play
+    if (value <= 2)
+        tracker->_syncStatus = value;
+}
+
+void MY1690PositionTracker::elapsedReady(MY1690Handle handle, MY1690Status status, uint16_t value, void *context)
+{
+    (void)handle;
+    MY1690PositionTracker *tracker = (MY1690PositionTracker *)context;
+    tracker->_pending--;
+
+    if (status != MY1690_STATUS_OK || tracker->_syncStatus == MY1690_POSITION_STATUS_UNKNOWN)
+        return; // Keep interpolating, the next resync tries again
+
+    unsigned long now = millis();
+    uint32_t local = tracker->getPositionMs(); // Before the status changes what it means
+
+    if (tracker->_syncStatus == 0)
+    {
+        tracker->_status = 0;
+        tracker->_expectStart = false;
+        tracker->_lastDriftMs = 0;
+        tracker->anchor(0, now);
+        return;
+    }
+
+    if (tracker->_status == 0)
+    {
+        tracker->_needTrackInfo = true; // Playing something we didn't see start
+        tracker->scheduleResync(0);
+    }
+    tracker->_status = tracker->_syncStatus;
+    tracker->_expectStart = false;
+
+    // The device truncates to whole seconds, so anywhere in that second is correct
+    uint32_t low = value * 1000UL;
+    uint32_t high = low + 999;
+    uint32_t nearest = local < low ? low : (local > high ? high : local);
+    tracker->_lastDriftMs = (long)local - (long)nearest;
+
+    if (labs(tracker->_lastDriftMs) > tracker->_driftThreshold)
+        tracker->anchor(nearest, now);
+    else
+        tracker->anchor(local, now);
+}
+
+void MY1690PositionTracker::durationReady(MY1690Handle handle, MY1690Status status, uint16_t value, void *context)
+{
+    (void)handle;
+    MY1690PositionTracker *tracker = (MY1690PositionTracker *)context;
+    tracker->_pending--;
+
+    if (status == MY1690_STATUS_OK)
+        tracker->_duration = value;
+    else
+        tracker->_needTrackInfo = true;
+}
+
+void MY1690PositionTracker::trackReady(MY1690Handle handle, MY1690Status status, uint16_t value, void *context)
+{
+    (void)handle;
+    MY1690PositionTracker *tracker = (MY1690PositionTracker *)context;
+    tracker->_pending--;
+
+    if (status == MY1690_STATUS_OK)
+        tracker->_track = value;
+    else
+        tracker->_needTrackInfo = true;
+}
@@ -0,0 +1,159 @@
+/*!
+ * @file SparkFun_MY1690_Position.h
+ * @brief  Tracks the playback position of the MY1690 Serial MP3 player without polling it
+ *
+ * SparkFun sells these at its website: www.sparkfun.com
+ *
+ * Do you like this library? Help support SparkFun. Buy a board!
+ * https://www.sparkfun.com/products/15050
+ *
+ * https://github.com/sparkfun/SparkFun_MY1690_MP3_Decoder_Arduino_Library
+ *
+ * @author SparkFun Electronics
+ * @date 2024
+ * @copyright Copyright (c) 2025, SparkFun Electronics Inc. This project is released under the MIT License.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef SPARKFUN_MY1690_POSITION_H
+#define SPARKFUN_MY1690_POSITION_H
+
+#include "SparkFun_MY1690_MP3_Library.h"
+
+#define MY1690_POSITION_RESYNC_MS 5000  // Default time between checks against the device
+#define MY1690_POSITION_DRIFT_MS 250    // Default error allowed before the position is corrected
+#define MY1690_POSITION_SETTLE_MS 100   // Wait after a track change before asking the device about it
+#define MY1690_POSITION_SEEK_MS 1000    // How far fast forward and rewind move the track
+
+/*!
+ * @class MY1690PositionTracker
+ * @brief Keeps the position in the current track up to date from millis().
+ *
+ * The elapsed and total time are read once when a track starts. From then on the
+ * position is worked out locally, so getPositionMs() can be called every frame without
+ * touching the serial port. Pause, stop, fast forward, rewind and track changes sent
+ * through the player are followed as they complete. Track ends are taken from busy pin
+ * edges when the busy interrupt is enabled, and from 'STOP' messages when it is not.
+ * The device is asked again every resync interval, and straight away when the local
+ * position runs past the end of the track.
+ *
+ * begin() registers the tracker as the player's onCommandCompleted() observer, replacing
+ * any set before. A player has only one, so the sketch can't use it alongside a tracker.
+ */
+class MY1690PositionTracker
+{
+  public:
+    /**
+     * @brief Creates a tracker for a player.
+     *
+     * @param player A player that begin() has been called on.
+     */
+    MY1690PositionTracker(SparkFunMY1690 &player);
+
+    /**
+     * @brief Starts following the player and reads its position.
+     *
+     * Takes over the player's onCommandCompleted() observer, replacing any set before.
+     */
+    void begin(void);
+    /**
+     * @brief Follows busy pin edges and resyncs when due. Calls the player's update(), so call this instead of it.
+     */
+    void update(void);
+
+    /**
+     * @brief Returns the position in the current track in milliseconds, without a serial round trip.
+     */
+    uint32_t getPositionMs(void);
+    /**
+     * @brief Returns the position in the current track in seconds, without a serial round trip.
+     */
+    uint16_t getPosition(void);
+    /**
+     * @brief Returns the length of the current track in seconds, 0 until it has been read.
+     */
+    uint16_t getDuration(void);
+    /**
+     * @brief Returns the current track number, 0 until it has been read.
+     */
+    uint16_t getTrackNumber(void);
+    /**
+     * @brief Returns 0 when stopped, 1 when playing and 2 when paused, as getPlayStatus() does.
+     */
+    uint8_t getPlayStatus(void);
+    /**
+     * @brief Returns true while the tracker believes a track is playing.
+     */
+    bool isPlaying(void);
+
+    /**
+     * @brief Sets how often the position is checked against the device.
+     *
+     * @param milliseconds Time between checks. 0 only checks after track changes and drift.
+     */
+    void setResyncInterval(uint16_t milliseconds);
+    /**
+     * @brief Sets how far the local position may be from the device before it is corrected.
+     *
+     * The device reports whole seconds, so any position within that second is taken as correct.
+     *
+     * @param milliseconds Allowed error outside the reported second. Defaults to MY1690_POSITION_DRIFT_MS.
+     */
+    void setDriftThreshold(uint16_t milliseconds);
+    /**
+     * @brief Returns how far the local position was outside the reported second at the last check, in milliseconds.
+     *
+     * Positive when the local position was ahead of the device.
+     */
+    long getLastDriftMs(void);
+    /**
+     * @brief Returns the number of times the position has been read from the device.
+     */
+    uint16_t getResyncCount(void);
+    /**
+     * @brief Reads the position from the device as soon as the player is idle.
+     */
+    void resync(void);
+
+  protected:
+    SparkFunMY1690 *_player;
+
+    uint8_t _status = 0; // As reported by getPlayStatus()
+    uint16_t _track = 0;
+    uint16_t _duration = 0;         // Seconds, 0 when unknown
+    uint32_t _anchorPositionMs = 0; // Position at _anchorMs
+    unsigned long _anchorMs = 0;
+    bool _expectStart = false; // A track change was sent and its busy edge has not arrived
+
+    bool _resyncDue = true;
+    unsigned long _resyncAt = 0;
+    unsigned long _lastSync = 0;
+    uint16_t _resyncInterval = MY1690_POSITION_RESYNC_MS;
+    uint16_t _driftThreshold = MY1690_POSITION_DRIFT_MS;
+    bool _needTrackInfo = true; // Read the track number and length at the next resync
+    uint8_t _pending = 0;       // Replies still due from the last resync
+    uint8_t _syncStatus = 0;    // Status reply, applied along with the elapsed time
+    long _lastDriftMs = 0;
+    uint16_t _resyncCount = 0;
+
+    uint16_t _startedSeen = 0;
+    uint16_t _finishedSeen = 0;
+    uint16_t _stopsSeen = 0;
+
+    void anchor(uint32_t positionMs, unsigned long atMs);
+    void startTrack(unsigned long atMs);
+    void scheduleResync(uint16_t delayMs);
+    void followBusyPin(void);
+    void risingEdge(unsigned long atMs);
+    void fallingEdge(void);
+    bool submitQuery(uint8_t opcode, MY1690Callback callback);
+
+    static void commandCompleted(const MY1690Command *command, MY1690Status status, uint16_t value, void *context);
+    static void statusReady(MY1690Handle handle, MY1690Status status, uint16_t value, void *context);
+    static void elapsedReady(MY1690Handle handle, MY1690Status status, uint16_t value, void *context);
+    static void durationReady(MY1690Handle handle, MY1690Status status, uint16_t value, void *context);
+    static void trackReady(MY1690Handle handle, MY1690Status status, uint16_t value, void *context);
+};
+
+#endif
@@ -0,0 +1,244 @@
+/*!
+ * @file SparkFun_MY1690_Ramp.cpp
+ * @brief  Timed volume fades and announcement ducking for the MY1690 Serial MP3 player
+ *
+ * SparkFun sells these at its website: www.sparkfun.com
+ *
+ * Do you like this library? Help support SparkFun. Buy a board!
+ * https://www.sparkfun.com/products/15050
+ *
+ * https://github.com/sparkfun/SparkFun_MY1690_MP3_Decoder_Arduino_Library
+ *
+ * @author SparkFun Electronics
+ * @date 2024
+ * @copyright Copyright (c) 2025, SparkFun Electronics Inc. This project is released under the MIT License.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+#include "SparkFun_MY1690_Ramp.h"
+
+#define MY1690_VOLUME_FRAME_BYTES 6 // 7E 04 31 VOL CRC EF
+
+// log10(1 + 9x) * 256 at x = 0, 1/16 ... 1
+static const uint8_t logCurve[17] PROGMEM = {0,   50,  84,  110, 131, 149, 164, 178, 190,
+                                             200, 210, 219, 228, 235, 243, 250, 255};
+
+MY1690VolumeRamp::MY1690VolumeRamp(SparkFunMY1690 &player)
+{
+    _player = &player;
+}
+
+void MY1690VolumeRamp::begin(void)
+{
+    _level = _player->getVolume();
+    if (_level > 30)
+        _level = 30;
+    _target = _level;
+    _ramping = false;
+    _ducked = false;
+    _announceState = ANNOUNCE_IDLE;
+    _lastStep = MY1690_INVALID_HANDLE;
+    _stepCount = 0;
+}
+
+void MY1690VolumeRamp::update(void)
+{
+    _player->update();
+    if (_announcer != nullptr)
+        _announcer->update();
+
+    if (_ramping == true)
+    {
+        unsigned long now = millis();
+
+        // One step on the way at a time, no faster than the link can carry them
+        uint32_t baudRate = _player->getBaudRate();
+        uint16_t interval = (MY1690_VOLUME_FRAME_BYTES * 10 * 1000UL + baudRate - 1) / baudRate;
+        if (interval < _stepInterval)
+            interval = _stepInterval;
+
+        if (_player->getResult(_lastStep, nullptr) != MY1690_STATUS_PENDING && now - _lastStepMs >= interval)
+        {
+            uint8_t level = levelAt(now);
+            if (level != _level)
+                sendStep(level);
+            if (_level == _target && now - _startMs >= _durationMs)
+                _ramping = false;
+        }
+    }
+
+    followAnnouncement();
+}
+
+// Where the curve has got to. Steps in between are never sent.
+uint8_t MY1690VolumeRamp::levelAt(unsigned long now)
+{
+    unsigned long elapsed = now - _startMs;
+    if (elapsed >= _durationMs)
+        return (_target);
+
+    uint16_t fraction = (uint32_t)elapsed * 256 / _durationMs; // 0 to 255
+    if (_curve == MY1690_RAMP_LOG)
+    {
+        uint8_t low = pgm_read_byte(&logCurve[fraction >> 4]);
+        uint8_t high = pgm_read_byte(&logCurve[(fraction >> 4) + 1]);
+        fraction = low + (uint16_t)(high - low) * (fraction & 0x0F) / 16;
+    }
+
+    int16_t change = ((int16_t)_target - _from) * (int16_t)fraction;
+    change += (change < 0) ? -128 : 128; // Round to the nearest level
+    return (_from + change / 256);
+}
+
+void MY1690VolumeRamp::sendStep(uint8_t level)
+{
+    MY1690Handle handle = _player->submit(MP3_COMMAND_SET_VOLUME, level, 1);
+    if (handle == MY1690_INVALID_HANDLE)
+        return; // Queue is full, try again next update
+
+    _lastStep = handle;
+    _lastStepMs = millis();
+    _level = level;
+    _stepCount++;
+}
+
+void MY1690VolumeRamp::rampTo(uint8_t level, uint16_t durationMs, MY1690RampCurve curve)
+{
+    if (level > 30)
+        level = 30;
+
+    _from = _level;
+    _target = level;
+    _durationMs = durationMs;
+    _curve = curve;
+    _startMs = millis();
+    _ramping = true;
+}
+
+void MY1690VolumeRamp::stop(void)
+{
+    _ramping = false;
+    _target = _level;
+}
+
+bool MY1690VolumeRamp::isRamping(void)
+{
+    return (_ramping);
+}
+
+uint8_t MY1690VolumeRamp::getLevel(void)
+{
+    return (_level);
+}
+
+uint8_t MY1690VolumeRamp::getTarget(void)
+{
+    return (_target);
+}
+
+void MY1690VolumeRamp::duck(uint8_t level, uint16_t durationMs)
+{
+    // Ducking again keeps the level from before the first duck
+    if (_ducked == false)
+        _restoreLevel = (_ramping == true) ? _target : _level;
+    _ducked = true;
+    rampTo(level, durationMs, MY1690_RAMP_LOG);
+}
+
+void MY1690VolumeRamp::restore(uint16_t durationMs)
+{
+    if (_ducked == false)
+        return;
+    _ducked = false;
+    rampTo(_restoreLevel, durationMs, MY1690_RAMP_LOG);
+}
+
+bool MY1690VolumeRamp::announce(SparkFunMY1690 &announcer, uint16_t trackNumber, uint8_t level, uint16_t durationMs)
+{
+    if (_announceState != ANNOUNCE_IDLE || &announcer == _player)
+        return (false);
+
+    _announcer = &announcer;
+    _announceTrack = trackNumber;
+    _announceFadeMs = durationMs;
+    _announceState = ANNOUNCE_DUCKING;
+    duck(level, durationMs);
+    return (true);
+}
+
+bool MY1690VolumeRamp::isAnnouncing(void)
+{
+    return (_announceState != ANNOUNCE_IDLE);
+}
+
+// Number of tracks the announcer has finished, by whichever means it can tell
+uint16_t MY1690VolumeRamp::announcerEnds(void)
+{
+    if (_announcer->isBusyInterruptEnabled() == true)
+        return (_announcer->getTracksFinished());
+    return (_announcer->getStopCount());
+}
+
+// True once the clip has ended, failed to start or run past MY1690_RAMP_ANNOUNCE_MAX_MS
+bool MY1690VolumeRamp::announcementEnded(void)
+{
+    if (_announceHandle != MY1690_INVALID_HANDLE)
+    {
+        // A clip that never started will never end
+        MY1690Status status = _announcer->getResult(_announceHandle);
+        if (status == MY1690_STATUS_PENDING)
+            return (false);
+        if (status != MY1690_STATUS_OK && status != MY1690_STATUS_INVALID)
+            return (true);
+        _announceHandle = MY1690_INVALID_HANDLE; // Started, or its result has aged out. Either way, watch for the end.
+    }
+
+    if (announcerEnds() != _endsSeen)
+        return (true);
+    return (millis() - _announceStartMs >= MY1690_RAMP_ANNOUNCE_MAX_MS);
+}
+
+void MY1690VolumeRamp::followAnnouncement(void)
+{
+    switch (_announceState)
+    {
+    case ANNOUNCE_DUCKING:
+        if (_ramping == true)
+            break;
+        _endsSeen = announcerEnds();
+        _announceHandle = _announcer->submit(MP3_COMMAND_SELECT_TRACK_PLAY, _announceTrack, 2);
+        if (_announceHandle != MY1690_INVALID_HANDLE)
+        {
+            _announceStartMs = millis();
+            _announceState = ANNOUNCE_PLAYING;
+        }
+        break;
+
+    case ANNOUNCE_PLAYING:
+        if (announcementEnded() == false)
+            break;
+        restore(_announceFadeMs);
+        _announceState = ANNOUNCE_RESTORING;
+        break;
+
+    case ANNOUNCE_RESTORING:
+        if (_ramping == true)
+            break;
+        _announceState = ANNOUNCE_IDLE;
+        _announcer = nullptr;
+        break;
+
+    default:
+        break;
+    }
+}
+
+void MY1690VolumeRamp::setStepInterval(uint16_t milliseconds)
+{
+    _stepInterval = milliseconds;
+}
+
+uint16_t MY1690VolumeRamp::getStepCount(void)
+{
+    return (_stepCount);
+}
@@ -0,0 +1,190 @@
+/*!
+ * @file SparkFun_MY1690_Ramp.h
+ * @brief  Timed volume fades and announcement ducking for the MY1690 Serial MP3 player
+ *
+ * SparkFun sells these at its website: www.sparkfun.com
+ *
+ * Do you like this library? Help support SparkFun. Buy a board!
+ * https://www.sparkfun.com/products/15050
+ *
+ * https://github.com/sparkfun/SparkFun_MY1690_MP3_Decoder_Arduino_Library
+ *
+ * @author SparkFun Electronics
+ * @date 2024
+ * @copyright Copyright (c) 2025, SparkFun Electronics Inc. This project is released under the MIT License.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef SPARKFUN_MY1690_RAMP_H
+#define SPARKFUN_MY1690_RAMP_H
+
+#include "SparkFun_MY1690_MP3_Library.h"
+
+#define MY1690_RAMP_STEP_MS 20  // Default shortest time between volume steps
+#define MY1690_RAMP_FADE_MS 500 // Default fade time for announce()
+
+// Longest an announcement clip is given to end before the volume is restored anyway
+#ifndef MY1690_RAMP_ANNOUNCE_MAX_MS
+#define MY1690_RAMP_ANNOUNCE_MAX_MS 60000
+#endif
+
+typedef enum
+{
+    MY1690_RAMP_LINEAR = 0, // Equal steps over the whole fade
+    MY1690_RAMP_LOG,        // Quick at first, slow near the end, like a log fader
+} MY1690RampCurve;
+
+/*!
+ * @class MY1690VolumeRamp
+ * @brief Fades a player between volume levels from update(), without blocking.
+ *
+ * Each update() works out the level the curve has reached and sends a single
+ * MP3_COMMAND_SET_VOLUME if it differs from the last one sent. Steps that fall between
+ * two updates are skipped rather than queued, and a new step waits until the previous
+ * one has gone out, so a fade never backs up the command queue however slow the link.
+ *
+ * announce() fades the player down, plays a clip on a second player and fades back up
+ * when the clip ends. The MY1690 plays one track at a time, so the announcement has to
+ * come from another module, for example another zone of a MY1690Bus.
+ */
+class MY1690VolumeRamp
+{
+  public:
+    /**
+     * @brief Creates a ramp for a player.
+     *
+     * @param player A player that begin() has been called on.
+     */
+    MY1690VolumeRamp(SparkFunMY1690 &player);
+
+    /**
+     * @brief Reads the player's volume to fade from.
+     *
+     * Call again after changing the volume other than through the ramp.
+     */
+    void begin(void);
+    /**
+     * @brief Sends the next volume step when one is due. Calls the player's update(), so call this instead of it.
+     */
+    void update(void);
+
+    /**
+     * @brief Fades from the current level to a new one.
+     *
+     * Replaces any fade in progress, starting from wherever it had got to.
+     *
+     * @param level Volume to end on, 0 to 30.
+     * @param durationMs Length of the fade. 0 sets the level at the next update().
+     * @param curve MY1690_RAMP_LINEAR or MY1690_RAMP_LOG.
+     */
+    void rampTo(uint8_t level, uint16_t durationMs, MY1690RampCurve curve = MY1690_RAMP_LINEAR);
+    /**
+     * @brief Ends the fade where it is.
+     */
+    void stop(void);
+    /**
+     * @brief Returns true while a fade is in progress.
+     */
+    bool isRamping(void);
+    /**
+     * @brief Returns the last level sent to the player.
+     */
+    uint8_t getLevel(void);
+    /**
+     * @brief Returns the level the current fade ends on.
+     */
+    uint8_t getTarget(void);
+
+    /**
+     * @brief Remembers the current level and fades down to another.
+     *
+     * @param level Volume to duck to, 0 to 30.
+     * @param durationMs Length of the fade.
+     */
+    void duck(uint8_t level, uint16_t durationMs = MY1690_RAMP_FADE_MS);
+    /**
+     * @brief Fades back to the level remembered by duck().
+     *
+     * @param durationMs Length of the fade.
+     */
+    void restore(uint16_t durationMs = MY1690_RAMP_FADE_MS);
+
+    /**
+     * @brief Ducks this player, plays a clip on another and restores this one when the clip ends.
+     *
+     * The clip starts once the fade down has finished. Its end is taken from the announcer's
+     * busy pin when its busy interrupt is enabled, and from its 'STOP' message when it is not.
+     * If the clip fails to start the volume is restored straight away, and if no end is seen
+     * within MY1690_RAMP_ANNOUNCE_MAX_MS it is restored anyway.
+     * The announcer's update() is called from this update().
+     *
+     * @param announcer The player to play the clip on. Not the player being ducked.
+     * @param trackNumber The clip to play (1-based index).
+     * @param level Volume to duck to while the clip plays.
+     * @param durationMs Length of each fade.
+     *
+     * @return false if an announcement is already running or announcer is the ducked player.
+     */
+    bool announce(SparkFunMY1690 &announcer, uint16_t trackNumber, uint8_t level,
+                  uint16_t durationMs = MY1690_RAMP_FADE_MS);
+    /**
+     * @brief Returns true from announce() until the volume has been restored.
+     */
+    bool isAnnouncing(void);
+
+    /**
+     * @brief Sets the shortest time between volume steps.
+     *
+     * Never shorter than the time a volume frame takes at the player's baud rate.
+     *
+     * @param milliseconds Defaults to MY1690_RAMP_STEP_MS.
+     */
+    void setStepInterval(uint16_t milliseconds);
+    /**
+     * @brief Returns the number of volume steps sent since begin().
+     */
+    uint16_t getStepCount(void);
+
+  protected:
+    SparkFunMY1690 *_player;
+
+    uint8_t _level = 0;        // Last level sent
+    uint8_t _from = 0;         // Start of the current fade
+    uint8_t _target = 0;       // End of the current fade
+    uint8_t _restoreLevel = 0; // Level duck() left
+    bool _ducked = false;
+    MY1690RampCurve _curve = MY1690_RAMP_LINEAR;
+    bool _ramping = false;
+    unsigned long _startMs = 0;
+    uint16_t _durationMs = 0;
+
+    uint16_t _stepInterval = MY1690_RAMP_STEP_MS;
+    unsigned long _lastStepMs = 0;
+    MY1690Handle _lastStep = MY1690_INVALID_HANDLE;
+    uint16_t _stepCount = 0;
+
+    typedef enum
+    {
+        ANNOUNCE_IDLE = 0,
+        ANNOUNCE_DUCKING,
+        ANNOUNCE_PLAYING,
+        ANNOUNCE_RESTORING,
+    } AnnounceState;
+
+    AnnounceState _announceState = ANNOUNCE_IDLE;
+    SparkFunMY1690 *_announcer = nullptr;
+    uint16_t _announceTrack = 0;
+    uint16_t _announceFadeMs = 0;
+    uint16_t _endsSeen = 0; // Announcer's track finished or 'STOP' count when the clip started
+    MY1690Handle _announceHandle = MY1690_INVALID_HANDLE; // The clip's play command, until it succeeds
+    unsigned long _announceStartMs = 0;
+
+    uint8_t levelAt(unsigned long now);
+    void sendStep(uint8_t level);
+    uint16_t announcerEnds(void);
+    bool announcementEnded(void);
+    void followAnnouncement(void);
+};
+
+#endif
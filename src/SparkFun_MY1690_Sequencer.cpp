@@ -0,0 +1,194 @@
+/*!
+ * @file SparkFun_MY1690_Sequencer.cpp
+ * @brief  Gapless playback of a list of tracks on the MY1690 Serial MP3 player
+ *
+ * SparkFun sells these at its website: www.sparkfun.com
+ *
+ * Do you like this library? Help support SparkFun. Buy a board!
+ * https://www.sparkfun.com/products/15050
+ *
+ * https://github.com/sparkfun/SparkFun_MY1690_MP3_Decoder_Arduino_Library
+ *
+ * @author SparkFun Electronics
+ * @date 2024
+ * @copyright Copyright (c) 2025, SparkFun Electronics Inc. This project is released under the MIT License.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+#include "SparkFun_MY1690_Sequencer.h"
+
+MY1690Sequencer::MY1690Sequencer(SparkFunMY1690 &player)
+{
+    _player = &player;
+}
+
+bool MY1690Sequencer::add(uint16_t trackNumber)
+{
+    if (_running == true || _count >= MY1690_SEQUENCER_SLOTS)
+        return (false);
+
+    _tracks[_count++] = trackNumber;
+    return (true);
+}
+
+void MY1690Sequencer::clear(void)
+{
+    _count = 0;
+    _running = false;
+}
+
+uint8_t MY1690Sequencer::count(void)
+{
+    return (_count);
+}
+
+bool MY1690Sequencer::start(void)
+{
+    if (_count == 0)
+        return (false);
+
+    // Left in any loop mode, the MY1690 moves on to a track of its own choosing
+    if (_player->submit(MP3_COMMAND_SET_LOOP_MODE, MP3_LOOP_MODE_NO_LOOP, 1) == MY1690_INVALID_HANDLE)
+        return (false);
+    if (_player->submit(MP3_COMMAND_SELECT_TRACK_PLAY, _tracks[0], 2) == MY1690_INVALID_HANDLE)
+        return (false);
+
+    // Start counting from now so an earlier track end does not skip the first clip
+    _player->update();
+    _finishedSeen = _player->getTracksFinished();
+    _startedSeen = _player->getTracksStarted();
+    _stopsSeen = _player->getStopCount();
+
+    _position = 0;
+    _running = true;
+    _measuring = false;
+    _lastGapUs = 0;
+    _maxGapUs = 0;
+
+    _frameStaged = false;
+    if (_count > 1)
+        stage(_tracks[1]);
+
+    return (true);
+}
+
+void MY1690Sequencer::stop(void)
+{
+    _running = false;
+}
+
+bool MY1690Sequencer::isRunning(void)
+{
+    return (_running);
+}
+
+uint8_t MY1690Sequencer::getPosition(void)
+{
+    return (_position);
+}
+
+void MY1690Sequencer::update(void)
+{
+    _player->update();
+
+    // The rising edge of the clip we fired closes the gap
+    if (_player->isBusyInterruptEnabled() == true)
+    {
+        uint16_t started = _player->getTracksStarted();
+        if (started != _startedSeen)
+        {
+            _startedSeen = started;
+            if (_measuring == true)
+            {
+                _measuring = false;
+                recordGap(_player->getTrackStartedMicros() - _endedAt);
+            }
+        }
+    }
+
+    if (_running == true && trackEnded() == true)
+        advance();
+}
+
+// Returns true once per clip that has finished, with _endedAt set to when
+bool MY1690Sequencer::trackEnded(void)
+{
+    if (_player->isBusyInterruptEnabled() == true)
+    {
+        uint16_t finished = _player->getTracksFinished();
+        if (finished == _finishedSeen)
+            return (false);
+
+        _finishedSeen = finished;
+        _endedAt = _player->getTrackFinishedMicros();
+        return (true);
+    }
+
+    // No busy pin, so watch for the 'STOP' the MY1690 sends when a track ends
+    uint16_t stops = _player->getStopCount();
+    if (stops == _stopsSeen)
+        return (false);
+
+    _stopsSeen = stops;
+    _endedAt = _player->getStopMicros();
+    return (true);
+}
+
+void MY1690Sequencer::advance(void)
+{
+    _position++;
+    if (_position >= _count)
+    {
+        _running = false;
+        return;
+    }
+
+    bool written = fire(_tracks[_position]);
+
+    if (_player->isBusyInterruptEnabled() == true)
+        _measuring = true; // Finished when the busy pin rises again
+    else if (written == true)
+        recordGap(micros() - _endedAt);
+    else
+        _lastGapUs = MY1690_SEQUENCER_GAP_UNKNOWN; // Queued behind other commands, so not on the wire yet
+
+    // Get the following clip ready while this one plays
+    if (_position + 1 < _count)
+        stage(_tracks[_position + 1]);
+}
+
+// Build the select track frame ahead of time so firing it is a single write
+void MY1690Sequencer::stage(uint16_t trackNumber)
+{
+    uint8_t param[2] = {(uint8_t)(trackNumber >> 8), (uint8_t)(trackNumber & 0xFF)}; // MSB first
+    SparkFunMY1690::buildFrame(_frame, MP3_COMMAND_SELECT_TRACK_PLAY, param, sizeof(param));
+    _frameStaged = true;
+}
+
+// Returns true if the frame was written now, false if it was queued
+bool MY1690Sequencer::fire(uint16_t trackNumber)
+{
+    // The frame can only skip the queue when the queue is idle
+    bool written = _frameStaged == true && _player->writeFrame(_frame, sizeof(_frame)) == true;
+    if (written == false)
+        _player->submit(MP3_COMMAND_SELECT_TRACK_PLAY, trackNumber, 2);
+    _frameStaged = false;
+    return (written);
+}
+
+void MY1690Sequencer::recordGap(unsigned long gapUs)
+{
+    _lastGapUs = gapUs;
+    if (gapUs > _maxGapUs)
+        _maxGapUs = gapUs;
+}
+
+unsigned long MY1690Sequencer::getLastGapUs(void)
+{
+    return (_lastGapUs);
+}
+
+unsigned long MY1690Sequencer::getMaxGapUs(void)
+{
+    return (_maxGapUs);
+}
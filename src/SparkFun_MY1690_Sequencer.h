@@ -0,0 +1,136 @@
+/*!
+ * @file SparkFun_MY1690_Sequencer.h
+ * @brief  Gapless playback of a list of tracks on the MY1690 Serial MP3 player
+ *
+ * SparkFun sells these at its website: www.sparkfun.com
+ *
+ * Do you like this library? Help support SparkFun. Buy a board!
+ * https://www.sparkfun.com/products/15050
+ *
+ * https://github.com/sparkfun/SparkFun_MY1690_MP3_Decoder_Arduino_Library
+ *
+ * @author SparkFun Electronics
+ * @date 2024
+ * @copyright Copyright (c) 2025, SparkFun Electronics Inc. This project is released under the MIT License.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef SPARKFUN_MY1690_SEQUENCER_H
+#define SPARKFUN_MY1690_SEQUENCER_H
+
+#include "SparkFun_MY1690_MP3_Library.h"
+
+// Number of tracks a sequencer can hold
+#ifndef MY1690_SEQUENCER_SLOTS
+#define MY1690_SEQUENCER_SLOTS 8
+#endif
+
+#define MY1690_SELECT_TRACK_FRAME_BYTES 7         // 7E 05 41 MSB LSB CRC EF
+#define MY1690_SEQUENCER_GAP_UNKNOWN 0xFFFFFFFFUL // Gap that could not be measured
+
+/*!
+ * @class MY1690Sequencer
+ * @brief Plays a fixed list of tracks back to back with as little silence between them as possible.
+ *
+ * The select track frame for the next clip is built while the current one plays, and
+ * written the moment the end of the clip is seen: a falling busy pin edge when
+ * enableBusyInterrupt() is on, otherwise the 'STOP' the MY1690 sends. Everything runs
+ * from update(); nothing blocks.
+ */
+class MY1690Sequencer
+{
+  public:
+    /**
+     * @brief Creates a sequencer that drives a player.
+     *
+     * @param player A player that begin() has been called on.
+     */
+    MY1690Sequencer(SparkFunMY1690 &player);
+
+    /**
+     * @brief Appends a track to the list.
+     *
+     * @param trackNumber The track number to play (1-based index).
+     *
+     * @return false if the list is full or the sequencer is running.
+     */
+    bool add(uint16_t trackNumber);
+    /**
+     * @brief Empties the list. Stops the sequencer if it is running.
+     */
+    void clear(void);
+    /**
+     * @brief Returns the number of tracks in the list.
+     */
+    uint8_t count(void);
+
+    /**
+     * @brief Plays the list from the first track.
+     *
+     * Sets the loop mode to MP3_LOOP_MODE_NO_LOOP so the MY1690 stops at the end of
+     * each clip instead of moving on by itself.
+     *
+     * @return false if the list is empty or the command queue is full.
+     */
+    bool start(void);
+    /**
+     * @brief Stops after the current clip. The clip itself keeps playing.
+     */
+    void stop(void);
+    /**
+     * @brief Returns true until the last clip has finished or stop() is called.
+     */
+    bool isRunning(void);
+    /**
+     * @brief Returns the index in the list of the clip playing now.
+     */
+    uint8_t getPosition(void);
+
+    /**
+     * @brief Moves the sequence forward. Calls the player's update(), so call this instead of it.
+     */
+    void update(void);
+
+    /**
+     * @brief Returns the gap, in microseconds, between the last two clips.
+     *
+     * With the busy pin interrupt this is the time the busy pin spent low between the clips,
+     * which is the silence heard. Without it, it is the time from the 'STOP' being read to
+     * the next frame being written, which leaves out the time the MY1690 takes to start a track.
+     * When the player was busy with other commands the frame waits its turn in the queue, and
+     * without the busy pin there is nothing to time, so the gap is MY1690_SEQUENCER_GAP_UNKNOWN.
+     */
+    unsigned long getLastGapUs(void);
+    /**
+     * @brief Returns the longest gap since start(), leaving out the unknown ones.
+     */
+    unsigned long getMaxGapUs(void);
+
+  protected:
+    SparkFunMY1690 *_player;
+
+    uint16_t _tracks[MY1690_SEQUENCER_SLOTS];
+    uint8_t _count = 0;
+    uint8_t _position = 0;
+    bool _running = false;
+
+    uint8_t _frame[MY1690_SELECT_TRACK_FRAME_BYTES]; // Next clip, ready to go
+    bool _frameStaged = false;
+
+    uint16_t _finishedSeen = 0; // Player's track finished count when last checked
+    uint16_t _stopsSeen = 0;    // Player's 'STOP' count when last checked
+    uint16_t _startedSeen = 0;
+    bool _measuring = false; // Waiting on the next clip to start to measure the gap
+    unsigned long _endedAt = 0;
+    unsigned long _lastGapUs = 0;
+    unsigned long _maxGapUs = 0;
+
+    void stage(uint16_t trackNumber);
+    bool fire(uint16_t trackNumber);
+    bool trackEnded(void);
+    void advance(void);
+    void recordGap(unsigned long gapUs);
+};
+
+#endif
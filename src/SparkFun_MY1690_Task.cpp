@@ -0,0 +1,297 @@
+/*!
+ * @file SparkFun_MY1690_Task.cpp
+ * @brief  FreeRTOS task that services the MY1690 Serial MP3 player on the ESP32
+ *
+ * SparkFun sells these at its website: www.sparkfun.com
+ *
+ * Do you like this library? Help support SparkFun. Buy a board!
+ * https://www.sparkfun.com/products/15050
+ *
+ * https://github.com/sparkfun/SparkFun_MY1690_MP3_Decoder_Arduino_Library
+ *
+ * @author SparkFun Electronics
+ * @date 2024
+ * @copyright Copyright (c) 2025, SparkFun Electronics Inc. This project is released under the MIT License.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+#include "SparkFun_MY1690_Task.h"
+
+#if defined(ESP32)
+
+MY1690Future::MY1690Future() : _status(MY1690_STATUS_INVALID)
+{
+}
+
+MY1690Status MY1690Future::status(void)
+{
+    return ((MY1690Status)_status.load(std::memory_order_acquire));
+}
+
+uint16_t MY1690Future::value(void)
+{
+    return (_value);
+}
+
+MY1690Status MY1690Future::wait(TickType_t ticks)
+{
+    TickType_t startTick = xTaskGetTickCount();
+    while (status() == MY1690_STATUS_PENDING)
+    {
+        TickType_t waited = xTaskGetTickCount() - startTick;
+        if (ticks != portMAX_DELAY && waited >= ticks)
+            break;
+
+        // A notification given for something else just goes round the loop again
+        TickType_t timeout = ticks == portMAX_DELAY ? portMAX_DELAY : ticks - waited;
+#ifdef MY1690_TASK_NOTIFY_INDEX
+        ulTaskNotifyTakeIndexed(MY1690_TASK_NOTIFY_INDEX, pdTRUE, timeout);
+#else
+        ulTaskNotifyTake(pdTRUE, timeout);
+#endif
+    }
+    return (status());
+}
+
+// Runs in the driver task
+void MY1690Future::complete(MY1690Future *future, MY1690Status status, uint16_t value)
+{
+    if (future == nullptr)
+        return;
+
+    TaskHandle_t waiter = future->_waiter; // The future may be gone as soon as its status is stored
+    future->_value = value;
+    future->_status.store(status, std::memory_order_release);
+    if (waiter == nullptr)
+        return;
+#ifdef MY1690_TASK_NOTIFY_INDEX
+    xTaskNotifyGiveIndexed(waiter, MY1690_TASK_NOTIFY_INDEX);
+#else
+    xTaskNotifyGive(waiter);
+#endif
+}
+
+bool MY1690Mailbox::post(uint8_t opcode, uint16_t param, uint8_t paramLength, MY1690Future *future)
+{
+    // Announce the post before checking the driver. end() clears _running before it reads _posting,
+    // and both sides use sequentially consistent order, so either this sees the driver stopping or
+    // end() waits for the request to be published before the mailboxes are drained.
+    _driver->_posting.fetch_add(1);
+    bool posted = publish(opcode, param, paramLength, future);
+    _driver->_posting.fetch_sub(1);
+    return (posted);
+}
+
+bool MY1690Mailbox::publish(uint8_t opcode, uint16_t param, uint8_t paramLength, MY1690Future *future)
+{
+    if (_driver->_running.load() == false)
+        return (false);
+
+    uint8_t head = _head.load(std::memory_order_relaxed);
+    uint8_t next = (head + 1) % (MY1690_TASK_MAILBOX_SIZE + 1);
+    if (next == _tail.load(std::memory_order_acquire))
+        return (false); // Full
+
+    if (future != nullptr)
+    {
+        future->_value = 0;
+        future->_waiter = xTaskGetCurrentTaskHandle();
+        future->_status.store(MY1690_STATUS_PENDING, std::memory_order_relaxed);
+    }
+
+    MY1690TaskRequest *request = &_requests[head];
+    request->opcode = opcode;
+    request->param = param;
+    request->paramLength = paramLength;
+    request->future = future;
+
+    _head.store(next, std::memory_order_release); // Publishes the request to the driver
+    _driver->wake();
+    return (true);
+}
+
+MY1690Status MY1690Mailbox::call(uint8_t opcode, uint16_t param, uint8_t paramLength, uint16_t *value)
+{
+    MY1690Future future;
+    while (post(opcode, param, paramLength, &future) == false)
+    {
+        if (_driver->_running.load(std::memory_order_acquire) == false)
+            return (MY1690_STATUS_CANCELLED);
+        vTaskDelay(1); // Mailbox full, let the driver catch up
+    }
+
+    // Waits for good: the future lives on this stack and the driver completes it, if only by cancelling it in end()
+    future.wait(portMAX_DELAY);
+
+    if (value != nullptr)
+        *value = future.value();
+    return (future.status());
+}
+
+// Oldest request not yet taken by the driver, or nullptr
+MY1690TaskRequest *MY1690Mailbox::peek(void)
+{
+    uint8_t tail = _tail.load(std::memory_order_relaxed);
+    if (tail == _head.load(std::memory_order_acquire))
+        return (nullptr);
+    return (&_requests[tail]);
+}
+
+void MY1690Mailbox::pop(void)
+{
+    uint8_t tail = _tail.load(std::memory_order_relaxed);
+    _tail.store((tail + 1) % (MY1690_TASK_MAILBOX_SIZE + 1), std::memory_order_release); // Frees the slot for the producer
+}
+
+MY1690Task::MY1690Task(SparkFunMY1690 &player) : _running(false), _stopping(false), _posting(0)
+{
+    _player = &player;
+    for (uint8_t x = 0; x < MY1690_TASK_MAILBOXES; x++)
+    {
+        _mailboxes[x]._head.store(0);
+        _mailboxes[x]._tail.store(0);
+        _mailboxes[x]._open.store(false);
+        _mailboxes[x]._driver = this;
+    }
+}
+
+bool MY1690Task::begin(BaseType_t core, UBaseType_t priority, uint32_t stackSize)
+{
+    if (_task != nullptr)
+        return (true);
+
+    _stopping.store(false);
+    _running.store(true);
+    if (xTaskCreatePinnedToCore(taskEntry, "MY1690", stackSize, this, priority, &_task, core) != pdPASS)
+    {
+        _running.store(false);
+        _task = nullptr;
+        return (false);
+    }
+    return (true);
+}
+
+void MY1690Task::end(void)
+{
+    if (_task == nullptr)
+        return;
+
+    // No post() can start publishing from here on. Let those already past the check finish.
+    _running.store(false);
+    while (_posting.load() > 0)
+        vTaskDelay(1);
+
+    // The driver stops between updates, so the player is never left half way through one
+    _stopping.store(true, std::memory_order_release);
+    while (_stopping.load(std::memory_order_acquire) == true)
+    {
+        wake();
+        vTaskDelay(1);
+    }
+    _task = nullptr;
+}
+
+MY1690Mailbox *MY1690Task::openMailbox(void)
+{
+    for (uint8_t x = 0; x < MY1690_TASK_MAILBOXES; x++)
+    {
+        bool expected = false;
+        if (_mailboxes[x]._open.compare_exchange_strong(expected, true) == true)
+            return (&_mailboxes[x]);
+    }
+    return (nullptr);
+}
+
+void MY1690Task::closeMailbox(MY1690Mailbox *mailbox)
+{
+    if (mailbox != nullptr)
+        mailbox->_open.store(false);
+}
+
+void MY1690Task::wake(void)
+{
+    if (_task != nullptr)
+        xTaskNotifyGive(_task);
+}
+
+void MY1690Task::taskEntry(void *parameter)
+{
+    MY1690Task *driver = (MY1690Task *)parameter;
+    driver->run();
+    driver->cancelPending();
+
+    // end() may return and the driver be destroyed as soon as this is stored
+    driver->_stopping.store(false, std::memory_order_release);
+    vTaskDelete(nullptr);
+}
+
+void MY1690Task::run(void)
+{
+    while (_stopping.load(std::memory_order_acquire) == false)
+    {
+        bool waiting = drainMailboxes();
+        _player->update();
+
+        // Poll quickly while a reply is due, otherwise sleep until a producer posts
+        if (_player->commandsPending() > 0)
+            ulTaskNotifyTake(pdTRUE, 1);
+        else if (waiting == false)
+            ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(MY1690_TASK_IDLE_MS));
+    }
+}
+
+// Moves requests into the player's queue, taking one per mailbox in turn
+// Returns true if requests are left because the queue is full
+bool MY1690Task::drainMailboxes(void)
+{
+    uint8_t empty = 0;
+    while (empty < MY1690_TASK_MAILBOXES)
+    {
+        MY1690Mailbox *mailbox = &_mailboxes[_nextMailbox];
+        _nextMailbox = (_nextMailbox + 1) % MY1690_TASK_MAILBOXES;
+
+        MY1690TaskRequest *request = mailbox->peek();
+        if (request == nullptr)
+        {
+            empty++;
+            continue;
+        }
+        empty = 0;
+
+        // Fire and forget requests carry no callback, so they can still be merged in the queue
+        MY1690Handle handle =
+            _player->submit(request->opcode, request->param, request->paramLength,
+                            request->future != nullptr ? requestComplete : nullptr, request->future);
+        if (handle == MY1690_INVALID_HANDLE)
+            return (true); // Queue full, try again after update()
+
+        mailbox->pop();
+    }
+    return (false);
+}
+
+// Completes every future still waiting, as the driver stops
+void MY1690Task::cancelPending(void)
+{
+    for (uint8_t x = 0; x < MY1690_TASK_MAILBOXES; x++)
+    {
+        MY1690TaskRequest *request;
+        while ((request = _mailboxes[x].peek()) != nullptr)
+        {
+            MY1690Future::complete(request->future, MY1690_STATUS_CANCELLED, 0);
+            _mailboxes[x].pop();
+        }
+    }
+
+    // Only the driver submits to the player, so everything queued is ours
+    _player->cancelAll();
+}
+
+// Runs in the driver task when a command completes
+void MY1690Task::requestComplete(MY1690Handle handle, MY1690Status status, uint16_t value, void *context)
+{
+    (void)handle;
+    MY1690Future::complete((MY1690Future *)context, status, value);
+}
+
+#endif // ESP32
@@ -0,0 +1,228 @@
+/*!
+ * @file SparkFun_MY1690_Task.h
+ * @brief  FreeRTOS task that services the MY1690 Serial MP3 player on the ESP32
+ *
+ * SparkFun sells these at its website: www.sparkfun.com
+ *
+ * Do you like this library? Help support SparkFun. Buy a board!
+ * https://www.sparkfun.com/products/15050
+ *
+ * https://github.com/sparkfun/SparkFun_MY1690_MP3_Decoder_Arduino_Library
+ *
+ * @author SparkFun Electronics
+ * @date 2024
+ * @copyright Copyright (c) 2025, SparkFun Electronics Inc. This project is released under the MIT License.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef SPARKFUN_MY1690_TASK_H
+#define SPARKFUN_MY1690_TASK_H
+
+#include "SparkFun_MY1690_MP3_Library.h"
+
+#if defined(ESP32)
+
+#include <atomic>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+// Number of tasks that can post commands at the same time, one mailbox each
+#ifndef MY1690_TASK_MAILBOXES
+#define MY1690_TASK_MAILBOXES 4
+#endif
+
+// Commands a single mailbox can hold before post() fails
+#ifndef MY1690_TASK_MAILBOX_SIZE
+#define MY1690_TASK_MAILBOX_SIZE 4
+#endif
+
+// Notification futures wake their task with. The last of the task's notifications where FreeRTOS
+// has more than one, so wait() leaves the default one, used by xTaskNotifyGive(), alone.
+#if !defined(MY1690_TASK_NOTIFY_INDEX) && defined(configTASK_NOTIFICATION_ARRAY_ENTRIES)
+#if configTASK_NOTIFICATION_ARRAY_ENTRIES > 1
+#define MY1690_TASK_NOTIFY_INDEX (configTASK_NOTIFICATION_ARRAY_ENTRIES - 1)
+#endif
+#endif
+
+// Core the driver task is pinned to. The last core, which is the one loop() runs on, keeps it away from WiFi.
+#ifndef MY1690_TASK_CORE
+#define MY1690_TASK_CORE (portNUM_PROCESSORS - 1)
+#endif
+
+#define MY1690_TASK_PRIORITY 5
+#define MY1690_TASK_STACK_SIZE 4096
+#define MY1690_TASK_IDLE_MS 10 // Longest sleep when there is nothing to do, so busy pin events still get raised
+
+/*!
+ * @brief The result of a command posted to the driver task, filled in when it completes.
+ *
+ * Owned by the posting task and must stay alive until it completes. The driver
+ * wakes the posting task with a task notification when it does.
+ */
+class MY1690Future
+{
+  public:
+    MY1690Future();
+
+    /**
+     * @brief Returns the status without waiting. MY1690_STATUS_PENDING until the command completes.
+     */
+    MY1690Status status(void);
+    /**
+     * @brief Returns the number the device replied with. Valid once status() is not pending.
+     */
+    uint16_t value(void);
+    /**
+     * @brief Blocks the calling task until the command completes.
+     *
+     * Waits on the calling task's notification MY1690_TASK_NOTIFY_INDEX, so it must be the task
+     * that posted the command. Where FreeRTOS gives each task a single notification there is no
+     * index to spare: the wait then takes over the task's notification value and clears it.
+     *
+     * @param ticks Longest time to wait. The engine times out every command, so portMAX_DELAY is safe.
+     *
+     * @return The final status, or MY1690_STATUS_PENDING if the wait ran out first.
+     */
+    MY1690Status wait(TickType_t ticks = portMAX_DELAY);
+
+  protected:
+    friend class MY1690Mailbox;
+    friend class MY1690Task;
+
+    std::atomic<uint8_t> _status; // MY1690Status, written last by the driver
+    uint16_t _value = 0;
+    TaskHandle_t _waiter = nullptr;
+
+    static void complete(MY1690Future *future, MY1690Status status, uint16_t value);
+};
+
+typedef struct
+{
+    uint8_t opcode;
+    uint8_t paramLength;
+    uint16_t param;
+    MY1690Future *future; // May be nullptr
+} MY1690TaskRequest;
+
+class MY1690Task;
+
+/*!
+ * @class MY1690Mailbox
+ * @brief Lock-free single producer, single consumer queue from one task to the driver task.
+ *
+ * Each task that talks to the player opens its own mailbox, so no two tasks ever write
+ * the same one and no mutex is needed anywhere.
+ */
+class MY1690Mailbox
+{
+  public:
+    /**
+     * @brief Posts a command to the driver task and returns immediately.
+     *
+     * @param opcode One of the MP3_COMMAND_ values.
+     * @param param Parameter for the command. Two byte parameters are sent MSB first.
+     * @param paramLength Number of parameter bytes to send, 0 to 2.
+     * @param future Optional, filled in when the command completes.
+     *
+     * @return false if the mailbox is full or the driver task isn't running.
+     */
+    bool post(uint8_t opcode, uint16_t param = 0, uint8_t paramLength = 0, MY1690Future *future = nullptr);
+    /**
+     * @brief Posts a command and blocks the calling task, not the CPU, until it completes.
+     *
+     * @param opcode One of the MP3_COMMAND_ values.
+     * @param param Parameter for the command. Two byte parameters are sent MSB first.
+     * @param paramLength Number of parameter bytes to send, 0 to 2.
+     * @param value Optional, filled with the number the device replied with.
+     *
+     * @return The final status of the command. MY1690_STATUS_CANCELLED if the driver task stops first.
+     */
+    MY1690Status call(uint8_t opcode, uint16_t param = 0, uint8_t paramLength = 0, uint16_t *value = nullptr);
+
+  protected:
+    friend class MY1690Task;
+
+    MY1690TaskRequest _requests[MY1690_TASK_MAILBOX_SIZE + 1]; // One slot always free, to tell full from empty
+    std::atomic<uint8_t> _head; // Written by the producer only
+    std::atomic<uint8_t> _tail; // Written by the driver only
+    std::atomic<bool> _open;
+    MY1690Task *_driver = nullptr;
+
+    bool publish(uint8_t opcode, uint16_t param, uint8_t paramLength, MY1690Future *future);
+    MY1690TaskRequest *peek(void);
+    void pop(void);
+};
+
+/*!
+ * @class MY1690Task
+ * @brief Runs a player's command engine in its own FreeRTOS task pinned to a core.
+ *
+ * Once begin() returns, only the driver task touches the player and its serial port.
+ * Other tasks open a mailbox and post commands to it; their results come back through
+ * futures and task notifications. The driver sleeps on its own notification whenever
+ * the engine is idle, so UART waits never land on the posting tasks.
+ */
+class MY1690Task
+{
+  public:
+    /**
+     * @brief Creates a driver for a player.
+     *
+     * @param player A player that begin() has been called on.
+     */
+    MY1690Task(SparkFunMY1690 &player);
+
+    /**
+     * @brief Starts the driver task.
+     *
+     * @param core Core to pin the task to. Defaults to MY1690_TASK_CORE.
+     * @param priority FreeRTOS priority. Defaults to MY1690_TASK_PRIORITY.
+     * @param stackSize Stack in bytes. Defaults to MY1690_TASK_STACK_SIZE.
+     *
+     * @return false if the task could not be created.
+     */
+    bool begin(BaseType_t core = MY1690_TASK_CORE, UBaseType_t priority = MY1690_TASK_PRIORITY,
+               uint32_t stackSize = MY1690_TASK_STACK_SIZE);
+    /**
+     * @brief Stops the driver task.
+     *
+     * Commands still in mailboxes or the player's queue are cancelled first, so every
+     * future completes with MY1690_STATUS_CANCELLED and no task is left waiting on one.
+     * Replies to commands already sent are taken by the player's next update().
+     */
+    void end(void);
+
+    /**
+     * @brief Claims a mailbox for the calling task.
+     *
+     * @return The mailbox, or nullptr if MY1690_TASK_MAILBOXES are already open.
+     */
+    MY1690Mailbox *openMailbox(void);
+    /**
+     * @brief Gives a mailbox back once its task has no commands outstanding.
+     */
+    void closeMailbox(MY1690Mailbox *mailbox);
+
+  protected:
+    friend class MY1690Mailbox;
+
+    SparkFunMY1690 *_player;
+    TaskHandle_t _task = nullptr;
+    std::atomic<bool> _running;    // Cleared by end(), so post() fails from then on
+    std::atomic<bool> _stopping;   // Set by end() until the driver has cancelled everything and stopped
+    std::atomic<uint8_t> _posting; // post() calls under way, which end() waits out before stopping the driver
+    MY1690Mailbox _mailboxes[MY1690_TASK_MAILBOXES];
+    uint8_t _nextMailbox = 0; // Round robin between producers so none can starve the others
+
+    void wake(void);
+    void run(void);
+    bool drainMailboxes(void);
+    void cancelPending(void);
+    static void taskEntry(void *parameter);
+    static void requestComplete(MY1690Handle handle, MY1690Status status, uint16_t value, void *context);
+};
+
+#endif // ESP32
+
+#endif
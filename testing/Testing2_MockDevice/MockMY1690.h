@@ -0,0 +1,396 @@
+/*
+  A simulated MY1690 that lives on the other end of a Stream.
+
+  It decodes the 0x7E len ... crc 0xEF frames written to it and queues the
+  same replies the real IC sends, paced at the configured baud rate. Jitter
+  and dropped reply bytes can be dialed in to stress the library.
+*/
+
+#ifndef MOCK_MY1690_H
+#define MOCK_MY1690_H
+
+#include "Arduino.h"
+
+#define MOCK_MY1690_TX_BUFFER_SIZE 96
+
+class MockMY1690 : public Stream
+{
+  public:
+    // Device configuration
+    uint16_t firmwareVersion = 101;     // 100 or 101
+    uint32_t baudRate = 9600;           // Pacing of reply bytes
+    uint32_t responseDelayUs = 2000;    // Time the IC takes to start replying
+    uint32_t jitterUs = 0;              // Random extra delay added to each reply
+    uint16_t dropPerMille = 0;          // Chance of losing any single reply byte
+    bool okPrefixOnQueries = false;     // v1.1 sometimes answers 'OK0001 \r\n'
+    uint8_t busyPin = 255;              // Driven with digitalWrite when set
+    uint32_t trackLengthMs = 3000;      // How long every simulated track plays
+    bool stopMessages = true;           // Send 'STOP' when a track ends
+    bool powered = true;                // When false the device never answers
+    bool hung = false;                  // When true only a reset gets an answer, and clears it
+
+    // Device state
+    uint8_t volume = 20;
+    uint8_t eq = 0;
+    uint8_t loopMode = 0;
+    uint8_t status = 0; // 0 = stop, 1 = play, 2 = pause
+    uint16_t track = 1;
+    uint16_t songCount = 12;
+    uint8_t folderCount[4] = {3, 4, 5, 0};
+
+    // Statistics
+    uint16_t framesReceived = 0;
+    uint16_t badFrames = 0;
+    uint8_t lastOpcode = 0;
+
+    size_t write(uint8_t incoming) override
+    {
+        uint32_t now = micros();
+        // The byte arrives at the device one character time after the previous one
+        if ((int32_t)(now - _rxDoneUs) > 0)
+            _rxDoneUs = now;
+        _rxDoneUs += byteTimeUs();
+
+        switch (_rxState)
+        {
+        case 0:
+            if (incoming == 0x7E)
+                _rxState = 1;
+            break;
+        case 1:
+            _rxLength = incoming;
+            _rxCount = 0;
+            _rxState = (_rxLength >= 3 && _rxLength <= 5) ? 2 : 0;
+            break;
+        case 2:
+            _rxFrame[_rxCount++] = incoming;
+            if (_rxCount == _rxLength - 1) // Payload plus CRC
+                _rxState = 3;
+            break;
+        case 3:
+            _rxState = 0;
+            if (incoming == 0xEF)
+                handleFrame();
+            else
+                badFrames++;
+            break;
+        }
+        return (1);
+    }
+    using Print::write;
+
+    int available() override
+    {
+        advance();
+        uint32_t now = micros();
+        int count = 0;
+        for (uint8_t x = _txTail; x != _txHead; x = (x + 1) % MOCK_MY1690_TX_BUFFER_SIZE)
+        {
+            if ((int32_t)(now - _txTime[x]) < 0)
+                break;
+            count++;
+        }
+        return (count);
+    }
+
+    int read() override
+    {
+        if (available() == 0)
+            return (-1);
+        uint8_t c = _txByte[_txTail];
+        _txTail = (_txTail + 1) % MOCK_MY1690_TX_BUFFER_SIZE;
+        return (c);
+    }
+
+    int peek() override
+    {
+        if (available() == 0)
+            return (-1);
+        return (_txByte[_txTail]);
+    }
+
+    uint32_t byteTimeUs(void)
+    {
+        return (10000000UL / baudRate); // 8N1 is ten bits per byte
+    }
+
+    // Send a line the IC wasn't asked for, ie "TF IN\r\n" when a card goes in
+    void sendMessage(const char *message)
+    {
+        queueReply(message);
+    }
+
+    // Let simulated playback progress. Called from every Stream access.
+    void advance(void)
+    {
+        uint32_t now = micros();
+        if (_busyPending && (int32_t)(now - _busyAtUs) >= 0)
+        {
+            _busyPending = false;
+            setBusy(true);
+        }
+        if (status == 1 && (int32_t)(now - _trackEndUs) >= 0)
+        {
+            status = 0;
+            setBusy(false);
+            if (stopMessages)
+                queueReply("STOP");
+        }
+    }
+
+  private:
+    uint8_t _rxState = 0;
+    uint8_t _rxLength = 0;
+    uint8_t _rxCount = 0;
+    uint8_t _rxFrame[5];
+    uint32_t _rxDoneUs = 0;
+
+    uint8_t _txByte[MOCK_MY1690_TX_BUFFER_SIZE];
+    uint32_t _txTime[MOCK_MY1690_TX_BUFFER_SIZE];
+    uint8_t _txHead = 0;
+    uint8_t _txTail = 0;
+    uint32_t _txFreeUs = 0;
+
+    uint32_t _trackEndUs = 0;
+    uint32_t _pausedRemainingUs = 0;
+    uint32_t _busyAtUs = 0;
+    bool _busyPending = false;
+
+    void setBusy(bool playing)
+    {
+        if (busyPin != 255)
+            digitalWrite(busyPin, playing ? HIGH : LOW);
+    }
+
+    void startTrack(uint16_t number)
+    {
+        track = number;
+        status = 1;
+        _trackEndUs = _rxDoneUs + 30000UL + trackLengthMs * 1000UL;
+        _busyAtUs = _rxDoneUs + 30000UL; // Busy goes high ~30ms after a play command
+        _busyPending = true;
+    }
+
+    void queueReply(const char *reply)
+    {
+        uint32_t now = micros();
+        uint32_t start = ((int32_t)(now - _rxDoneUs) > 0 ? now : _rxDoneUs) + responseDelayUs;
+        if (jitterUs > 0)
+            start += random(jitterUs);
+        if ((int32_t)(_txFreeUs - start) > 0)
+            start = _txFreeUs;
+
+        for (uint8_t x = 0; reply[x] != '\0'; x++)
+        {
+            start += byteTimeUs();
+            if (dropPerMille > 0 && random(1000) < dropPerMille)
+                continue;
+            uint8_t next = (_txHead + 1) % MOCK_MY1690_TX_BUFFER_SIZE;
+            if (next == _txTail)
+                break; // Overflow, the real UART would lose these too
+            _txByte[_txHead] = reply[x];
+            _txTime[_txHead] = start;
+            _txHead = next;
+        }
+        _txFreeUs = start;
+    }
+
+    void queueOK(void)
+    {
+        queueReply("OK"); // Control commands answer 'OK' with no line ending
+    }
+
+    void queueNumber(uint16_t value)
+    {
+        char reply[16];
+        if (firmwareVersion == 100)
+            snprintf(reply, sizeof(reply), "%s%04x\r\n", okPrefixOnQueries ? "OK" : "", value);
+        else
+            snprintf(reply, sizeof(reply), "%s%04X \r\n", okPrefixOnQueries ? "OK" : "", value);
+        queueReply(reply);
+    }
+
+    void handleFrame(void)
+    {
+        uint8_t crc = _rxLength;
+        for (uint8_t x = 0; x < _rxLength - 2; x++)
+            crc ^= _rxFrame[x];
+        if (crc != _rxFrame[_rxLength - 2])
+        {
+            badFrames++;
+            return;
+        }
+        framesReceived++;
+        lastOpcode = _rxFrame[0];
+
+        if (powered == false)
+            return;
+        if (hung == true)
+        {
+            if (_rxFrame[0] != 0x19)
+                return;
+            hung = false;
+        }
+
+        uint16_t param = 0;
+        if (_rxLength == 4)
+            param = _rxFrame[1];
+        else if (_rxLength == 5)
+            param = ((uint16_t)_rxFrame[1] << 8) | _rxFrame[2];
+
+        switch (_rxFrame[0])
+        {
+        case 0x11: // Play, no reply in v1.1
+            if (status == 2)
+            {
+                status = 1;
+                _trackEndUs = _rxDoneUs + _pausedRemainingUs;
+                setBusy(true);
+            }
+            else
+                startTrack(track);
+            if (firmwareVersion == 100)
+                queueOK();
+            break;
+        case 0x12: // Pause
+            if (status == 1)
+            {
+                _pausedRemainingUs = _trackEndUs - _rxDoneUs;
+                status = 2;
+                setBusy(false);
+            }
+            queueOK();
+            break;
+        case 0x13: // Next
+            startTrack(track >= songCount ? 1 : track + 1);
+            queueOK();
+            break;
+        case 0x14: // Previous
+            startTrack(track <= 1 ? songCount : track - 1);
+            queueOK();
+            break;
+        case 0x15:
+            if (volume < 30)
+                volume++;
+            queueOK();
+            break;
+        case 0x16:
+            if (volume > 0)
+                volume--;
+            queueOK();
+            break;
+        case 0x19: // Reset
+            status = 0;
+            volume = 20;
+            eq = 0;
+            loopMode = 0;
+            setBusy(false);
+            queueOK();
+            queueReply("STOPMP3\r\n");
+            queueOK();
+            break;
+        case 0x1A: // Fast forward ~1s
+            _trackEndUs -= 1000000UL;
+            queueOK();
+            break;
+        case 0x1B: // Rewind ~1s
+            _trackEndUs += 1000000UL;
+            queueOK();
+            break;
+        case 0x1C: // Play/pause
+            if (status == 1)
+            {
+                _pausedRemainingUs = _trackEndUs - _rxDoneUs;
+                status = 2;
+                setBusy(false);
+            }
+            else if (status == 2)
+            {
+                status = 1;
+                _trackEndUs = _rxDoneUs + _pausedRemainingUs;
+                setBusy(true);
+            }
+            queueOK();
+            break;
+        case 0x1E: // Stop, no reply in v1.1
+            if (status != 0)
+            {
+                status = 0;
+                setBusy(false);
+            }
+            if (firmwareVersion == 100)
+                queueOK();
+            break;
+        case 0x31: // Set volume, no reply in v1.1
+            volume = param > 30 ? 30 : param;
+            if (firmwareVersion == 100)
+                queueOK();
+            break;
+        case 0x32:
+            eq = param;
+            queueOK();
+            break;
+        case 0x33:
+            loopMode = param;
+            queueOK();
+            break;
+        case 0x41: // Select track and play
+            startTrack(param);
+            queueOK();
+            break;
+        case 0x20:
+            queueNumber(status);
+            break;
+        case 0x21:
+            queueNumber(volume);
+            break;
+        case 0x22:
+            queueNumber(eq);
+            break;
+        case 0x23:
+            queueNumber(loopMode);
+            break;
+        case 0x24:
+            if (firmwareVersion == 100)
+                queueReply(okPrefixOnQueries ? "OK1.0\r\n" : "1.0\r\n");
+            else
+                queueReply(okPrefixOnQueries ? "OK1.1\r\n" : "1.1\r\n");
+            break;
+        case 0x25:
+            queueNumber(songCount);
+            break;
+        case 0x29:
+            queueNumber(track);
+            break;
+        case 0x2C: // Elapsed seconds
+        {
+            uint32_t lengthUs = trackLengthMs * 1000UL;
+            uint32_t remaining = 0;
+            if (status == 1)
+                remaining = (int32_t)(_trackEndUs - _rxDoneUs) > 0 ? _trackEndUs - _rxDoneUs : 0;
+            else if (status == 2)
+                remaining = _pausedRemainingUs;
+            uint32_t elapsed = status == 0 ? 0 : (remaining > lengthUs ? 0 : lengthUs - remaining);
+            queueNumber(elapsed / 1000000UL);
+            break;
+        }
+        case 0x2D:
+            queueNumber(trackLengthMs / 1000UL);
+            break;
+        case 0x2E: // Current track name
+        {
+            char reply[16];
+            snprintf(reply, sizeof(reply), "%s%04u.MP3\r\n", okPrefixOnQueries ? "OK" : "", track);
+            queueReply(reply);
+            break;
+        }
+        case 0x2F: // Songs in folder
+            queueNumber(param < sizeof(folderCount) ? folderCount[param] : 0);
+            break;
+        default:
+            break;
+        }
+    }
+};
+
+#endif
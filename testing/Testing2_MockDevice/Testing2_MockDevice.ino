@@ -0,0 +1,1028 @@
+/*
+  Exercise the MY1690 library against a simulated MY1690, no hardware needed
+  By: SparkFun Electronics
+  Date: October 17th, 2026
+  License: MIT. See license file for more information but you can
+  basically do whatever you want with this code.
+
+  MockMY1690 (in the tab next to this one) is a Stream that decodes the
+  0x7E len ... crc 0xEF frames the library sends and replies the way
+  firmware v1.0 and v1.1 do, including the 'OK' prefixed number replies.
+  Replies are paced at the simulated baud rate, and jitter and dropped
+  bytes can be dialed in.
+
+  The sketch runs every command a few rounds, checks the results, then
+  prints the round trip time of each command and the worst case overall.
+  After that it checks the engine features one at a time, driving the
+  simulated device into the states each is there to handle.
+  Runs on any board. Open the serial monitor at 115200bps.
+
+  Also builds and runs on a PC, which is how CI runs it:
+    cmake -S testing -B build && cmake --build build && ctest --test-dir build -V
+*/
+
+// Note: A testing sketch - validates the library logic and reports command latency
+
+#include "SparkFun_MY1690_MP3_Library.h" // Click here to get the library: http://librarymanager/All#SparkFun_MY1690
+#include "MockMY1690.h"
+#include "SparkFun_MY1690_Capture.h"
+#include "SparkFun_MY1690_Catalog.h"
+#include "SparkFun_MY1690_Sequencer.h"
+#include "SparkFun_MY1690_Position.h"
+#include "SparkFun_MY1690_Cue.h"
+#include "SparkFun_MY1690_Ramp.h"
+#include "SparkFun_MY1690_Bus.h"
+
+MockMY1690 mockMP3;
+SparkFunMY1690 myMP3;
+MY1690Catalog catalog(myMP3);
+MY1690Sequencer sequencer(myMP3);
+MY1690PositionTracker tracker(myMP3);
+MY1690CueScheduler cues(tracker);
+MY1690VolumeRamp ramp(myMP3);
+
+// A second simulated module, for the bus
+MockMY1690 mockZone2;
+SparkFunMY1690 zone2;
+
+#define ROUNDS 5
+
+struct TestCommand
+{
+    const char *name;
+    uint8_t opcode;
+    uint16_t param;
+    uint8_t paramLength;
+};
+
+struct Latency
+{
+    uint32_t minUs;
+    uint32_t maxUs;
+    uint32_t totalUs;
+    uint8_t failures;
+};
+
+TestCommand commands[] = {
+    {"getPlayStatus", MP3_COMMAND_GET_STATUS, 0, 0},
+    {"getVolume", MP3_COMMAND_GET_VOLUME, 0, 0},
+    {"getEQ", MP3_COMMAND_GET_EQ, 0, 0},
+    {"getPlayMode", MP3_COMMAND_GET_LOOP_MODE, 0, 0},
+    {"getVersion", MP3_COMMAND_GET_VERSION_NUMBER, 0, 0},
+    {"getSongCount", MP3_COMMAND_GET_SONG_COUNT, 0, 0},
+    {"getTrackNumber", MP3_COMMAND_GET_CURRENT_TRACK, 0, 0},
+    {"getTrackElapsedTime", MP3_COMMAND_GET_CURRENT_TRACK_TIME, 0, 0},
+    {"getTrackTotalTime", MP3_COMMAND_GET_CURRENT_TRACK_TIME_TOTAL, 0, 0},
+    {"setVolume", MP3_COMMAND_SET_VOLUME, 15, 1},
+    {"setEQ", MP3_COMMAND_SET_EQ_MODE, 2, 1},
+    {"setPlayMode", MP3_COMMAND_SET_LOOP_MODE, MP3_LOOP_MODE_NO_LOOP, 1},
+    {"volumeUp", MP3_COMMAND_VOLUME_UP, 0, 0},
+    {"volumeDown", MP3_COMMAND_VOLUME_DOWN, 0, 0},
+    {"playTrackNumber", MP3_COMMAND_SELECT_TRACK_PLAY, 3, 2},
+    {"pause", MP3_COMMAND_PAUSE, 0, 0},
+    {"playPause", MP3_COMMAND_PLAY_PAUSE, 0, 0},
+    {"fastForward", MP3_COMMAND_FASTFOWARD, 0, 0},
+    {"rewind", MP3_COMMAND_REWIND, 0, 0},
+    {"stop", MP3_COMMAND_STOP, 0, 0},
+};
+const uint8_t commandCount = sizeof(commands) / sizeof(commands[0]);
+Latency latency[commandCount];
+
+uint8_t testsFailed = 0;
+
+void check(bool condition, const __FlashStringHelper *description)
+{
+    Serial.print(condition ? F("PASS: ") : F("FAIL: "));
+    Serial.println(description);
+    if (condition == false)
+        testsFailed++;
+}
+
+void setup()
+{
+    Serial.begin(115200);
+    delay(250);
+    Serial.println(F("MY1690 Testing 2 - Simulated device"));
+
+    mockMP3.baudRate = 9600;
+    mockMP3.jitterUs = 500;
+
+    // Functional checks through the blocking API
+    unsigned long startTime = micros();
+    check(myMP3.begin(mockMP3), F("begin"));
+    Serial.print(F("begin took (us): "));
+    Serial.println(micros() - startTime);
+
+    check(myMP3.getVersion() == 101, F("getVersion v1.1"));
+    check(myMP3.getSongCount() == mockMP3.songCount, F("getSongCount"));
+    check(myMP3.setVolume(17) && myMP3.getVolume() == 17, F("setVolume / getVolume"));
+    check(myMP3.setEQ(MP3_EQ_MODE_JAZZ) && myMP3.getEQ() == MP3_EQ_MODE_JAZZ, F("setEQ / getEQ"));
+    check(myMP3.setPlayModeSingle() && myMP3.getPlayMode() == MP3_LOOP_MODE_SINGLE, F("setPlayMode / getPlayMode"));
+    check(myMP3.playTrackNumber(5) && myMP3.getTrackNumber() == 5, F("playTrackNumber / getTrackNumber"));
+    check(myMP3.getPlayStatus() == 1, F("getPlayStatus playing"));
+    check(myMP3.stopPlaying() && myMP3.getPlayStatus() == 0, F("stopPlaying"));
+
+    mockMP3.okPrefixOnQueries = true;
+    check(myMP3.getVolume() == 17, F("'OK' prefixed number reply"));
+    check(myMP3.isConnected() && myMP3.getVersion() == 101, F("'OK' prefixed version reply"));
+
+    mockMP3.firmwareVersion = 100;
+    check(myMP3.isConnected() && myMP3.getVersion() == 100, F("getVersion v1.0"));
+    check(myMP3.getTrackNumber() == 5, F("v1.0 lower case hex reply"));
+    mockMP3.firmwareVersion = 101;
+    mockMP3.okPrefixOnQueries = false;
+
+    // Latency of every command through the non-blocking engine
+    for (uint8_t round = 0; round < ROUNDS; round++)
+    {
+        for (uint8_t x = 0; x < commandCount; x++)
+        {
+            TestCommand *command = &commands[x];
+            Latency *result = &latency[x];
+
+            startTime = micros();
+            MY1690Handle handle = myMP3.submit(command->opcode, command->param, command->paramLength);
+            MY1690Status status = myMP3.waitFor(handle);
+            uint32_t roundTrip = micros() - startTime;
+
+            if (status != MY1690_STATUS_OK)
+                result->failures++;
+            if (round == 0 || roundTrip < result->minUs)
+                result->minUs = roundTrip;
+            if (roundTrip > result->maxUs)
+                result->maxUs = roundTrip;
+            result->totalUs += roundTrip;
+        }
+    }
+    printLatency();
+
+    // Dropped bytes should end in a timeout or a parse error, never a hang
+    mockMP3.dropPerMille = 100;
+    uint8_t completed = 0;
+    for (uint8_t x = 0; x < 20; x++)
+    {
+        MY1690Handle handle = myMP3.submit(MP3_COMMAND_GET_VOLUME);
+        if (myMP3.waitFor(handle) != MY1690_STATUS_PENDING)
+            completed++;
+    }
+    check(completed == 20, F("every command completes with 10% of bytes dropped"));
+    mockMP3.dropPerMille = 0;
+
+    // An unplugged module must fail fast
+    mockMP3.powered = false;
+    startTime = micros();
+    check(myMP3.isConnected() == false, F("isConnected with no module"));
+    uint32_t probeUs = micros() - startTime;
+    Serial.print(F("isConnected with no module took (us): "));
+    Serial.println(probeUs);
+    check(probeUs < 2000UL * myMP3.getResponseTimeout(MP3_COMMAND_GET_VERSION_NUMBER), F("isConnected is not retried"));
+    mockMP3.powered = true;
+
+    testQueue();
+    testCache();
+    testStats();
+    testFolders();
+    testRecovery();
+    testUnsolicited();
+    testPriority();
+    testAdaptiveTimeout();
+    testCatalog();
+    testFrames();
+    testSnapshot();
+    testCapture();
+    testSequencer();
+    testCues();
+    testBaudRate();
+    testRamp();
+    testBus();
+    testPosition();
+
+    Serial.println();
+    if (testsFailed == 0)
+        Serial.println(F("All tests passed"));
+    else
+    {
+        Serial.print(testsFailed);
+        Serial.println(F(" test(s) failed"));
+    }
+}
+
+void loop()
+{
+}
+
+void printLatency()
+{
+    uint32_t worstUs = 0;
+    const char *worstName = "";
+
+    Serial.println();
+    Serial.println(F("Command              min(us)  mean(us)  max(us)  failures"));
+    for (uint8_t x = 0; x < commandCount; x++)
+    {
+        Latency *result = &latency[x];
+
+        Serial.print(commands[x].name);
+        for (uint8_t pad = strlen(commands[x].name); pad < 21; pad++)
+            Serial.print(' ');
+        Serial.print(result->minUs);
+        Serial.print(F("\t "));
+        Serial.print(result->totalUs / ROUNDS);
+        Serial.print(F("\t   "));
+        Serial.print(result->maxUs);
+        Serial.print(F("\t    "));
+        Serial.println(result->failures);
+
+        if (result->maxUs > worstUs)
+        {
+            worstUs = result->maxUs;
+            worstName = commands[x].name;
+        }
+        if (result->failures > 0)
+            testsFailed++;
+    }
+
+    Serial.print(F("Worst case (us): "));
+    Serial.print(worstUs);
+    Serial.print(F(" - "));
+    Serial.println(worstName);
+}
+
+// Time to read four different settings with a given number of queries in flight
+uint32_t timeQueries(uint8_t depth, bool &allOK)
+{
+    const uint8_t queries[] = {MP3_COMMAND_GET_VOLUME, MP3_COMMAND_GET_EQ, MP3_COMMAND_GET_LOOP_MODE,
+                               MP3_COMMAND_GET_SONG_COUNT};
+    MY1690Handle handles[4];
+
+    myMP3.setPipelineDepth(depth);
+    unsigned long startTime = micros();
+    for (uint8_t x = 0; x < 4; x++)
+        handles[x] = myMP3.submit(queries[x]);
+
+    uint16_t songCount = 0;
+    allOK = true;
+    for (uint8_t x = 0; x < 4; x++)
+    {
+        if (myMP3.waitFor(handles[x], &songCount) != MY1690_STATUS_OK)
+            allOK = false;
+    }
+    uint32_t elapsed = micros() - startTime;
+
+    myMP3.setPipelineDepth(MY1690_PIPELINE_DEPTH);
+    if (songCount != mockMP3.songCount)
+        allOK = false; // Replies matched to the wrong queries
+    return (elapsed);
+}
+
+// Superseded commands are merged before they go out, and queries can share a round trip
+void testQueue()
+{
+    uint16_t framesBefore = mockMP3.framesReceived;
+    uint16_t mergedBefore = myMP3.getCoalescedCount();
+    MY1690Handle first = myMP3.submit(MP3_COMMAND_SET_EQ_MODE, MP3_EQ_MODE_POP, 1);
+    myMP3.submit(MP3_COMMAND_SET_EQ_MODE, MP3_EQ_MODE_ROCK, 1);
+    MY1690Handle last = myMP3.submit(MP3_COMMAND_SET_EQ_MODE, MP3_EQ_MODE_BASS, 1);
+    check(last == first && myMP3.waitFor(first) == MY1690_STATUS_OK, F("three EQ changes share one handle"));
+    check(mockMP3.framesReceived - framesBefore == 1 && mockMP3.eq == MP3_EQ_MODE_BASS, F("only the last EQ is sent"));
+    check(myMP3.getCoalescedCount() - mergedBefore == 2, F("getCoalescedCount"));
+
+    bool sequentialOK;
+    bool pipelinedOK;
+    uint32_t sequentialUs = timeQueries(1, sequentialOK);
+    uint32_t pipelinedUs = timeQueries(4, pipelinedOK);
+    check(sequentialOK && pipelinedOK, F("pipelined replies match their queries"));
+    check(pipelinedUs < sequentialUs, F("pipelined queries finish sooner"));
+    Serial.print(F("Four queries one at a time / pipelined (us): "));
+    Serial.print(sequentialUs);
+    Serial.print(F(" / "));
+    Serial.println(pipelinedUs);
+}
+
+// Cached settings are answered from memory until they're marked stale
+void testCache()
+{
+    myMP3.enableStateCache();
+    check(myMP3.setVolume(12) && myMP3.getVolume() == 12, F("setVolume / getVolume with the cache on"));
+
+    uint16_t framesBefore = mockMP3.framesReceived;
+    check(myMP3.getVolume() == 12 && mockMP3.framesReceived == framesBefore, F("cached getVolume sends nothing"));
+
+    mockMP3.volume = 9; // Changed behind the library's back
+    myMP3.invalidateStateCache();
+    check(myMP3.getVolume() == 9 && mockMP3.framesReceived == framesBefore + 1, F("invalidateStateCache"));
+    myMP3.enableStateCache(false);
+}
+
+// Every query is counted and timed when the library is built with MY1690_ENABLE_STATS 1
+void testStats()
+{
+    myMP3.resetStats();
+    for (uint8_t x = 0; x < 3; x++)
+        myMP3.getEQ();
+
+    const MY1690CommandStats *stats = myMP3.getStats(MP3_COMMAND_GET_EQ);
+#if MY1690_ENABLE_STATS
+    check(stats != nullptr && stats->sent == 3 && stats->ok == 3, F("getStats counts every getEQ"));
+    check(stats != nullptr && stats->minUs > 0 && stats->minUs <= stats->maxUs, F("getStats round trip times"));
+    myMP3.printStats(Serial);
+#else
+    check(stats == nullptr, F("getStats is empty without MY1690_ENABLE_STATS"));
+#endif
+}
+
+// Songs per folder, including an empty folder and one that doesn't exist
+void testFolders()
+{
+    bool allMatch = true;
+    for (uint8_t folder = 0; folder < sizeof(mockMP3.folderCount); folder++)
+    {
+        if (myMP3.getSongsInFolderCount(folder) != mockMP3.folderCount[folder])
+            allMatch = false;
+    }
+    check(allMatch, F("getSongsInFolderCount"));
+    check(myMP3.getSongsInFolderCount(9) == 0, F("getSongsInFolderCount of a missing folder"));
+}
+
+// Keeps the engine running, ie while it recovers or unsolicited messages arrive
+void runFor(uint16_t milliseconds)
+{
+    unsigned long startTime = millis();
+    while (millis() - startTime < milliseconds)
+        myMP3.update();
+}
+
+// A lost reply is retried, and a module that stops answering is reset and given its settings back
+void testRecovery()
+{
+    // The first try goes unanswered, the retry finds the module back
+    uint16_t retriesBefore = myMP3.getRetryCount();
+    mockMP3.powered = false;
+    MY1690Handle handle = myMP3.submit(MP3_COMMAND_GET_VOLUME);
+    unsigned long startTime = millis();
+    while (myMP3.getRetryCount() == retriesBefore && millis() - startTime < 1000)
+        myMP3.update();
+    mockMP3.powered = true;
+    uint16_t volume = 0;
+    check(myMP3.waitFor(handle, &volume) == MY1690_STATUS_OK && volume == mockMP3.volume, F("a retry recovers a lost reply"));
+    check(myMP3.getRetryCount() == retriesBefore + 1, F("getRetryCount"));
+
+    // Three timeouts in a row reset the module, then the cached settings are sent back
+    myMP3.enableStateCache();
+    myMP3.setVolume(25);
+    myMP3.setEQ(MP3_EQ_MODE_ROCK);
+    myMP3.setPlayModeSingle();
+    myMP3.setRetryPolicy(MY1690_CLASS_QUERY, 0);
+    myMP3.setResetThreshold(3);
+
+    uint16_t recoveriesBefore = myMP3.getRecoveryCount();
+    mockMP3.hung = true;
+    for (uint8_t x = 0; x < 3; x++)
+        myMP3.getTrackNumber();
+    runFor(500);
+
+    check(myMP3.getRecoveryCount() == recoveriesBefore + 1 && mockMP3.hung == false, F("timeouts in a row reset the module"));
+    check(mockMP3.volume == 25 && mockMP3.eq == MP3_EQ_MODE_ROCK && mockMP3.loopMode == MP3_LOOP_MODE_SINGLE,
+          F("settings restored after the reset"));
+    check(myMP3.getTrackNumber() == mockMP3.track, F("commands work again after the reset"));
+
+    myMP3.setRetryPolicy(MY1690_CLASS_QUERY, MY1690_RETRIES);
+    myMP3.setResetThreshold(MY1690_RESET_AFTER_TIMEOUTS);
+    myMP3.enableStateCache(false);
+}
+
+// Set by the handlers in testUnsolicited()
+uint8_t stopsHeard = 0;
+int8_t cardInserted = -1;
+char messageHeard[16];
+
+void stopHeard(unsigned long edgeMicros, void *context)
+{
+    (void)edgeMicros;
+    (void)context;
+    stopsHeard++;
+}
+
+void cardChanged(bool inserted, void *context)
+{
+    (void)context;
+    cardInserted = inserted;
+}
+
+void messageReceived(const char *message, void *context)
+{
+    (void)context;
+    strncpy(messageHeard, message, sizeof(messageHeard) - 1);
+}
+
+// Lines the module sends on its own reach their handlers
+void testUnsolicited()
+{
+    myMP3.onStop(stopHeard);
+    myMP3.onCardChange(cardChanged);
+    myMP3.onMessage(messageReceived);
+
+    mockMP3.sendMessage("TF OUT\r\n");
+    runFor(50);
+    check(cardInserted == 0, F("onCardChange card removed"));
+    mockMP3.sendMessage("TF IN\r\n");
+    runFor(50);
+    check(cardInserted == 1, F("onCardChange card inserted"));
+    mockMP3.sendMessage("HELLO\r\n");
+    runFor(50);
+    check(strcmp(messageHeard, "HELLO") == 0, F("onMessage"));
+
+    // A short track so its 'STOP' comes soon
+    uint16_t stopsBefore = myMP3.getStopCount();
+    mockMP3.trackLengthMs = 200;
+    myMP3.playTrackNumber(2);
+    runFor(500);
+    check(stopsHeard == 1 && myMP3.getStopCount() == stopsBefore + 1, F("onStop at the end of a track"));
+    mockMP3.trackLengthMs = 3000;
+
+    myMP3.onStop(nullptr);
+    myMP3.onCardChange(nullptr);
+    myMP3.onMessage(nullptr);
+}
+
+// Handles in the order their commands completed, see testPriority()
+MY1690Handle completionOrder[4];
+uint8_t completions = 0;
+
+void commandDone(MY1690Handle handle, MY1690Status status, uint16_t value, void *context)
+{
+    (void)status;
+    (void)value;
+    (void)context;
+    if (completions < 4)
+        completionOrder[completions++] = handle;
+}
+
+// An urgent command jumps the queue and clears the queries waiting in front of it
+void testPriority()
+{
+    uint16_t cancelledBefore = myMP3.getCancelledCount();
+    completions = 0;
+
+    MY1690Handle setter = myMP3.submit(MP3_COMMAND_SET_EQ_MODE, MP3_EQ_MODE_JAZZ, 1, commandDone);
+    MY1690Handle volumeQuery = myMP3.submit(MP3_COMMAND_GET_VOLUME, 0, 0, commandDone);
+    MY1690Handle countQuery = myMP3.submit(MP3_COMMAND_GET_SONG_COUNT, 0, 0, commandDone);
+    MY1690Handle urgent = myMP3.submit(MP3_COMMAND_SET_VOLUME, 7, 1, commandDone, nullptr, MY1690_PRIORITY_HIGH);
+
+    check(myMP3.getCancelledCount() == cancelledBefore + 2, F("a high priority command cancels waiting queries"));
+    check(myMP3.getResult(volumeQuery) == MY1690_STATUS_CANCELLED &&
+              myMP3.getResult(countQuery) == MY1690_STATUS_CANCELLED,
+          F("cancelled queries report MY1690_STATUS_CANCELLED"));
+
+    MY1690Status urgentStatus = myMP3.waitFor(urgent);
+    MY1690Status setterStatus = myMP3.waitFor(setter);
+    check(urgentStatus == MY1690_STATUS_OK && setterStatus == MY1690_STATUS_OK && mockMP3.volume == 7 &&
+              mockMP3.eq == MP3_EQ_MODE_JAZZ,
+          F("high priority and normal commands both complete"));
+    check(completions == 4 && completionOrder[2] == urgent && completionOrder[3] == setter,
+          F("a high priority command is sent first"));
+
+    // cancel() takes a command back before it's sent
+    MY1690Handle handle = myMP3.submit(MP3_COMMAND_GET_EQ);
+    check(myMP3.cancel(handle) && myMP3.getResult(handle) == MY1690_STATUS_CANCELLED, F("cancel"));
+    check(myMP3.commandsPending() == 0, F("nothing left queued"));
+
+    // The blocking calls go at normal priority, so a catalog filling in the background keeps its queries
+    catalog.invalidate();
+    catalog.update();
+    cancelledBefore = myMP3.getCancelledCount();
+    bool pending = myMP3.commandsPending() > 0;
+    myMP3.setVolume(20);
+    myMP3.playTrackNumber(1);
+    myMP3.stopPlaying();
+    check(pending && myMP3.getCancelledCount() == cancelledBefore, F("blocking calls leave the catalog's queries"));
+    check(catalog.buildIndex() && catalog.getIndexedTrackCount() == mockMP3.songCount,
+          F("catalog completes alongside blocking calls"));
+}
+
+// Reply waits shrink to what the module actually takes, and survive a save and restore,
+// when the library is built with MY1690_ENABLE_ADAPTIVE_TIMEOUT 1
+void testAdaptiveTimeout()
+{
+#if MY1690_ENABLE_ADAPTIVE_TIMEOUT
+    myMP3.resetAdaptiveTimeout();
+    myMP3.enableAdaptiveTimeout();
+    check(myMP3.getResponseTimeout(MP3_COMMAND_GET_VOLUME) == myMP3.getResponseTimeout(),
+          F("an untimed opcode waits the full timeout"));
+
+    for (uint8_t x = 0; x < MY1690_ADAPTIVE_SAMPLES; x++)
+        myMP3.getVolume();
+    check(myMP3.getVolume() == mockMP3.volume, F("getVolume with the learned timeout"));
+    uint16_t learnedMs = myMP3.getResponseTimeout(MP3_COMMAND_GET_VOLUME);
+    check(learnedMs < myMP3.getResponseTimeout(), F("enableAdaptiveTimeout learns a shorter timeout"));
+
+    MY1690TimeoutTable table;
+    myMP3.getTimeoutTable(table);
+    myMP3.resetAdaptiveTimeout();
+    check(myMP3.setTimeoutTable(table) && myMP3.getResponseTimeout(MP3_COMMAND_GET_VOLUME) == learnedMs,
+          F("getTimeoutTable / setTimeoutTable"));
+    table.magic = 0;
+    check(myMP3.setTimeoutTable(table) == false, F("setTimeoutTable refuses a blank table"));
+
+    myMP3.enableAdaptiveTimeout(false);
+    check(myMP3.getResponseTimeout(MP3_COMMAND_GET_VOLUME) == myMP3.getResponseTimeout(),
+          F("enableAdaptiveTimeout(false)"));
+#else
+    myMP3.enableAdaptiveTimeout();
+    for (uint8_t x = 0; x <= MY1690_ADAPTIVE_SAMPLES; x++)
+        myMP3.getVolume();
+    MY1690TimeoutTable table;
+    myMP3.getTimeoutTable(table);
+    check(myMP3.getResponseTimeout(MP3_COMMAND_GET_VOLUME) == myMP3.getResponseTimeout() &&
+              myMP3.setTimeoutTable(table) == false,
+          F("nothing is learned without MY1690_ENABLE_ADAPTIVE_TIMEOUT"));
+    myMP3.enableAdaptiveTimeout(false);
+#endif
+}
+
+// Folder and clip numbers map to track numbers once every folder is counted
+void testCatalog()
+{
+    // The card is swapped while the first folder count is on its way back
+    unsigned long startTime = millis();
+    while (mockMP3.lastOpcode != MP3_COMMAND_GET_SONGS_IN_FOLDER_COUNT && millis() - startTime < 1000)
+        catalog.update();
+    mockMP3.folderCount[0] = 6;
+    mockMP3.songCount = 15;
+    catalog.invalidate();
+    check(catalog.buildIndex() && catalog.getSongsInFolderCount(0) == 6 && catalog.getIndexedTrackCount() == 15,
+          F("a reply sent before invalidate() is dropped"));
+
+    mockMP3.folderCount[0] = 3;
+    mockMP3.songCount = 12;
+    catalog.invalidate();
+    check(catalog.buildIndex(), F("buildIndex"));
+
+    bool countsMatch = true;
+    for (uint8_t folder = 0; folder < sizeof(mockMP3.folderCount); folder++)
+    {
+        if (catalog.getSongsInFolderCount(folder) != mockMP3.folderCount[folder])
+            countsMatch = false;
+    }
+    check(countsMatch, F("catalog getSongsInFolderCount"));
+    check(catalog.getIndexedTrackCount() == mockMP3.songCount, F("getIndexedTrackCount"));
+    check(catalog.getTrackNumber(1, 1) == 4 && catalog.getTrackNumber(2, 5) == 12, F("catalog getTrackNumber"));
+    check(catalog.getTrackNumber(3, 1) == 0, F("catalog getTrackNumber in an empty folder"));
+
+    uint8_t folder = 0;
+    uint16_t index = 0;
+    check(catalog.getFolderIndex(8, folder, index) && folder == 2 && index == 1, F("getFolderIndex"));
+
+    MY1690Handle handle = catalog.playFolderTrack(1, 2);
+    check(myMP3.waitFor(handle) == MY1690_STATUS_OK && mockMP3.track == 5, F("playFolderTrack"));
+    myMP3.stopPlaying();
+
+    // Without the busy pin the track is only read while one plays
+    bool trackRead = false;
+    startTime = millis();
+    while (millis() - startTime < 2 * MY1690_CATALOG_POLL_INTERVAL_MS + 500)
+    {
+        catalog.update();
+        if (mockMP3.lastOpcode == MP3_COMMAND_GET_CURRENT_TRACK)
+            trackRead = true;
+    }
+    check(trackRead == false, F("catalog doesn't read the track while stopped"));
+    myMP3.playTrackNumber(7);
+    startTime = millis();
+    while (catalog.getTrackName(7) == nullptr && millis() - startTime < 2 * MY1690_CATALOG_POLL_INTERVAL_MS)
+        catalog.update();
+    check(catalog.getTrackName(7) != nullptr, F("catalog names the track playing"));
+    myMP3.stopPlaying();
+
+    // A module that never answers is asked about a folder a few times, then left alone
+    uint16_t recoveriesBefore = myMP3.getRecoveryCount();
+    mockMP3.powered = false;
+    catalog.invalidate();
+    check(catalog.buildIndex(30000) == false && catalog.indexIncomplete(), F("indexIncomplete after failed counts"));
+    uint16_t recoveries = myMP3.getRecoveryCount() - recoveriesBefore;
+    bool countAsked = false;
+    startTime = millis();
+    while (millis() - startTime < 2000)
+    {
+        catalog.update();
+        if (mockMP3.lastOpcode == MP3_COMMAND_GET_SONGS_IN_FOLDER_COUNT)
+            countAsked = true;
+    }
+    check(countAsked == false, F("catalog stops asking once the index is incomplete"));
+    Serial.print(F("Resets while counting folders: "));
+    Serial.println(recoveries);
+    mockMP3.powered = true;
+    runFor(500);
+    catalog.invalidate();
+    check(catalog.buildIndex() && catalog.indexIncomplete() == false, F("invalidate starts the index over"));
+}
+
+// Without the busy pin a gap is timed from the 'STOP' to the next frame, which must have gone out
+void testSequencer()
+{
+    uint32_t trackLengthMs = mockMP3.trackLengthMs;
+    mockMP3.trackLengthMs = 200;
+    for (uint16_t track = 1; track <= 3; track++)
+        sequencer.add(track);
+    check(sequencer.start(), F("sequencer start"));
+
+    unsigned long startTime = millis();
+    while (sequencer.getPosition() < 1 && millis() - startTime < 1000)
+        sequencer.update();
+    unsigned long firstGapUs = sequencer.getLastGapUs();
+    check(sequencer.getPosition() == 1 && mockMP3.track == 2 && firstGapUs < 10000, F("sequencer gap from the STOP"));
+
+    // Keep the queue busy, so the next frame has to wait its turn
+    startTime = millis();
+    while (sequencer.getPosition() < 2 && millis() - startTime < 1000)
+    {
+        if (myMP3.commandsPending() == 0)
+            myMP3.submit(MP3_COMMAND_GET_VOLUME);
+        sequencer.update();
+    }
+    check(sequencer.getLastGapUs() == MY1690_SEQUENCER_GAP_UNKNOWN && sequencer.getMaxGapUs() == firstGapUs,
+          F("sequencer gap behind other commands is unknown"));
+
+    startTime = millis();
+    while (sequencer.isRunning() == true && millis() - startTime < 1000)
+        sequencer.update();
+    check(sequencer.isRunning() == false && mockMP3.track == 3, F("sequencer plays every clip"));
+
+    sequencer.clear();
+    mockMP3.trackLengthMs = trackLengthMs;
+    myMP3.setPlayModeSingle();
+}
+
+// Set by the cue callbacks in testCues(). Each cue's context points at its id.
+uint8_t cueIds[] = {1, 2, 3, 4, 5, 6};
+uint8_t cueOrder[16];
+uint8_t cuesFired = 0;
+bool cuesEdited = false;
+
+void cueFired(uint16_t trackNumber, uint32_t offsetMs, void *context)
+{
+    (void)trackNumber;
+    (void)offsetMs;
+    if (cuesFired < sizeof(cueOrder))
+        cueOrder[cuesFired++] = *(uint8_t *)context;
+}
+
+// The first time it fires, moves the cue at 2000 to 1500
+void cueEdit(uint16_t trackNumber, uint32_t offsetMs, void *context)
+{
+    cueFired(trackNumber, offsetMs, context);
+    if (cuesEdited == true)
+        return;
+    cuesEdited = true;
+    cues.remove(2, 2000);
+    cues.add(2, 1500, cueFired, &cueIds[4]);
+}
+
+// True if the cues fired from index start on match ids, in order
+bool cuesMatch(uint8_t start, const uint8_t *ids, uint8_t count)
+{
+    if (cuesFired != start + count)
+        return (false);
+    return (memcmp(&cueOrder[start], ids, count) == 0);
+}
+
+// Keeps the cues running until the tracked position reaches a point, or the time runs out
+void runCuesTo(uint32_t positionMs, uint16_t timeoutMs)
+{
+    unsigned long startTime = millis();
+    while (tracker.getPositionMs() < positionMs && millis() - startTime < timeoutMs)
+        cues.update();
+}
+
+// Cues fire in track and offset order, fire again after a rewind or a replay, and can be changed from a cue
+void testCues()
+{
+    // Added out of order, with two at the same point
+    cues.add(2, 2000, cueFired, &cueIds[3]);
+    cues.add(2, 1000, cueEdit, &cueIds[1]);
+    cues.add(2, 500, cueFired, &cueIds[0]);
+    cues.add(2, 1000, cueFired, &cueIds[2]);
+    cues.add(3, 100, cueFired, &cueIds[5]);
+    tracker.begin();
+
+    myMP3.playTrackNumber(2);
+    runCuesTo(1700, 3000);
+    const uint8_t firstPass[] = {1, 2, 3, 5};
+    check(cuesMatch(0, firstPass, sizeof(firstPass)), F("cues fire in order"));
+    check(cues.count() == 5, F("a cue callback can add and remove cues"));
+
+    // Back a second, so the cues after the new position fire again
+    myMP3.rewind();
+    const uint8_t rewound[] = {2, 3, 5};
+    runCuesTo(1700, 3000);
+    check(cuesMatch(sizeof(firstPass), rewound, sizeof(rewound)), F("a rewind re-arms the cues"));
+
+    // The 'STOP' at the end of the track arms them all for the next time it plays
+    unsigned long startTime = millis();
+    while (tracker.isPlaying() == true && millis() - startTime < 3000)
+        cues.update();
+    check(tracker.isPlaying() == false && cuesFired == sizeof(firstPass) + sizeof(rewound),
+          F("cues wait out the end of the track"));
+    myMP3.playTrackNumber(2);
+    runCuesTo(700, 3000);
+    const uint8_t replayed[] = {1};
+    check(cuesMatch(sizeof(firstPass) + sizeof(rewound), replayed, sizeof(replayed)),
+          F("cues fire again when the track is replayed"));
+
+    myMP3.stopPlaying();
+    cues.clear();
+    myMP3.onCommandCompleted(nullptr);
+}
+
+// Timeouts are the MY1690's own delays plus the bytes on the wire, so they shrink on a faster link
+void testBaudRate()
+{
+    check(myMP3.getBaudRate() == 9600 && myMP3.getResponseTimeout() == 100 && myMP3.getInterbyteTimeout() == 10,
+          F("timeouts at 9600bps"));
+
+#if MY1690_ENABLE_ADAPTIVE_TIMEOUT
+    myMP3.enableAdaptiveTimeout();
+    for (uint8_t x = 0; x < MY1690_ADAPTIVE_SAMPLES; x++)
+        myMP3.getVolume();
+#endif
+    myMP3.setBaudRate(115200);
+    mockMP3.baudRate = 115200;
+    check(myMP3.getResponseTimeout() == MY1690_DEVICE_LATENCY_MS && myMP3.getInterbyteTimeout() == MY1690_DEVICE_GAP_MS,
+          F("timeouts at 115200bps"));
+#if MY1690_ENABLE_ADAPTIVE_TIMEOUT
+    check(myMP3.getResponseTimeout(MP3_COMMAND_GET_VOLUME) == myMP3.getResponseTimeout(),
+          F("setBaudRate forgets the reply times learned at the old speed"));
+#endif
+    check(myMP3.getVolume() == mockMP3.volume && myMP3.getTrackNumber() == mockMP3.track, F("queries at 115200bps"));
+
+    myMP3.setBaudRate(9600);
+    mockMP3.baudRate = 9600;
+    myMP3.enableAdaptiveTimeout(false);
+    check(myMP3.getResponseTimeout() == 100 && myMP3.getVolume() == mockMP3.volume, F("back to 9600bps"));
+}
+
+// Runs a fade to its end. Returns false if the device's volume ever moved the wrong way.
+bool runRamp(uint16_t timeoutMs)
+{
+    bool down = ramp.getTarget() < ramp.getLevel();
+    uint8_t volume = mockMP3.volume;
+    bool steady = true;
+    unsigned long startTime = millis();
+    while (ramp.isRamping() == true && millis() - startTime < timeoutMs)
+    {
+        ramp.update();
+        if (down == true ? mockMP3.volume > volume : mockMP3.volume < volume)
+            steady = false;
+        volume = mockMP3.volume;
+    }
+    while (myMP3.commandsPending() > 0)
+        myMP3.update();
+    return (steady);
+}
+
+// Fades send no more steps than there are levels or intervals, and end on the target
+void testRamp()
+{
+    myMP3.setVolume(20);
+    ramp.begin();
+    ramp.setStepInterval(MY1690_RAMP_STEP_MS);
+
+    ramp.rampTo(10, 10 * MY1690_RAMP_STEP_MS);
+    check(runRamp(1000), F("ramp moves one way"));
+    check(ramp.isRamping() == false && ramp.getLevel() == 10 && mockMP3.volume == 10, F("ramp ends on its level"));
+    uint16_t steps = ramp.getStepCount();
+    check(steps > 1 && steps <= 10, F("ramp sends at most one step per level"));
+
+    ramp.rampTo(30, 0);
+    runRamp(100);
+    check(ramp.getStepCount() == steps + 1 && mockMP3.volume == 30, F("a zero length ramp is a single step"));
+
+    // A second duck keeps the level from before the first
+    ramp.duck(12, 100);
+    check(runRamp(1000) && mockMP3.volume == 12, F("duck"));
+    ramp.duck(4, 100);
+    runRamp(1000);
+    ramp.restore(100);
+    check(runRamp(1000) && mockMP3.volume == 30 && ramp.getLevel() == 30, F("restore after two ducks"));
+
+    myMP3.setVolume(20);
+}
+
+// A command to every zone overlaps the round trips, and each zone's result is kept apart
+void testBus()
+{
+    check(zone2.begin(mockZone2), F("begin second zone"));
+    zone2.setRetryPolicy(MY1690_CLASS_QUERY, 0);
+    zone2.setResetThreshold(0);
+
+    MY1690Bus bus;
+    check(bus.add(myMP3) == 0 && bus.add(zone2) == 1 && bus.count() == 2, F("bus add"));
+
+    unsigned long startTime = micros();
+    myMP3.getVolume();
+    unsigned long oneTripUs = micros() - startTime;
+
+    check(bus.setVolumeAll(8) && mockMP3.volume == 8 && mockZone2.volume == 8, F("setVolumeAll"));
+    check(bus.submitAll(MP3_COMMAND_GET_VOLUME) && bus.waitAll() == MY1690_STATUS_OK, F("submitAll / waitAll"));
+    check(bus.getZoneStatus(0) == MY1690_STATUS_OK && bus.getZoneStatus(1) == MY1690_STATUS_OK, F("getZoneStatus"));
+    check(bus.getLastLatencyUs() < oneTripUs * 7 / 4, F("zones answer side by side")); // One after the other takes twice
+    Serial.print(F("One round trip (us): "));
+    Serial.print(oneTripUs);
+    Serial.print(F(", both zones (us): "));
+    Serial.println(bus.getLastLatencyUs());
+
+    // One zone stops answering. The other still completes.
+    mockZone2.powered = false;
+    check(bus.submitAll(MP3_COMMAND_GET_VOLUME) && bus.waitAll() == MY1690_STATUS_TIMEOUT,
+          F("waitAll reports a lost zone"));
+    check(bus.getZoneStatus(0) == MY1690_STATUS_OK && bus.getZoneStatus(1) == MY1690_STATUS_TIMEOUT,
+          F("zone results kept apart"));
+    mockZone2.powered = true;
+
+    myMP3.setVolume(20);
+}
+
+// Keeps the tracker running for a while
+void runTracker(uint16_t milliseconds)
+{
+    unsigned long startTime = millis();
+    while (millis() - startTime < milliseconds)
+        tracker.update();
+}
+
+// The position counts on locally between reads, and a read that disagrees by more than the threshold moves it
+void testPosition()
+{
+    uint32_t trackLengthMs = mockMP3.trackLengthMs;
+    mockMP3.trackLengthMs = 10000;
+    tracker.begin();
+    tracker.setResyncInterval(0);
+
+    myMP3.playTrackNumber(4);
+    runTracker(500);
+    check(tracker.isPlaying() && tracker.getTrackNumber() == 4 && tracker.getDuration() == 10,
+          F("tracker reads the track and its length"));
+
+    uint16_t framesBefore = mockMP3.framesReceived;
+    uint32_t positionMs = tracker.getPositionMs();
+    delay(2000);
+    uint32_t movedMs = tracker.getPositionMs() - positionMs;
+    check(movedMs >= 2000 && movedMs < 2010 && mockMP3.framesReceived == framesBefore,
+          F("tracker position counts on without asking"));
+
+    // The module is now two seconds behind the tracker, in its first second
+    mockMP3.trackLengthMs = 8000;
+    uint16_t resyncsBefore = tracker.getResyncCount();
+    tracker.resync();
+    runTracker(100);
+    check(tracker.getResyncCount() == resyncsBefore + 1 && tracker.getLastDriftMs() > 1000 &&
+              tracker.getPositionMs() < 1100,
+          F("resync corrects drift"));
+
+    // Checked every half second from now on. A small error is left alone.
+    tracker.setResyncInterval(500);
+    resyncsBefore = tracker.getResyncCount();
+    runTracker(1200);
+    check(tracker.getResyncCount() >= resyncsBefore + 2 &&
+              labs(tracker.getLastDriftMs()) <= MY1690_POSITION_DRIFT_MS,
+          F("periodic resync finds the tracker in step"));
+
+    myMP3.stopPlaying();
+    runTracker(100);
+    check(tracker.isPlaying() == false && tracker.getPositionMs() == 0, F("tracker follows stopPlaying"));
+
+    mockMP3.trackLengthMs = trackLengthMs;
+    myMP3.onCommandCompleted(nullptr);
+}
+
+// True if a frame built by the compiler matches the one buildFrame() lays out
+bool frameMatches(const uint8_t *fixed, uint8_t length, uint8_t opcode, uint8_t paramLength, uint8_t param)
+{
+    uint8_t expected[MP3_NUM_CMD_BYTES];
+    uint8_t actual[MP3_NUM_CMD_BYTES];
+    if (SparkFunMY1690::buildFrame(expected, opcode, &param, paramLength) != length)
+        return (false);
+    memcpy_P(actual, fixed, length); // The fixed frames are in flash
+    return (memcmp(actual, expected, length) == 0);
+}
+
+// Play, pause, stop and the loop modes go out as frames built at compile time
+void testFrames()
+{
+    bool allMatch = true;
+    allMatch &= frameMatches(MY1690Frame<MP3_COMMAND_PLAY>::bytes, MY1690Frame<MP3_COMMAND_PLAY>::length,
+                             MP3_COMMAND_PLAY, 0, 0);
+    allMatch &= frameMatches(MY1690Frame<MP3_COMMAND_PAUSE>::bytes, MY1690Frame<MP3_COMMAND_PAUSE>::length,
+                             MP3_COMMAND_PAUSE, 0, 0);
+    allMatch &= frameMatches(MY1690Frame<MP3_COMMAND_STOP>::bytes, MY1690Frame<MP3_COMMAND_STOP>::length,
+                             MP3_COMMAND_STOP, 0, 0);
+    allMatch &= frameMatches(MY1690Frame<MP3_COMMAND_SET_LOOP_MODE, MP3_LOOP_MODE_FULL>::bytes,
+                             MY1690Frame<MP3_COMMAND_SET_LOOP_MODE, MP3_LOOP_MODE_FULL>::length,
+                             MP3_COMMAND_SET_LOOP_MODE, 1, MP3_LOOP_MODE_FULL);
+    allMatch &= frameMatches(MY1690Frame<MP3_COMMAND_SET_LOOP_MODE, MP3_LOOP_MODE_FOLDER>::bytes,
+                             MY1690Frame<MP3_COMMAND_SET_LOOP_MODE, MP3_LOOP_MODE_FOLDER>::length,
+                             MP3_COMMAND_SET_LOOP_MODE, 1, MP3_LOOP_MODE_FOLDER);
+    allMatch &= frameMatches(MY1690Frame<MP3_COMMAND_SET_LOOP_MODE, MP3_LOOP_MODE_SINGLE>::bytes,
+                             MY1690Frame<MP3_COMMAND_SET_LOOP_MODE, MP3_LOOP_MODE_SINGLE>::length,
+                             MP3_COMMAND_SET_LOOP_MODE, 1, MP3_LOOP_MODE_SINGLE);
+    allMatch &= frameMatches(MY1690Frame<MP3_COMMAND_SET_LOOP_MODE, MP3_LOOP_MODE_RANDOM>::bytes,
+                             MY1690Frame<MP3_COMMAND_SET_LOOP_MODE, MP3_LOOP_MODE_RANDOM>::length,
+                             MP3_COMMAND_SET_LOOP_MODE, 1, MP3_LOOP_MODE_RANDOM);
+    allMatch &= frameMatches(MY1690Frame<MP3_COMMAND_SET_LOOP_MODE, MP3_LOOP_MODE_NO_LOOP>::bytes,
+                             MY1690Frame<MP3_COMMAND_SET_LOOP_MODE, MP3_LOOP_MODE_NO_LOOP>::length,
+                             MP3_COMMAND_SET_LOOP_MODE, 1, MP3_LOOP_MODE_NO_LOOP);
+    check(allMatch, F("compile time frames match buildFrame()"));
+
+    // And the device takes them
+    uint16_t badBefore = mockMP3.badFrames;
+    bool allTaken = true;
+    for (uint8_t mode = MP3_LOOP_MODE_FULL; mode <= MP3_LOOP_MODE_NO_LOOP; mode++)
+    {
+        if (myMP3.setPlayMode(mode) == false || mockMP3.loopMode != mode)
+            allTaken = false;
+    }
+    myMP3.playTrackNumber(3);
+    allTaken &= myMP3.pause() && mockMP3.status == 2;
+    myMP3.play();
+    allTaken &= mockMP3.status == 1;
+    allTaken &= myMP3.stopPlaying() && mockMP3.status == 0;
+    check(allTaken && mockMP3.badFrames == badBefore, F("play, pause, stop and loop mode frames"));
+}
+
+// A snapshot reads seven fields in far less than seven round trips, even at the default pipeline depth
+void testSnapshot()
+{
+    myMP3.playTrackNumber(4);
+    unsigned long startTime = micros();
+    myMP3.getVolume();
+    uint32_t roundTripUs = micros() - startTime;
+
+    MY1690Snapshot snapshot;
+    check(myMP3.getSnapshot(snapshot) == MY1690_STATUS_OK && snapshot.valid == MY1690_SNAPSHOT_ALL,
+          F("getSnapshot fills every field"));
+    check(snapshot.playStatus == mockMP3.status && snapshot.volume == mockMP3.volume && snapshot.eq == mockMP3.eq &&
+              snapshot.playMode == mockMP3.loopMode && snapshot.trackNumber == 4,
+          F("getSnapshot values"));
+    check(snapshot.takenUs < 7 * roundTripUs, F("getSnapshot is quicker than seven queries"));
+    Serial.print(F("One query / snapshot (us): "));
+    Serial.print(roundTripUs);
+    Serial.print(F(" / "));
+    Serial.println(snapshot.takenUs);
+    myMP3.stopPlaying();
+}
+
+// Collects a binary capture in RAM
+class CaptureBuffer : public Print
+{
+  public:
+    uint8_t bytes[MY1690_CAPTURE_MAGIC_LENGTH + MY1690_CAPTURE_ENTRIES * 4]; // A varint time and the byte
+    size_t length = 0;
+
+    size_t write(uint8_t value) override
+    {
+        if (length >= sizeof(bytes))
+            return (0);
+        bytes[length++] = value;
+        return (1);
+    }
+    using Print::write;
+};
+
+// The same few commands, for the capture and for its replay
+bool captureSession(uint16_t &volume, uint16_t &track)
+{
+    bool allOK = myMP3.setVolume(18);
+    volume = myMP3.getVolume();
+    allOK &= myMP3.playTrackNumber(2);
+    track = myMP3.getTrackNumber();
+    allOK &= myMP3.stopPlaying();
+    return (allOK);
+}
+
+// A capture written with dumpBinary() replays through the library byte for byte
+void testCapture()
+{
+    CaptureBuffer buffer;
+    uint16_t volume;
+    uint16_t track;
+    {
+        MY1690Capture capture(mockMP3);
+        check(myMP3.begin(capture) && captureSession(volume, track) && volume == 18 && track == 2,
+              F("commands through MY1690Capture"));
+        check(capture.getDropped() == 0, F("capture kept every byte"));
+        check(capture.dumpBinary(buffer) == buffer.length && buffer.length < sizeof(buffer.bytes),
+              F("dumpBinary"));
+    }
+
+    MY1690Replay replay(buffer.bytes, buffer.length);
+    uint16_t replayedVolume;
+    uint16_t replayedTrack;
+    check(replay.begin() && myMP3.begin(replay) && captureSession(replayedVolume, replayedTrack) &&
+              replayedVolume == volume && replayedTrack == track,
+          F("commands through MY1690Replay"));
+    check(replay.getMismatchCount() == 0 && replay.getMatchCount() > 0, F("replay matches every byte sent"));
+    runFor(100); // Anything captured after the last frame
+    check(replay.isComplete(), F("replay reaches the end of the capture"));
+
+    myMP3.begin(mockMP3);
+}
@@ -0,0 +1,124 @@
+/*
+  Just enough of the Arduino core to build the library and Testing2_MockDevice on a PC
+  By: SparkFun Electronics
+  Date: October 17th, 2026
+  License: MIT. See license file for more information but you can
+  basically do whatever you want with this code.
+*/
+
+#include "Arduino.h"
+
+HostSerial Serial;
+
+static uint64_t clockUs = 0;
+static uint8_t pinLevel[HOST_PINS];
+static void (*pinInterrupt[HOST_PINS])(void);
+
+unsigned long micros(void)
+{
+    clockUs++; // A loop that waits on the clock has to see it move
+    return ((unsigned long)(uint32_t)clockUs);
+}
+
+unsigned long millis(void)
+{
+    clockUs++;
+    return ((unsigned long)(uint32_t)(clockUs / 1000));
+}
+
+void delay(unsigned long milliseconds)
+{
+    clockUs += milliseconds * 1000ULL;
+}
+
+void delayMicroseconds(unsigned int microseconds)
+{
+    clockUs += microseconds;
+}
+
+void yield(void)
+{
+    clockUs += 10;
+}
+
+void pinMode(uint8_t pin, uint8_t mode)
+{
+    (void)pin;
+    (void)mode;
+}
+
+int digitalRead(uint8_t pin)
+{
+    return (pin < HOST_PINS ? pinLevel[pin] : LOW);
+}
+
+void digitalWrite(uint8_t pin, uint8_t level)
+{
+    if (pin >= HOST_PINS || pinLevel[pin] == level)
+        return;
+    pinLevel[pin] = level;
+    if (pinInterrupt[pin] != nullptr)
+        pinInterrupt[pin]();
+}
+
+void attachInterrupt(int interrupt, void (*isr)(void), int mode)
+{
+    (void)mode;
+    if (interrupt >= 0 && interrupt < HOST_PINS)
+        pinInterrupt[interrupt] = isr;
+}
+
+void detachInterrupt(int interrupt)
+{
+    if (interrupt >= 0 && interrupt < HOST_PINS)
+        pinInterrupt[interrupt] = nullptr;
+}
+
+long random(long howBig)
+{
+    return (howBig > 0 ? rand() % howBig : 0);
+}
+
+long random(long howSmall, long howBig)
+{
+    return (howSmall + random(howBig - howSmall));
+}
+
+size_t Print::write(const uint8_t *buffer, size_t size)
+{
+    size_t written = 0;
+    while (size-- > 0)
+        written += write(*buffer++);
+    return (written);
+}
+
+size_t Print::print(unsigned long number, int base)
+{
+    char text[24];
+    snprintf(text, sizeof(text), base == HEX ? "%lX" : "%lu", number);
+    return (write(text));
+}
+
+size_t Print::print(long number, int base)
+{
+    if (base == HEX)
+        return (print((unsigned long)number, base));
+    char text[24];
+    snprintf(text, sizeof(text), "%ld", number);
+    return (write(text));
+}
+
+size_t Print::print(double number, int digits)
+{
+    char text[32];
+    snprintf(text, sizeof(text), "%.*f", digits, number);
+    return (write(text));
+}
+
+size_t Stream::readBytes(uint8_t *buffer, size_t length)
+{
+    size_t count = 0;
+    while (count < length && available() > 0)
+        buffer[count++] = read();
+    return (count);
+}
@@ -0,0 +1,171 @@
+/*
+  Just enough of the Arduino core to build the library and Testing2_MockDevice on a PC
+  By: SparkFun Electronics
+  Date: October 17th, 2026
+  License: MIT. See license file for more information but you can
+  basically do whatever you want with this code.
+
+  Time is simulated: every call to micros() or millis() moves the clock on
+  by a microsecond, and delay() moves it on by the time asked for. Runs are
+  repeatable and take a fraction of a second no matter how long the tests
+  wait, and the latency printed is measured against the simulated baud rate.
+*/
+
+#ifndef SPARKFUN_MY1690_HOST_ARDUINO_H
+#define SPARKFUN_MY1690_HOST_ARDUINO_H
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define LOW 0
+#define HIGH 1
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+#define CHANGE 1
+#define FALLING 2
+#define RISING 3
+#define DEC 10
+#define HEX 16
+#define NOT_AN_INTERRUPT -1
+#define HOST_PINS 64
+
+#define PROGMEM
+#define pgm_read_byte(address) (*(const uint8_t *)(address))
+#define memcpy_P memcpy
+
+class __FlashStringHelper;
+#define F(string) ((const __FlashStringHelper *)(string))
+
+#define digitalPinToInterrupt(pin) ((pin) < HOST_PINS ? (pin) : NOT_AN_INTERRUPT)
+#define noInterrupts()
+#define interrupts()
+
+// Simulated clock
+unsigned long micros(void);
+unsigned long millis(void);
+void delay(unsigned long milliseconds);
+void delayMicroseconds(unsigned int microseconds);
+void yield(void);
+
+// Pins only hold a level. Writing one calls the interrupt attached to it, so a simulated busy pin works.
+void pinMode(uint8_t pin, uint8_t mode);
+int digitalRead(uint8_t pin);
+void digitalWrite(uint8_t pin, uint8_t level);
+void attachInterrupt(int interrupt, void (*isr)(void), int mode);
+void detachInterrupt(int interrupt);
+
+long random(long howBig);
+long random(long howSmall, long howBig);
+
+class Print
+{
+  public:
+    virtual ~Print()
+    {
+    }
+    virtual size_t write(uint8_t character) = 0;
+    virtual size_t write(const uint8_t *buffer, size_t size);
+    size_t write(const char *string)
+    {
+        return (write((const uint8_t *)string, strlen(string)));
+    }
+
+    size_t print(const char *string)
+    {
+        return (write(string));
+    }
+    size_t print(const __FlashStringHelper *string)
+    {
+        return (write((const char *)string));
+    }
+    size_t print(char character)
+    {
+        return (write((uint8_t)character));
+    }
+    size_t print(unsigned long number, int base = DEC);
+    size_t print(long number, int base = DEC);
+    size_t print(unsigned int number, int base = DEC)
+    {
+        return (print((unsigned long)number, base));
+    }
+    size_t print(int number, int base = DEC)
+    {
+        return (print((long)number, base));
+    }
+    size_t print(unsigned char number, int base = DEC)
+    {
+        return (print((unsigned long)number, base));
+    }
+    size_t print(double number, int digits = 2);
+
+    size_t println(void)
+    {
+        return (write("\r\n"));
+    }
+    template <typename T> size_t println(T value)
+    {
+        size_t length = print(value);
+        return (length + println());
+    }
+    template <typename T> size_t println(T value, int format)
+    {
+        size_t length = print(value, format);
+        return (length + println());
+    }
+};
+
+class Stream : public Print
+{
+  public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+    virtual void flush()
+    {
+    }
+    size_t readBytes(uint8_t *buffer, size_t length);
+    size_t readBytes(char *buffer, size_t length)
+    {
+        return (readBytes((uint8_t *)buffer, length));
+    }
+};
+
+// Serial prints to stdout and never receives anything
+class HostSerial : public Stream
+{
+  public:
+    void begin(unsigned long baud)
+    {
+        (void)baud;
+    }
+    size_t write(uint8_t character) override
+    {
+        putchar(character);
+        return (1);
+    }
+    using Print::write;
+    int available() override
+    {
+        return (0);
+    }
+    int read() override
+    {
+        return (-1);
+    }
+    int peek() override
+    {
+        return (-1);
+    }
+};
+
+extern HostSerial Serial;
+
+#endif
@@ -0,0 +1,22 @@
+/*
+  Runs a testing sketch once on a PC and reports the result as the exit code
+  By: SparkFun Electronics
+  Date: October 17th, 2026
+  License: MIT. See license file for more information but you can
+  basically do whatever you want with this code.
+*/
+
+#include "Arduino.h"
+
+void setup(void);
+void loop(void);
+
+extern uint8_t testsFailed; // Counted by the sketch's check()
+
+int main(void)
+{
+    setvbuf(stdout, nullptr, _IONBF, 0); // Nothing lost if a test crashes
+    setup();
+    loop();
+    return (testsFailed == 0 ? 0 : 1);
+}
@@ -0,0 +1,176 @@
+/*
+  Plays a capture from MY1690Capture back through the library on a PC
+  By: SparkFun Electronics
+  Date: October 17th, 2026
+  License: MIT. See license file for more information but you can
+  basically do whatever you want with this code.
+
+  Usage: my1690_replay <capture file>
+
+  The file is either what dumpBinary() wrote, or the C array Example10_CaptureLog
+  prints. The capture has to start before the player's begin(), as it does in
+  Example10_CaptureLog, and must not have dropped any bytes.
+
+  The player is started on an MY1690Replay of the capture. Then every frame the
+  capture holds after begin() is submitted again, one at a time, and the status
+  and value are printed as the library parsed them. The replay hands the captured replies back
+  with their captured timing, and checks each frame the library writes against
+  the capture. The exit code is 1 if any byte differed or begin() failed.
+*/
+
+#include "Arduino.h"
+#include "SparkFun_MY1690_Capture.h"
+#include "SparkFun_MY1690_MP3_Library.h"
+
+#define REPLAY_MAX_CAPTURE 65536
+#define REPLAY_TAIL_MS 2000 // Time allowed for the bytes captured after the last frame
+
+static uint8_t capture[REPLAY_MAX_CAPTURE];
+
+// Reads a binary capture, or the hex bytes of a C array. Returns the number of bytes, 0 on failure.
+static size_t readCapture(const char *path)
+{
+    FILE *file = fopen(path, "rb");
+    if (file == nullptr)
+        return (0);
+    size_t length = fread(capture, 1, sizeof(capture), file);
+    fclose(file);
+
+    if (length >= MY1690_CAPTURE_MAGIC_LENGTH &&
+        memcmp(capture, MY1690_CAPTURE_MAGIC, MY1690_CAPTURE_MAGIC_LENGTH) == 0)
+        return (length);
+
+    // Text: keep every 0x.. in order
+    size_t count = 0;
+    for (size_t x = 0; x + 2 < length; x++)
+    {
+        if (capture[x] == '0' && (capture[x + 1] == 'x' || capture[x + 1] == 'X'))
+        {
+            char digits[3] = {(char)capture[x + 2], x + 3 < length ? (char)capture[x + 3] : '\0', '\0'};
+            capture[count++] = (uint8_t)strtoul(digits, nullptr, 16);
+            x += 2;
+        }
+    }
+    return (count);
+}
+
+// Collects the bytes the capture sent to the MY1690, in order. Returns how many.
+static size_t sentBytes(size_t length, uint8_t *sent)
+{
+    size_t count = 0;
+    size_t offset = MY1690_CAPTURE_MAGIC_LENGTH;
+    while (offset < length)
+    {
+        uint32_t field = 0;
+        uint8_t shift = 0;
+        uint8_t digit;
+        do
+        {
+            digit = capture[offset++];
+            field |= (uint32_t)(digit & 0x7F) << shift;
+            shift += 7;
+        } while ((digit & 0x80) != 0 && offset < length && shift <= 28);
+
+        if (offset >= length)
+            break;
+        uint8_t value = capture[offset++];
+        if (field & 1)
+            sent[count++] = value;
+    }
+    return (count);
+}
+
+static const char *statusName(MY1690Status status)
+{
+    switch (status)
+    {
+    case MY1690_STATUS_OK:
+        return ("OK");
+    case MY1690_STATUS_TIMEOUT:
+        return ("TIMEOUT");
+    case MY1690_STATUS_PARSE_ERROR:
+        return ("PARSE_ERROR");
+    case MY1690_STATUS_NACK:
+        return ("NACK");
+    case MY1690_STATUS_CANCELLED:
+        return ("CANCELLED");
+    default:
+        return ("INVALID");
+    }
+}
+
+int main(int argc, char **argv)
+{
+    setvbuf(stdout, nullptr, _IONBF, 0);
+    if (argc != 2)
+    {
+        fprintf(stderr, "Usage: %s <capture file>\n", argv[0]);
+        return (2);
+    }
+
+    size_t length = readCapture(argv[1]);
+    MY1690Replay replay(capture, length);
+    if (replay.begin() == false)
+    {
+        fprintf(stderr, "%s is not a capture\n", argv[1]);
+        return (2);
+    }
+
+    static uint8_t sent[REPLAY_MAX_CAPTURE];
+    size_t sentCount = sentBytes(length, sent);
+
+    // One frame in the capture is one submit() here
+    SparkFunMY1690 player;
+    player.setCoalescing(false);
+    player.setRetryPolicy(MY1690_CLASS_QUERY, 0);
+    player.setRetryPolicy(MY1690_CLASS_SETTER, 0);
+    player.setResetThreshold(0);
+
+    bool started = player.begin(replay, 255, 0);
+    printf("begin: %s\n", started ? "OK" : "failed");
+
+    // Frames after the ones begin() sent
+    size_t offset = replay.getMatchCount() + replay.getMismatchCount();
+    uint16_t frames = 0;
+    while (offset + 4 < sentCount)
+    {
+        if (sent[offset] != MP3_START_CODE)
+        {
+            offset++; // Not the start of a frame, look for the next
+            continue;
+        }
+        uint8_t frameLength = sent[offset + 1] + 2;
+        if (frameLength < 5 || offset + frameLength > sentCount)
+            break;
+
+        uint8_t opcode = sent[offset + 2];
+        uint8_t paramLength = frameLength - 5;
+        uint16_t param = 0;
+        for (uint8_t x = 0; x < paramLength; x++)
+            param = (param << 8) | sent[offset + 3 + x];
+
+        uint16_t value = 0;
+        MY1690Status status = player.waitFor(player.submit(opcode, param, paramLength), &value);
+        printf("0x%02X", opcode);
+        if (paramLength > 0)
+            printf(" %u", param);
+        printf(": %s, value %u\n", statusName(status), value);
+
+        offset += frameLength;
+        frames++;
+    }
+
+    // Let whatever the MY1690 sent after the last frame come through
+    unsigned long startTime = millis();
+    while (replay.isComplete() == false && millis() - startTime < REPLAY_TAIL_MS)
+        player.update();
+
+    char line[MY1690_RESPONSE_BUFFER_SIZE];
+    while (player.readUnsolicited(line, sizeof(line)) != MY1690_LINE_NONE)
+        printf("Unsolicited: '%s'\n", line);
+
+    printf("%u frames after begin(), %lu bytes matched, %lu mismatched, capture %s\n", frames,
+           (unsigned long)replay.getMatchCount(), (unsigned long)replay.getMismatchCount(),
+           replay.isComplete() ? "complete" : "not complete");
+    return (started == true && replay.getMismatchCount() == 0 ? 0 : 1);
+}